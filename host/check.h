@@ -0,0 +1,39 @@
+#ifndef _CHECK_H
+#define _CHECK_H
+
+#include <stdbool.h>
+#include <stdio.h>
+
+/*
+ * Checks for the host tests. A failed check is reported with its location
+ * and the test goes on; check_status() is the exit status of the test.
+ */
+
+static unsigned check_failures;
+
+static inline bool check(bool ok, const char *expr, const char *file,
+                         int line)
+{
+    if (!ok)
+    {
+        fprintf(stderr, "%s:%d: check failed: %s\n", file, line, expr);
+        check_failures++;
+    }
+
+    return ok;
+}
+
+#define CHECK(expr) check((expr), #expr, __FILE__, __LINE__)
+
+static inline int check_status(void)
+{
+    if (check_failures > 0)
+    {
+        fprintf(stderr, "%u checks failed\n", check_failures);
+        return 1;
+    }
+
+    return 0;
+}
+
+#endif
@@ -0,0 +1,248 @@
+#include <inttypes.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "history.h"
+#include "json.h"
+#include "sample_bin.h"
+
+/*
+ * Comparison of the JSON and the binary representation of samples (see
+ * sample_bin.h), in bytes on the wire and in the cost of encoding them.
+ *
+ * For /sensor, a body holds one sample: json_sensor() against
+ * sample_bin_sensor(), and against the formatter that json_sensor()
+ * replaced, which converted the values to float and printed them with
+ * "%.2f" into a string from new_string(), copied below. For /history,
+ * each sample is one record of a long body: the JSON array element
+ * formatted as in history_respond() against sample_bin_record(). Every
+ * binary body is decoded again with sample_bin_decode() and checked
+ * against the values it was encoded from; the exit status is non-zero on
+ * any mismatch.
+ *
+ * Usage: codec-bench [samples]
+ */
+
+#define DEFAULT_SAMPLES (100000)
+
+/* Longest JSON history record, as HISTORY_JSON_REC_MAX in handlers.c */
+#define JSON_REC_MAX (sizeof(",[4294967295,-2147483648,4294967295,4294967295]"))
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t)ts.tv_sec * 1000000000 + (uint64_t)ts.tv_nsec;
+}
+
+/*
+ * The former new_string() of utils.c, an allocating formatter: vsnprintf()
+ * once for the length, and again into a buffer from malloc().
+ */
+static char *new_string(const char *format, ...)
+{
+    va_list args;
+
+    va_start(args, format);
+    int len = vsnprintf(NULL, 0, format, args);
+    va_end(args);
+
+    char *str = (char *)malloc(len + 1);
+    if (!str)
+    {
+        return NULL;
+    }
+
+    va_start(args, format);
+    vsnprintf(str, len + 1, format, args);
+    va_end(args);
+
+    return str;
+}
+
+/* The former /sensor body, from the floats that core1 published. */
+static size_t printf_sensor(const sample_t *s)
+{
+    float t = s->temperature / 100.0f;
+    float h = s->humidity / 1024.f;
+    float p = s->pressure / 256.f / 100.f;
+    char *body = new_string(
+        "{\"temperature\":%.2f,\"humidity\":%.2f,\"pressure\":%.2f}", t, h,
+        p);
+    size_t len = strlen(body);
+
+    free(body);
+
+    return len;
+}
+
+/* Slow random walk, as in host/main.c */
+static int32_t walk(int32_t v, int32_t step, int32_t lo, int32_t hi)
+{
+    v += rand() % (2 * step + 1) - step;
+
+    return v < lo ? lo : v > hi ? hi : v;
+}
+
+static history_sample_t quantize(const sample_t *s)
+{
+    history_sample_t h = {
+        .ts = s->ts,
+        .temperature = s->temperature,
+        .humidity = sample_humidity_centi(s),
+        .pressure = sample_pressure_pa(s),
+    };
+
+    return h;
+}
+
+static bool same(const history_sample_t *a, const history_sample_t *b)
+{
+    return a->seq == b->seq && a->ts == b->ts &&
+           a->temperature == b->temperature && a->humidity == b->humidity &&
+           a->pressure == b->pressure;
+}
+
+int main(int argc, char **argv)
+{
+    unsigned long n = argc > 1 ? strtoul(argv[1], NULL, 0) : DEFAULT_SAMPLES;
+    sample_t *samples;
+    history_sample_t *hist, *decoded;
+    uint8_t *bin;
+    char json[JSON_SENSOR_MAX + JSON_REC_MAX];
+    uint8_t rec[SAMPLE_BIN_SENSOR_LEN];
+    uint64_t t0, json_ns, bin_ns, json_bytes = 0, bin_bytes = 0;
+    uint64_t printf_ns, printf_bytes = 0;
+    size_t len;
+    unsigned long mismatches = 0;
+    volatile size_t sink = 0;
+
+    if (n == 0)
+    {
+        return 0;
+    }
+    samples = malloc(n * sizeof *samples);
+    hist = malloc(n * sizeof *hist);
+    decoded = malloc(n * sizeof *decoded);
+    bin = malloc(SAMPLE_BIN_HDR_LEN + n * SAMPLE_BIN_REC_LEN);
+    if (samples == NULL || hist == NULL || decoded == NULL || bin == NULL)
+    {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+
+    srand(1);
+    int32_t t = 2150, h = 45 * 1024, p = 101325 * 256;
+    for (unsigned long i = 0; i < n; i++)
+    {
+        t = walk(t, 3, -4000, 8500);
+        h = walk(h, 40, 0, 100 * 1024);
+        p = walk(p, 64, 30000 * 256, 110000 * 256);
+        samples[i] = (sample_t){
+            .ts = (uint32_t)i, .temperature = t, .humidity = h, .pressure = p};
+        hist[i] = quantize(&samples[i]);
+        hist[i].seq = (uint32_t)i + 1;
+    }
+
+    printf("%-16s %10s %10s  (per sample)\n", "", "bytes", "ns");
+
+    // /sensor: one sample per body
+    t0 = now_ns();
+    for (unsigned long i = 0; i < n; i++)
+    {
+        printf_bytes += printf_sensor(&samples[i]);
+    }
+    printf_ns = now_ns() - t0;
+
+    t0 = now_ns();
+    for (unsigned long i = 0; i < n; i++)
+    {
+        len = json_sensor(json, &samples[i]);
+        json_bytes += len;
+        sink += json[len - 1];
+    }
+    json_ns = now_ns() - t0;
+
+    t0 = now_ns();
+    for (unsigned long i = 0; i < n; i++)
+    {
+        len = sample_bin_sensor(rec, &samples[i]);
+        bin_bytes += len;
+        sink += rec[len - 1];
+    }
+    bin_ns = now_ns() - t0;
+
+    printf("%-16s %10.1f %10.1f\n", "sensor printf",
+           (double)printf_bytes / n, (double)printf_ns / n);
+    printf("%-16s %10.1f %10.1f\n", "sensor json", (double)json_bytes / n,
+           (double)json_ns / n);
+    printf("%-16s %10.1f %10.1f\n", "sensor bin", (double)bin_bytes / n,
+           (double)bin_ns / n);
+
+    // The record of /sensor.bin is not numbered, its seq is 0
+    for (unsigned long i = 0; i < n; i++)
+    {
+        history_sample_t d, q = quantize(&samples[i]);
+
+        len = sample_bin_sensor(rec, &samples[i]);
+        if (sample_bin_decode(rec, len, &d, 1) != 1 || !same(&d, &q))
+        {
+            mismatches++;
+        }
+    }
+
+    // /history: one record per sample in a long body
+    json_bytes = 0;
+    t0 = now_ns();
+    for (unsigned long i = 0; i < n; i++)
+    {
+        const history_sample_t *s = &hist[i];
+
+        len = snprintf(json, sizeof json,
+                       "%s[%" PRIu32 ",%" PRId32 ",%" PRIu32 ",%" PRIu32 "]",
+                       i > 0 ? "," : "", s->ts, s->temperature, s->humidity,
+                       s->pressure);
+        json_bytes += len;
+        sink += json[len - 1];
+    }
+    json_ns = now_ns() - t0;
+
+    t0 = now_ns();
+    bin_bytes = sample_bin_header(bin);
+    for (unsigned long i = 0; i < n; i++)
+    {
+        bin_bytes += sample_bin_record(bin + bin_bytes, &hist[i]);
+    }
+    bin_ns = now_ns() - t0;
+
+    printf("%-16s %10.1f %10.1f\n", "history json", (double)json_bytes / n,
+           (double)json_ns / n);
+    printf("%-16s %10.1f %10.1f\n", "history bin", (double)bin_bytes / n,
+           (double)bin_ns / n);
+
+    if (sample_bin_decode(bin, bin_bytes, decoded, n) != (int)n)
+    {
+        mismatches += n;
+    }
+    else
+    {
+        for (unsigned long i = 0; i < n; i++)
+        {
+            mismatches += !same(&decoded[i], &hist[i]);
+        }
+    }
+    printf("decode: %lu samples, %lu mismatches\n", n, mismatches);
+
+    (void)sink;
+    free(samples);
+    free(hist);
+    free(decoded);
+    free(bin);
+
+    return mismatches != 0;
+}
@@ -0,0 +1,208 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "pico/stdlib.h"
+
+#include <ssd1306.h>
+
+#include "sim.h"
+
+/*
+ * Comparison of ssd1306_draw_char_with_font(), which blits whole glyph
+ * columns for fonts at most 8 pixels high, with the per-pixel rendering it
+ * replaced, copied below: one ssd1306_draw_square() per set bit.
+ *
+ * Every glyph of font_8x5 is drawn at scales 1 to 7, at offsets inside the
+ * display and across each of its edges, over a random background, by both;
+ * the buffers and the columns marked for the next show must be the same.
+ * Then both are timed per glyph at each scale. The exit status is non-zero
+ * on any mismatch.
+ *
+ * Usage: glyph-bench [rounds]
+ */
+
+#define DEFAULT_ROUNDS (200)
+
+#define WIDTH (128)
+#define HEIGHT (64)
+
+#define MAX_SCALE (7)
+
+/* In font.h, compiled into ssd1306.c */
+extern const uint8_t font_8x5[];
+
+static sim_ssd1306_t sim_blit, sim_ref;
+static ssd1306_t blit, ref;
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t)ts.tv_sec * 1000000000 + (uint64_t)ts.tv_nsec;
+}
+
+/* The former ssd1306_draw_char_with_font(), for any font height. */
+static void ref_draw_char(ssd1306_t *p, uint32_t x, uint32_t y, uint32_t scale,
+                          const uint8_t *font, char c)
+{
+    if (c < font[3] || c > font[4])
+    {
+        return;
+    }
+
+    uint32_t parts_per_line = (font[0] >> 3) + ((font[0] & 7) > 0);
+    for (uint8_t w = 0; w < font[1]; ++w)
+    {
+        uint32_t pp = (c - font[3]) * font[1] * parts_per_line +
+                      w * parts_per_line + 5;
+        for (uint32_t lp = 0; lp < parts_per_line; ++lp)
+        {
+            uint8_t line = font[pp];
+
+            for (int8_t j = 0; j < 8; ++j, line >>= 1)
+            {
+                if (line & 1)
+                {
+                    ssd1306_draw_square(p, x + w * scale,
+                                        y + ((lp << 3) + j) * scale, scale,
+                                        scale);
+                }
+            }
+
+            ++pp;
+        }
+    }
+}
+
+/* The same random background in both buffers, with nothing marked */
+static void background(void)
+{
+    for (size_t i = 0; i < blit.bufsize; i++)
+    {
+        blit.buffer[i] = (uint8_t)(rand() & rand());
+    }
+    memcpy(ref.buffer, blit.buffer, blit.bufsize);
+    memset(blit.dirty_lo, 0xFF, sizeof blit.dirty_lo);
+    memset(blit.dirty_hi, 0, sizeof blit.dirty_hi);
+    memcpy(ref.dirty_lo, blit.dirty_lo, sizeof ref.dirty_lo);
+    memcpy(ref.dirty_hi, blit.dirty_hi, sizeof ref.dirty_hi);
+}
+
+static bool same(void)
+{
+    return memcmp(blit.buffer, ref.buffer, blit.bufsize) == 0 &&
+           memcmp(blit.dirty_lo, ref.dirty_lo, sizeof blit.dirty_lo) == 0 &&
+           memcmp(blit.dirty_hi, ref.dirty_hi, sizeof blit.dirty_hi) == 0;
+}
+
+/* Offsets at an edge of a dimension of n pixels, for a glyph of size g */
+static int offsets(uint32_t n, uint32_t g, uint32_t out[8])
+{
+    uint32_t cand[] = {0, 1, 3, 7, n / 2 - 1, n - g, n - g / 2, n - 1};
+    int k = 0;
+
+    for (size_t i = 0; i < count_of(cand); i++)
+    {
+        // n - g underflows for glyphs larger than the display
+        if (cand[i] < n)
+        {
+            out[k++] = cand[i];
+        }
+    }
+
+    return k;
+}
+
+/* Number of glyph, scale and offset combinations rendered differently */
+static unsigned long compare(unsigned long *drawn)
+{
+    const uint8_t *font = font_8x5;
+    unsigned long mismatches = 0;
+    uint32_t xs[8], ys[8];
+
+    for (uint32_t scale = 1; scale <= MAX_SCALE; scale++)
+    {
+        int nx = offsets(WIDTH, font[1] * scale, xs);
+        int ny = offsets(HEIGHT, font[0] * scale, ys);
+
+        for (int c = font[3]; c <= font[4]; c++)
+        {
+            for (int i = 0; i < nx; i++)
+            {
+                for (int j = 0; j < ny; j++)
+                {
+                    background();
+                    ssd1306_draw_char_with_font(&blit, xs[i], ys[j], scale,
+                                                font, (char)c);
+                    ref_draw_char(&ref, xs[i], ys[j], scale, font, (char)c);
+                    (*drawn)++;
+                    if (!same() && mismatches++ == 0)
+                    {
+                        printf("  mismatch: '%c' scale %lu at %lu,%lu\n", c,
+                               (unsigned long)scale, (unsigned long)xs[i],
+                               (unsigned long)ys[j]);
+                    }
+                }
+            }
+        }
+    }
+
+    return mismatches;
+}
+
+/* ns per glyph drawn with draw, over all glyphs at one place */
+static double bench(void (*draw)(ssd1306_t *, uint32_t, uint32_t, uint32_t,
+                                 const uint8_t *, char),
+                    ssd1306_t *p, uint32_t scale, unsigned long rounds)
+{
+    const uint8_t *font = font_8x5;
+    uint64_t t0 = now_ns();
+
+    for (unsigned long r = 0; r < rounds; r++)
+    {
+        for (int c = font[3]; c <= font[4]; c++)
+        {
+            draw(p, 0, 0, scale, font, (char)c);
+        }
+    }
+
+    return (double)(now_ns() - t0) / ((double)rounds * (font[4] - font[3] + 1));
+}
+
+int main(int argc, char **argv)
+{
+    unsigned long rounds = argc > 1 ? strtoul(argv[1], NULL, 0)
+                                    : DEFAULT_ROUNDS;
+    unsigned long drawn = 0, mismatches;
+
+    i2c_init(i2c0, 1000000);
+    sim_ssd1306_init(&sim_blit, 0x3C);
+    sim_ssd1306_init(&sim_ref, 0x3D);
+    sim_i2c_attach(i2c0, &sim_blit.dev);
+    sim_i2c_attach(i2c0, &sim_ref.dev);
+    if (!ssd1306_init(&blit, WIDTH, HEIGHT, 0x3C, i2c0) ||
+        !ssd1306_init(&ref, WIDTH, HEIGHT, 0x3D, i2c0))
+    {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+
+    srand(1);
+    mismatches = compare(&drawn);
+    printf("compare: %lu glyphs drawn, %lu mismatches\n", drawn, mismatches);
+
+    printf("%-6s %10s %10s  (ns/glyph)\n", "scale", "blit", "per-pixel");
+    for (uint32_t scale = 1; scale <= MAX_SCALE; scale++)
+    {
+        double b = bench(ssd1306_draw_char_with_font, &blit, scale, rounds);
+        double r = bench(ref_draw_char, &ref, scale, rounds);
+
+        printf("%-6lu %10.1f %10.1f\n", (unsigned long)scale, b, r);
+    }
+
+    return mismatches != 0;
+}
@@ -0,0 +1,433 @@
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include "http_sim.h"
+
+/* Most handlers that can be registered */
+#define MAX_ROUTES (32)
+
+struct req
+{
+    enum http_method_t method;
+    const char *query;
+    size_t query_len;
+    const char *hdrs;
+};
+
+struct resp
+{
+    int status;
+    char hdrs[SIM_HTTP_HDRS_MAX];
+    size_t hdrs_len;
+    size_t len;
+    bool len_set;
+    bool chunked;
+    bool hdr_sent;
+};
+
+struct http
+{
+    struct req req;
+    struct resp resp;
+    sim_http_resp_t *out;
+};
+
+typedef struct route
+{
+    const char *path;
+    hndlr_f hndlr;
+    uint8_t methods;
+    void *priv;
+} route_t;
+
+static route_t routes[MAX_ROUTES];
+static unsigned nroutes;
+
+static void (*on_chunk)(void);
+
+/*
+ * handlers.c computes the free heap from the linker's symbols for the end
+ * of .bss and the stack limit. The host has no such memory map, so the
+ * figure is meaningless there.
+ */
+char __bss_end__, __StackLimit;
+
+struct server_cfg http_default_cfg(void)
+{
+    struct server_cfg cfg = {.idle_tmo_s = 5, .port = 80};
+
+    return cfg;
+}
+
+err_t register_hndlr_methods(struct server_cfg *cfg, const char *path,
+                             hndlr_f hndlr, uint8_t methods, void *priv)
+{
+    (void)cfg;
+
+    if (nroutes == MAX_ROUTES)
+    {
+        return ERR_MEM;
+    }
+    routes[nroutes++] = (route_t){path, hndlr, methods, priv};
+
+    return ERR_OK;
+}
+
+struct req *http_req(struct http *http)
+{
+    return &http->req;
+}
+
+struct resp *http_resp(struct http *http)
+{
+    return &http->resp;
+}
+
+enum http_method_t http_req_method(struct req *req)
+{
+    return req->method;
+}
+
+const uint8_t *http_req_query(struct req *req, size_t *len)
+{
+    if (req->query == NULL)
+    {
+        return NULL;
+    }
+    *len = req->query_len;
+
+    return (const uint8_t *)req->query;
+}
+
+const uint8_t *http_req_query_val(const uint8_t *const query,
+                                  size_t query_len,
+                                  const uint8_t *const name,
+                                  size_t name_len, size_t *val_len)
+{
+    size_t i = 0;
+
+    while (i < query_len)
+    {
+        size_t end = i;
+
+        while (end < query_len && query[end] != '&')
+        {
+            end++;
+        }
+        if (end - i >= name_len && memcmp(query + i, name, name_len) == 0 &&
+            (end - i == name_len || query[i + name_len] == '='))
+        {
+            size_t val = i + name_len + (end - i > name_len);
+
+            *val_len = end - val;
+            return query + val;
+        }
+        i = end + 1;
+    }
+
+    return NULL;
+}
+
+const char *http_req_hdr(struct req *req, const char *name,
+                         size_t name_len, size_t *val_len)
+{
+    const char *p = req->hdrs;
+
+    while (p != NULL && *p != '\0')
+    {
+        const char *eol = strstr(p, "\r\n");
+        const char *end = eol != NULL ? eol : p + strlen(p);
+
+        if ((size_t)(end - p) > name_len && p[name_len] == ':' &&
+            strncasecmp(p, name, name_len) == 0)
+        {
+            const char *val = p + name_len + 1;
+
+            while (val < end && (*val == ' ' || *val == '\t'))
+            {
+                val++;
+            }
+            while (end > val && (end[-1] == ' ' || end[-1] == '\t'))
+            {
+                end--;
+            }
+            *val_len = end - val;
+            return val;
+        }
+        p = eol != NULL ? eol + 2 : NULL;
+    }
+
+    return NULL;
+}
+
+bool http_req_hdr_eq(struct req *req, const char *name, size_t name_len,
+                     const char *val, size_t val_len)
+{
+    const char *v;
+    size_t len;
+
+    if ((v = http_req_hdr(req, name, name_len, &len)) == NULL)
+    {
+        return false;
+    }
+
+    return len == val_len && memcmp(v, val, len) == 0;
+}
+
+err_t http_resp_set_status(struct resp *resp, enum http_status_t status)
+{
+    if (resp->hdr_sent)
+    {
+        return ERR_VAL;
+    }
+    resp->status = status;
+
+    return ERR_OK;
+}
+
+err_t http_resp_set_hdr(struct resp *resp, const char *name,
+                        size_t name_len, const char *val, size_t val_len)
+{
+    size_t len = name_len + val_len + 4;
+
+    if (resp->hdr_sent || resp->hdrs_len + len >= sizeof resp->hdrs)
+    {
+        return ERR_VAL;
+    }
+    snprintf(resp->hdrs + resp->hdrs_len, len + 1, "%.*s: %.*s\r\n",
+             (int)name_len, name, (int)val_len, val);
+    resp->hdrs_len += len;
+
+    return ERR_OK;
+}
+
+err_t http_resp_set_len(struct resp *resp, size_t len)
+{
+    if (resp->hdr_sent || resp->chunked)
+    {
+        return ERR_VAL;
+    }
+    resp->len = len;
+    resp->len_set = true;
+
+    return ERR_OK;
+}
+
+err_t http_resp_set_type(struct resp *resp, const char *type,
+                         size_t type_len)
+{
+    return http_resp_set_hdr(resp, "Content-Type", STRLEN_LTRL("Content-Type"),
+                             type, type_len);
+}
+
+err_t http_resp_set_xfer_chunked(struct resp *resp)
+{
+    if (resp->hdr_sent || resp->len_set)
+    {
+        return ERR_VAL;
+    }
+    resp->chunked = true;
+
+    return http_resp_set_hdr_ltrl(resp, "Transfer-Encoding", "chunked");
+}
+
+err_t http_resp_send_hdr(struct http *http)
+{
+    struct resp *resp = &http->resp;
+    sim_http_resp_t *out = http->out;
+
+    if (resp->hdr_sent)
+    {
+        return ERR_VAL;
+    }
+    if (resp->len_set)
+    {
+        char len[24];
+
+        snprintf(len, sizeof len, "%zu", resp->len);
+        if (http_resp_set_hdr(resp, "Content-Length",
+                              STRLEN_LTRL("Content-Length"), len,
+                              strlen(len)) != ERR_OK)
+        {
+            return ERR_VAL;
+        }
+    }
+    resp->hdr_sent = true;
+
+    out->status = resp->status;
+    memcpy(out->hdrs, resp->hdrs, resp->hdrs_len + 1);
+
+    return ERR_OK;
+}
+
+static void append(sim_http_resp_t *out, const uint8_t *buf, size_t len)
+{
+    out->body = realloc(out->body, out->body_len + len + 1);
+    AN(out->body);
+    memcpy(out->body + out->body_len, buf, len);
+    out->body_len += len;
+    out->body[out->body_len] = '\0';
+}
+
+err_t http_resp_send_buf(struct http *http, const uint8_t *buf, size_t len,
+                         bool durable)
+{
+    struct resp *resp = &http->resp;
+    err_t err;
+    (void)durable;
+
+    if (resp->chunked)
+    {
+        return ERR_VAL;
+    }
+    if (!resp->hdr_sent && (err = http_resp_send_hdr(http)) != ERR_OK)
+    {
+        return err;
+    }
+    if (http->req.method == HTTP_METHOD_HEAD)
+    {
+        return ERR_OK;
+    }
+    // The client would wait for the rest of the body, or misread the next
+    if (resp->len_set && http->out->body_len + len > resp->len)
+    {
+        HTTP_LOG_ERROR("body exceeds Content-Length %zu", resp->len);
+        return ERR_VAL;
+    }
+    append(http->out, buf, len);
+
+    return ERR_OK;
+}
+
+err_t http_resp_send_chunk(struct http *http, const uint8_t *buf, size_t len,
+                           bool durable)
+{
+    struct resp *resp = &http->resp;
+    sim_http_resp_t *out = http->out;
+    err_t err;
+    (void)durable;
+
+    if (!resp->chunked || out->chunked_end)
+    {
+        return ERR_VAL;
+    }
+    if (!resp->hdr_sent && (err = http_resp_send_hdr(http)) != ERR_OK)
+    {
+        return err;
+    }
+    if (http->req.method == HTTP_METHOD_HEAD)
+    {
+        return ERR_OK;
+    }
+    if (len == 0)
+    {
+        out->chunked_end = true;
+        return ERR_OK;
+    }
+    append(out, buf, len);
+    out->chunks++;
+    if (on_chunk != NULL)
+    {
+        on_chunk();
+    }
+
+    return ERR_OK;
+}
+
+err_t http_resp_err(struct http *http, enum http_status_t status)
+{
+    struct resp *resp = &http->resp;
+    char body[32];
+    int len;
+
+    if (resp->hdr_sent)
+    {
+        return ERR_VAL;
+    }
+
+    // A fresh header, without the fields set for the failed response
+    resp->hdrs_len = 0;
+    resp->hdrs[0] = '\0';
+    resp->chunked = false;
+    resp->status = status;
+    len = snprintf(body, sizeof body, "%d\n", (int)status);
+    http_resp_set_type_ltrl(resp, "text/plain");
+    http_resp_set_len(resp, len);
+
+    return http_resp_send_buf(http, (const uint8_t *)body, len, false);
+}
+
+err_t sim_http_request(enum http_method_t method, const char *target,
+                       const char *hdrs, sim_http_resp_t *resp)
+{
+    struct http http = {
+        .req = {.method = method, .hdrs = hdrs},
+        .resp = {.status = HTTP_STATUS_OK},
+        .out = resp,
+    };
+    const char *q = strchr(target, '?');
+    size_t path_len = q != NULL ? (size_t)(q - target) : strlen(target);
+    const route_t *route = NULL;
+
+    memset(resp, 0, sizeof *resp);
+    if (q != NULL)
+    {
+        http.req.query = q + 1;
+        http.req.query_len = strlen(q + 1);
+    }
+
+    for (unsigned i = 0; i < nroutes; i++)
+    {
+        if (strlen(routes[i].path) == path_len &&
+            memcmp(routes[i].path, target, path_len) == 0)
+        {
+            route = &routes[i];
+            break;
+        }
+    }
+
+    if (route == NULL)
+    {
+        resp->err = http_resp_err(&http, HTTP_STATUS_NOT_FOUND);
+    }
+    else if (!(route->methods & (1U << method)))
+    {
+        resp->err = http_resp_err(&http, HTTP_STATUS_METHOD_NOT_ALLOWED);
+    }
+    else
+    {
+        resp->err = route->hndlr(&http, route->priv);
+    }
+
+    return resp->err;
+}
+
+const char *sim_http_resp_hdr(const sim_http_resp_t *resp, const char *name)
+{
+    static char val[SIM_HTTP_HDRS_MAX];
+    struct req req = {.hdrs = resp->hdrs};
+    const char *v;
+    size_t len;
+
+    if ((v = http_req_hdr(&req, name, strlen(name), &len)) == NULL)
+    {
+        return NULL;
+    }
+    memcpy(val, v, len);
+    val[len] = '\0';
+
+    return val;
+}
+
+void sim_http_resp_free(sim_http_resp_t *resp)
+{
+    free(resp->body);
+    resp->body = NULL;
+    resp->body_len = 0;
+}
+
+void sim_http_on_chunk(void (*fn)(void))
+{
+    on_chunk = fn;
+}
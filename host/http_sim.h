@@ -0,0 +1,63 @@
+#ifndef _HTTP_SIM_H
+#define _HTTP_SIM_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "picow_http/http.h"
+
+/*
+ * Requests to the custom handlers on the host, through the picow_http shim
+ * (see include/picow_http/http.h).
+ *
+ * Handlers are registered with register_hndlr_methods() as on the device.
+ * sim_http_request() runs the handler for a request, and captures the
+ * response as a client would receive it: status, header fields and body,
+ * with chunked encoding removed. A path without a handler gets status
+ * 404, a method not registered for the path 405, as from the server.
+ */
+
+/* Longest header of a captured response */
+#define SIM_HTTP_HDRS_MAX (1024)
+
+typedef struct sim_http_resp
+{
+    /* Return value of the handler */
+    err_t err;
+    /* Status, 0 if no header was sent */
+    int status;
+    /* Header fields, "Name: value\r\n" each, NUL-terminated */
+    char hdrs[SIM_HTTP_HDRS_MAX];
+    /* Body, with chunked encoding removed; allocated, NUL-terminated */
+    uint8_t *body;
+    size_t body_len;
+    /* Number of chunks, and whether the terminating empty one was sent */
+    unsigned chunks;
+    bool chunked_end;
+} sim_http_resp_t;
+
+/*
+ * Run the handler for a request with method, target ("/path?query") and
+ * header fields hdrs ("Name: value\r\n" each, or NULL), and capture the
+ * response in resp. Returns the handler's return value.
+ */
+err_t sim_http_request(enum http_method_t method, const char *target,
+                       const char *hdrs, sim_http_resp_t *resp);
+
+/*
+ * Value of header field name in resp, NUL-terminated in a static buffer,
+ * or NULL if it is not present.
+ */
+const char *sim_http_resp_hdr(const sim_http_resp_t *resp, const char *name);
+
+/* Free the body of resp. */
+void sim_http_resp_free(sim_http_resp_t *resp);
+
+/*
+ * Call fn after each chunk of a response has been sent, e.g. to change
+ * state that the handler reads while it sends. NULL for none.
+ */
+void sim_http_on_chunk(void (*fn)(void));
+
+#endif
@@ -0,0 +1,68 @@
+#ifndef _HOST_HARDWARE_DMA_H
+#define _HOST_HARDWARE_DMA_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Host shim of the SDK's dma API. Only transfers into an i2c data_cmd
+ * register are supported. They complete immediately, delivering the queued
+ * transactions to the simulated devices, or in steps in deferred mode (see
+ * sim_dma_defer() in host/sim.h).
+ */
+
+enum dma_channel_transfer_size
+{
+    DMA_SIZE_8 = 0,
+    DMA_SIZE_16 = 1,
+    DMA_SIZE_32 = 2
+};
+
+typedef struct
+{
+    enum dma_channel_transfer_size size;
+    bool read_incr;
+    bool write_incr;
+    unsigned int dreq;
+} dma_channel_config;
+
+int dma_claim_unused_channel(bool required);
+void dma_channel_unclaim(unsigned int channel);
+
+dma_channel_config dma_channel_get_default_config(unsigned int channel);
+
+static inline void channel_config_set_transfer_data_size(
+    dma_channel_config *c, enum dma_channel_transfer_size size)
+{
+    c->size = size;
+}
+
+static inline void channel_config_set_read_increment(dma_channel_config *c,
+                                                     bool incr)
+{
+    c->read_incr = incr;
+}
+
+static inline void channel_config_set_write_increment(dma_channel_config *c,
+                                                      bool incr)
+{
+    c->write_incr = incr;
+}
+
+static inline void channel_config_set_dreq(dma_channel_config *c,
+                                           unsigned int dreq)
+{
+    c->dreq = dreq;
+}
+
+void dma_channel_configure(unsigned int channel,
+                           const dma_channel_config *config,
+                           volatile void *write_addr,
+                           const volatile void *read_addr,
+                           unsigned int transfer_count, bool trigger);
+
+bool dma_channel_is_busy(unsigned int channel);
+
+void dma_channel_abort(unsigned int channel);
+
+#endif
@@ -0,0 +1,73 @@
+#ifndef _HOST_HARDWARE_I2C_H
+#define _HOST_HARDWARE_I2C_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "pico/error.h"
+
+/*
+ * Host shim of the SDK's i2c API. Transfers are delivered to the simulated
+ * devices attached with sim_i2c_attach() (see host/sim.h).
+ *
+ * The register block only models what the drivers touch directly: the
+ * target address, and data_cmd words (byte | STOP) queued by dma.
+ */
+typedef struct
+{
+    uint32_t enable;
+    uint32_t tar;
+    uint32_t data_cmd;
+    uint32_t status;
+    uint32_t raw_intr_stat;
+    uint32_t clr_tx_abrt;
+    uint32_t dma_cr;
+} i2c_hw_t;
+
+typedef struct i2c_inst
+{
+    i2c_hw_t *hw;
+    bool restart_on_next;
+} i2c_inst_t;
+
+extern i2c_inst_t i2c0_inst;
+extern i2c_inst_t i2c1_inst;
+
+#define i2c0 (&i2c0_inst)
+#define i2c1 (&i2c1_inst)
+#define i2c_default i2c0
+
+#define I2C_IC_DATA_CMD_STOP_BITS 0x00000200u
+#define I2C_IC_ENABLE_ABORT_BITS 0x00000002u
+#define I2C_IC_STATUS_ACTIVITY_BITS 0x00000001u
+#define I2C_IC_STATUS_TFE_BITS 0x00000004u
+#define I2C_IC_RAW_INTR_STAT_TX_ABRT_BITS 0x00000040u
+
+unsigned int i2c_init(i2c_inst_t *i2c, unsigned int baudrate);
+
+int i2c_write_blocking(i2c_inst_t *i2c, uint8_t addr, const uint8_t *src,
+                       size_t len, bool nostop);
+int i2c_read_blocking(i2c_inst_t *i2c, uint8_t addr, uint8_t *dst,
+                      size_t len, bool nostop);
+int i2c_write_timeout_us(i2c_inst_t *i2c, uint8_t addr, const uint8_t *src,
+                         size_t len, bool nostop, unsigned int timeout_us);
+int i2c_read_timeout_us(i2c_inst_t *i2c, uint8_t addr, uint8_t *dst,
+                        size_t len, bool nostop, unsigned int timeout_us);
+
+static inline i2c_hw_t *i2c_get_hw(i2c_inst_t *i2c)
+{
+    return i2c->hw;
+}
+
+static inline unsigned int i2c_hw_index(i2c_inst_t *i2c)
+{
+    return i2c == i2c1 ? 1 : 0;
+}
+
+static inline unsigned int i2c_get_dreq(i2c_inst_t *i2c, bool is_tx)
+{
+    return i2c_hw_index(i2c) * 2 + (is_tx ? 0 : 1);
+}
+
+#endif
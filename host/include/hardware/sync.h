@@ -0,0 +1,16 @@
+#ifndef _HOST_HARDWARE_SYNC_H
+#define _HOST_HARDWARE_SYNC_H
+
+/*
+ * Host shim of the SDK's processor events. As on the device, an event sets
+ * a latch that the next wait clears, and ends that wait at once if it is
+ * set.
+ */
+
+/* Send an event. */
+void __sev(void);
+
+/* Wait for an event; returns at once on the host, clearing the latch. */
+void __wfe(void);
+
+#endif
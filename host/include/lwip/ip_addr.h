@@ -0,0 +1,7 @@
+#ifndef _HOST_LWIP_IP_ADDR_H
+#define _HOST_LWIP_IP_ADDR_H
+
+/* Host shim of lwIP's address definitions, for an IPv4-only stack. */
+#define IPADDR_STRLEN_MAX (16)
+
+#endif
@@ -0,0 +1,6 @@
+#ifndef _HOST_PICO_BINARY_INFO_H
+#define _HOST_PICO_BINARY_INFO_H
+
+/* Binary info is only meaningful in an RP2040 image. */
+
+#endif
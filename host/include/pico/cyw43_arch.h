@@ -0,0 +1,13 @@
+#ifndef _HOST_PICO_CYW43_ARCH_H
+#define _HOST_PICO_CYW43_ARCH_H
+
+/*
+ * Host shim of pico/cyw43_arch.h. There is no wifi chip on the host: the
+ * code built for it only needs the SDK and lwIP definitions that the
+ * header pulls in.
+ */
+#include "pico/stdlib.h"
+#include "lwip/err.h"
+#include "lwip/ip_addr.h"
+
+#endif
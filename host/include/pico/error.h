@@ -0,0 +1,13 @@
+#ifndef _HOST_PICO_ERROR_H
+#define _HOST_PICO_ERROR_H
+
+enum pico_error_codes
+{
+    PICO_OK = 0,
+    PICO_ERROR_NONE = 0,
+    PICO_ERROR_TIMEOUT = -1,
+    PICO_ERROR_GENERIC = -2,
+    PICO_ERROR_NO_DATA = -3,
+};
+
+#endif
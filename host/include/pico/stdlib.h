@@ -0,0 +1,87 @@
+#ifndef _HOST_PICO_STDLIB_H
+#define _HOST_PICO_STDLIB_H
+
+/*
+ * Host shim of the subset of the Pico SDK used by the drivers and the
+ * portable modules. Time is taken from the host's monotonic clock.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "hardware/i2c.h"
+
+#define count_of(a) (sizeof(a) / sizeof((a)[0]))
+
+#define __time_critical_func(f) f
+#define __not_in_flash_func(f) f
+/* Host memory is zeroed, so a cache in such a variable is always cold. */
+#define __uninitialized_ram(group) group
+
+typedef uint64_t absolute_time_t;
+
+uint64_t time_us_64(void);
+uint32_t time_us_32(void);
+
+static inline absolute_time_t get_absolute_time(void)
+{
+    return time_us_64();
+}
+
+static inline uint32_t to_ms_since_boot(absolute_time_t t)
+{
+    return (uint32_t)(t / 1000);
+}
+
+static inline uint64_t to_us_since_boot(absolute_time_t t)
+{
+    return t;
+}
+
+static inline int64_t absolute_time_diff_us(absolute_time_t from,
+                                            absolute_time_t to)
+{
+    return (int64_t)(to - from);
+}
+
+static inline absolute_time_t delayed_by_us(absolute_time_t t, uint64_t us)
+{
+    return t + us;
+}
+
+static inline absolute_time_t make_timeout_time_us(uint64_t us)
+{
+    return delayed_by_us(get_absolute_time(), us);
+}
+
+static inline absolute_time_t make_timeout_time_ms(uint32_t ms)
+{
+    return delayed_by_us(get_absolute_time(), (uint64_t)ms * 1000);
+}
+
+void sleep_us(uint64_t us);
+void sleep_ms(uint32_t ms);
+void sleep_until(absolute_time_t t);
+
+/*
+ * An event sent with __sev() before or during the wait ends it early, as
+ * WFE does (see include/hardware/sync.h). Otherwise the wait times out.
+ */
+bool best_effort_wfe_or_timeout(absolute_time_t t);
+
+/* stdio goes to the host's stdout. */
+static inline bool stdio_init_all(void)
+{
+    return true;
+}
+
+/* Time passes for the simulated peripherals in busy-wait loops. */
+void sim_tick(void);
+
+static inline void tight_loop_contents(void)
+{
+    sim_tick();
+}
+
+#endif
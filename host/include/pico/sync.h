@@ -0,0 +1,36 @@
+#ifndef _HOST_PICO_SYNC_H
+#define _HOST_PICO_SYNC_H
+
+#include <pthread.h>
+
+/*
+ * Host shim of the SDK's critical sections. There are no interrupts to
+ * disable, so a critical section is a mutex, which also serves the tests
+ * that run the two sides of a lock in separate threads.
+ */
+typedef struct
+{
+    pthread_mutex_t mutex;
+} critical_section_t;
+
+static inline void critical_section_init(critical_section_t *crit_sec)
+{
+    pthread_mutex_init(&crit_sec->mutex, NULL);
+}
+
+static inline void critical_section_enter_blocking(critical_section_t *crit_sec)
+{
+    pthread_mutex_lock(&crit_sec->mutex);
+}
+
+static inline void critical_section_exit(critical_section_t *crit_sec)
+{
+    pthread_mutex_unlock(&crit_sec->mutex);
+}
+
+static inline void critical_section_deinit(critical_section_t *crit_sec)
+{
+    pthread_mutex_destroy(&crit_sec->mutex);
+}
+
+#endif
@@ -0,0 +1,36 @@
+#ifndef _HOST_PICOW_HTTP_ASSERTION_H
+#define _HOST_PICOW_HTTP_ASSERTION_H
+
+#include <assert.h>
+#include <string.h>
+
+/*
+ * Host shim of picow_http's assertions and the "magic number" idiom, as in
+ * a debug build of the library.
+ */
+
+#define AN(x) assert((x) != 0)
+#define AZ(x) assert((x) == 0)
+
+#define INIT_OBJ(to, type_magic)             \
+    do                                       \
+    {                                        \
+        memset((to), 0, sizeof *(to));       \
+        (to)->magic = (type_magic);          \
+    } while (0)
+
+#define CHECK_OBJ_NOTNULL(ptr, type_magic)   \
+    do                                       \
+    {                                        \
+        assert((ptr) != NULL);               \
+        assert((ptr)->magic == (type_magic)); \
+    } while (0)
+
+#define CAST_OBJ_NOTNULL(to, from, type_magic) \
+    do                                         \
+    {                                          \
+        (to) = (from);                         \
+        CHECK_OBJ_NOTNULL((to), (type_magic)); \
+    } while (0)
+
+#endif
@@ -0,0 +1,121 @@
+#ifndef _HOST_PICOW_HTTP_HTTP_H
+#define _HOST_PICOW_HTTP_HTTP_H
+
+/*
+ * Host shim of the subset of picow_http's public API used by the custom
+ * handlers, with the library's names, signatures and semantics. Requests
+ * are not parsed from a connection: a test builds one and runs the
+ * registered handler with sim_http_request(), and the response is
+ * captured as a client would receive it (see host/http_sim.h).
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "lwip/err.h"
+
+#include "picow_http/assertion.h"
+#include "picow_http/log.h"
+
+/* Length of a string literal, without the terminating NUL. */
+#define STRLEN_LTRL(s) (sizeof(s) - 1)
+
+/* 1 for true, 0 for false, e.g. to index an array of two strings. */
+#define bool_to_bit(b) ((b) ? 1 : 0)
+
+struct http;
+struct req;
+struct resp;
+struct server;
+
+enum http_method_t
+{
+    HTTP_METHOD_GET = 0,
+    HTTP_METHOD_HEAD,
+    HTTP_METHOD_POST,
+    HTTP_METHOD_PUT,
+    HTTP_METHOD_DELETE,
+    HTTP_METHOD_CONNECT,
+    HTTP_METHOD_OPTIONS,
+    HTTP_METHOD_TRACE,
+    HTTP_METHOD_PATCH,
+    __HTTP_METHOD_MAX,
+};
+
+/* Bitmap of the methods for which a handler is registered. */
+#define HTTP_METHODS_GET_HEAD \
+    ((1U << HTTP_METHOD_GET) | (1U << HTTP_METHOD_HEAD))
+
+enum http_status_t
+{
+    HTTP_STATUS_OK = 200,
+    HTTP_STATUS_NO_CONTENT = 204,
+    HTTP_STATUS_NOT_MODIFIED = 304,
+    HTTP_STATUS_BAD_REQUEST = 400,
+    HTTP_STATUS_NOT_FOUND = 404,
+    HTTP_STATUS_METHOD_NOT_ALLOWED = 405,
+    HTTP_STATUS_NOT_ACCEPTABLE = 406,
+    HTTP_STATUS_INTERNAL_SERVER_ERROR = 500,
+    HTTP_STATUS_NOT_IMPLEMENTED = 501,
+    HTTP_STATUS_SERVICE_UNAVAILABLE = 503,
+};
+
+typedef err_t (*hndlr_f)(struct http *http, void *priv);
+
+struct ntp_cfg
+{
+    const char *server;
+};
+
+struct server_cfg
+{
+    unsigned idle_tmo_s;
+    uint16_t port;
+    struct ntp_cfg ntp_cfg;
+};
+
+struct server_cfg http_default_cfg(void);
+
+err_t register_hndlr_methods(struct server_cfg *cfg, const char *path,
+                             hndlr_f hndlr, uint8_t methods, void *priv);
+
+struct req *http_req(struct http *http);
+struct resp *http_resp(struct http *http);
+
+enum http_method_t http_req_method(struct req *req);
+
+const uint8_t *http_req_query(struct req *req, size_t *len);
+const uint8_t *http_req_query_val(const uint8_t *const query,
+                                  size_t query_len,
+                                  const uint8_t *const name,
+                                  size_t name_len, size_t *val_len);
+
+const char *http_req_hdr(struct req *req, const char *name,
+                         size_t name_len, size_t *val_len);
+bool http_req_hdr_eq(struct req *req, const char *name, size_t name_len,
+                     const char *val, size_t val_len);
+
+err_t http_resp_set_status(struct resp *resp, enum http_status_t status);
+err_t http_resp_set_hdr(struct resp *resp, const char *name,
+                        size_t name_len, const char *val, size_t val_len);
+err_t http_resp_set_len(struct resp *resp, size_t len);
+err_t http_resp_set_type(struct resp *resp, const char *type,
+                         size_t type_len);
+err_t http_resp_set_xfer_chunked(struct resp *resp);
+
+#define http_resp_set_hdr_ltrl(resp, name, val) \
+    http_resp_set_hdr((resp), (name), STRLEN_LTRL(name), (val), \
+                      STRLEN_LTRL(val))
+#define http_resp_set_type_ltrl(resp, type) \
+    http_resp_set_type((resp), (type), STRLEN_LTRL(type))
+
+err_t http_resp_send_hdr(struct http *http);
+err_t http_resp_send_buf(struct http *http, const uint8_t *buf, size_t len,
+                         bool durable);
+err_t http_resp_send_chunk(struct http *http, const uint8_t *buf, size_t len,
+                           bool durable);
+err_t http_resp_err(struct http *http, enum http_status_t status);
+
+#endif
@@ -0,0 +1,195 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "pico/stdlib.h"
+
+#include <bme280.h>
+#include <ssd1306.h>
+
+#include "acquire.h"
+#include "display.h"
+#include "profiles.h"
+#include "sensors.h"
+#include "sim.h"
+
+/*
+ * Host build of core1's acquisition loop (see acquire.h): the bme280 and
+ * ssd1306 drivers run against simulated devices, so that the per-sample
+ * work can be profiled and compared between changes. The clock is fast
+ * forwarded through the sleeps, so the loop runs at full speed on the
+ * schedule of the default profile. The primary sensor and the display are
+ * on i2c0, a second sensor is on i2c1; the figures are per round, in which
+ * every sensor is read once. The display task runs without a frame
+ * interval, so that each round is shown.
+ *
+ * Usage: pico-meteo-host [samples]
+ */
+
+#define DEFAULT_SAMPLES (100000)
+
+static const char *stage_name[ACQUIRE_STAGES] = {
+    "wait", "sensor read", "history", "display",
+};
+
+static ssd1306_t display;
+
+static sim_bme280_t sim_sensor, sim_probe;
+static sim_ssd1306_t sim_display;
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t)ts.tv_sec * 1000000000 + (uint64_t)ts.tv_nsec;
+}
+
+/* Time spent in each stage of acquire_step() */
+static uint64_t stage_ns[ACQUIRE_STAGES];
+static uint64_t stage_start;
+
+static void stage_end(acquire_stage_t stage)
+{
+    uint64_t t = now_ns();
+
+    stage_ns[stage] += t - stage_start;
+    stage_start = t;
+}
+
+/* Slow random walk around room conditions. */
+static int32_t walk(int32_t v, int32_t step, int32_t lo, int32_t hi)
+{
+    v += rand() % (2 * step + 1) - step;
+
+    return v < lo ? lo : v > hi ? hi : v;
+}
+
+/* The frame last sent must be in the display ram. */
+static bool display_in_sync(void)
+{
+    for (uint32_t pg = 0; pg < display.pages; pg++)
+    {
+        if (memcmp(sim_display.ram[pg], display.buffer + pg * display.width,
+                   display.width) != 0)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    unsigned long samples = argc > 1 ? strtoul(argv[1], NULL, 0)
+                                     : DEFAULT_SAMPLES;
+    const acquire_hooks_t hooks = {.stage_end = stage_end};
+    sim_i2c_stats_t bus0, bus1, probe0, probe1;
+    int32_t raw_t = 519888, raw_p = 415148, raw_h = 27000;
+    unsigned long failed = 0;
+    display_stats_t ds;
+    unsigned n;
+
+    i2c_init(i2c_default, 1000000);
+    i2c_init(i2c1, 400 * 1000);
+    sim_bme280_init(&sim_sensor, 0x76);
+    sim_bme280_init(&sim_probe, 0x77);
+    sim_ssd1306_init(&sim_display, 0x3C);
+    sim_i2c_attach(i2c_default, &sim_sensor.dev);
+    sim_i2c_attach(i2c_default, &sim_display.dev);
+    sim_i2c_attach(i2c1, &sim_probe.dev);
+    sim_clock_fast_forward(true);
+
+    ssd1306_init(&display, 128, 32, 0x3C, i2c_default);
+    display_init(&display, 0);
+    sim_bme280_set_raw(&sim_sensor, raw_t, raw_p, raw_h);
+    sim_bme280_set_raw(&sim_probe, raw_t, raw_p, raw_h);
+    if ((n = sensors_init(profiles_active())) != 2)
+    {
+        fprintf(stderr, "sensors_init found %u sensors\n", n);
+        return 1;
+    }
+    acquire_init();
+    acquire_start();
+
+    srand(1);
+    sim_i2c_stats(i2c_default, &bus0);
+    sim_i2c_stats(i2c1, &probe0);
+    for (unsigned long i = 0; i < samples; i++)
+    {
+        raw_t = walk(raw_t, 16, 400000, 600000);
+        raw_p = walk(raw_p, 16, 300000, 500000);
+        raw_h = walk(raw_h, 8, 20000, 40000);
+        sim_bme280_set_raw(&sim_sensor, raw_t, raw_p, raw_h);
+        sim_bme280_set_raw(&sim_probe, raw_t, raw_p, raw_h);
+
+        // One step per sensor, as on core1
+        for (unsigned id = 0; id < n; id++)
+        {
+            stage_start = now_ns();
+            acquire_step(&hooks);
+        }
+    }
+    sim_i2c_stats(i2c_default, &bus1);
+    sim_i2c_stats(i2c1, &probe1);
+
+    if (samples == 0)
+    {
+        return 0;
+    }
+
+    bus1.xfers -= bus0.xfers;
+    bus1.bytes -= bus0.bytes;
+    probe1.xfers -= probe0.xfers;
+    probe1.bytes -= probe0.bytes;
+
+    for (unsigned id = 0; id < n; id++)
+    {
+        sensor_stats_t st;
+
+        sensors_stats(id, &st);
+        failed += st.failures;
+    }
+    display_stats(&ds);
+
+    printf("%lu rounds of %u sensors, %lu failed reads, %lu frames\n",
+           samples, n, failed, (unsigned long)ds.frames);
+    for (int s = 0; s < ACQUIRE_STAGES; s++)
+    {
+        printf("%-12s %10.1f ns/sample\n", stage_name[s],
+               (double)stage_ns[s] / samples);
+    }
+    printf("i2c          %10.1f bytes/sample, %.1f us/sample on the wire\n",
+           (double)(bus1.xfers + bus1.bytes) / samples,
+           (double)sim_i2c_wire_us(i2c_default, &bus1) / samples);
+    printf("i2c1         %10.1f bytes/sample, %.1f us/sample on the wire\n",
+           (double)(probe1.xfers + probe1.bytes) / samples,
+           (double)sim_i2c_wire_us(i2c1, &probe1) / samples);
+
+    for (unsigned id = 0; id < n; id++)
+    {
+        sensor_stats_t st;
+
+        sensors_stats(id, &st);
+        printf("bme280 %u     %10.2f us/read in i2c calls, %lu us measurement\n",
+               id, (double)st.bus_us_total / (st.reads + st.failures),
+               (unsigned long)st.meas_us);
+    }
+
+    uint32_t first, last;
+    if (get_history_span(&first, &last))
+    {
+        printf("history      %10lu blocks\n", (unsigned long)(last - first + 1));
+    }
+
+    if (!display_in_sync())
+    {
+        fprintf(stderr, "display ram does not match the frame buffer\n");
+        return 1;
+    }
+
+    return 0;
+}
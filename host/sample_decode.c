@@ -0,0 +1,71 @@
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "sample_bin.h"
+#include "utils.h"
+
+/*
+ * Decoder of the binary sample representation (see sample_bin.h), e.g. for
+ * a collector to convert the body of /sensor.bin or /history.bin:
+ *
+ *     curl -s http://pico-meteo:8091/history.bin | sample-decode
+ *
+ * Prints one line per sample: seq (0 for /sensor.bin), ts, temperature in
+ * degrees C, humidity in %RH and pressure in hPa, separated by commas.
+ *
+ * Usage: sample-decode [file]
+ */
+
+/* Largest body that is read */
+#define BODY_MAX (4 * 1024 * 1024)
+
+int main(int argc, char **argv)
+{
+    FILE *f = stdin;
+    uint8_t *body;
+    history_sample_t *samples;
+    size_t len;
+    int n;
+
+    if (argc > 1 && (f = fopen(argv[1], "rb")) == NULL)
+    {
+        perror(argv[1]);
+        return 1;
+    }
+    if ((body = malloc(BODY_MAX)) == NULL)
+    {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    len = fread(body, 1, BODY_MAX, f);
+
+    // Count the records first, then decode them all
+    if ((n = sample_bin_decode(body, len, NULL, 0)) < 0)
+    {
+        fprintf(stderr, "not a valid sample body (%zu bytes)\n", len);
+        return 1;
+    }
+    if ((samples = malloc((n + 1) * sizeof *samples)) == NULL)
+    {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    sample_bin_decode(body, len, samples, n);
+
+    for (int i = 0; i < n; i++)
+    {
+        char t[FMT_CENTI_MAX + 1], h[FMT_CENTI_MAX + 1], p[FMT_CENTI_MAX + 1];
+
+        *fmt_centi(t, samples[i].temperature) = '\0';
+        *fmt_centi(h, (int32_t)samples[i].humidity) = '\0';
+        *fmt_centi(p, (int32_t)samples[i].pressure) = '\0';
+        printf("%" PRIu32 ",%" PRIu32 ",%s,%s,%s\n", samples[i].seq,
+               samples[i].ts, t, h, p);
+    }
+
+    free(samples);
+    free(body);
+
+    return 0;
+}
@@ -0,0 +1,437 @@
+#include <string.h>
+#include <time.h>
+
+#include "pico/stdlib.h"
+#include "hardware/dma.h"
+#include "hardware/sync.h"
+
+#include "sim.h"
+
+/* Number of dma channels on the RP2040 */
+#define NUM_DMA_CHANNELS (12)
+
+typedef struct sim_bus
+{
+    i2c_hw_t hw;
+    unsigned int baudrate;
+    sim_i2c_dev_t *devs;
+    sim_i2c_stats_t stats;
+    /* Bytes of the transaction fed by dma so far, sent at its STOP */
+    uint8_t tx[1024];
+    size_t tx_len;
+} sim_bus_t;
+
+/* A dma transfer into a data_cmd register */
+typedef struct sim_dma
+{
+    sim_bus_t *bus;
+    /* The words are read as they are fed, not when the transfer starts */
+    const volatile uint16_t *words;
+    unsigned int count;
+    unsigned int pos;
+    /* A NACK stopped the transfer, until the channel is aborted */
+    bool stalled;
+} sim_dma_t;
+
+static sim_bus_t buses[2];
+
+i2c_inst_t i2c0_inst = {&buses[0].hw, false};
+i2c_inst_t i2c1_inst = {&buses[1].hw, false};
+
+static uint16_t dma_claimed;
+
+static bool fast_forward;
+/* Time skipped by sleeps in fast_forward mode */
+static uint64_t skipped_us;
+
+/* The event register, set by __sev() and cleared by a wait */
+static bool event;
+
+static sim_dma_t dma[NUM_DMA_CHANNELS];
+/* Whether dma transfers wait for sim_dma_advance() or sim_tick() */
+static bool dma_defer;
+
+/* The drivers copy i2c_inst_t, so the bus is identified by its registers. */
+static sim_bus_t *bus_of_hw(const volatile void *hw)
+{
+    for (size_t i = 0; i < count_of(buses); i++)
+    {
+        if ((const volatile void *)&buses[i].hw == hw ||
+            (const volatile void *)&buses[i].hw.data_cmd == hw)
+        {
+            return &buses[i];
+        }
+    }
+
+    return NULL;
+}
+
+static sim_i2c_dev_t *find_dev(sim_bus_t *bus, uint8_t addr)
+{
+    for (sim_i2c_dev_t *dev = bus->devs; dev != NULL; dev = dev->next)
+    {
+        if (dev->addr == addr)
+        {
+            return dev;
+        }
+    }
+
+    return NULL;
+}
+
+static int xfer(i2c_inst_t *i2c, uint8_t addr, uint8_t *buf, size_t len,
+                bool read)
+{
+    sim_bus_t *bus = bus_of_hw(i2c->hw);
+    sim_i2c_dev_t *dev;
+
+    bus->stats.xfers++;
+    if ((dev = find_dev(bus, addr)) == NULL)
+    {
+        return PICO_ERROR_GENERIC;
+    }
+
+    bus->stats.bytes += len;
+    if (read ? !dev->read(dev, buf, len) : !dev->write(dev, buf, len))
+    {
+        return PICO_ERROR_GENERIC;
+    }
+
+    return (int)len;
+}
+
+void sim_i2c_attach(i2c_inst_t *i2c, sim_i2c_dev_t *dev)
+{
+    sim_bus_t *bus = bus_of_hw(i2c->hw);
+
+    dev->next = bus->devs;
+    bus->devs = dev;
+}
+
+void sim_i2c_stats(i2c_inst_t *i2c, sim_i2c_stats_t *stats)
+{
+    *stats = bus_of_hw(i2c->hw)->stats;
+}
+
+uint64_t sim_i2c_wire_us(i2c_inst_t *i2c, const sim_i2c_stats_t *stats)
+{
+    sim_bus_t *bus = bus_of_hw(i2c->hw);
+    uint64_t clocks = (stats->xfers + stats->bytes) * 9;
+
+    if (bus->baudrate == 0)
+    {
+        return 0;
+    }
+
+    return clocks * 1000000 / bus->baudrate;
+}
+
+unsigned int i2c_init(i2c_inst_t *i2c, unsigned int baudrate)
+{
+    sim_bus_t *bus = bus_of_hw(i2c->hw);
+
+    bus->baudrate = baudrate;
+    bus->hw.enable = 1;
+    bus->hw.status = I2C_IC_STATUS_TFE_BITS;
+
+    return baudrate;
+}
+
+/* Count a blocking transaction started while a dma transfer is on the bus */
+static void check_collision(i2c_inst_t *i2c)
+{
+    sim_bus_t *bus = bus_of_hw(i2c->hw);
+
+    for (unsigned int ch = 0; ch < NUM_DMA_CHANNELS; ch++)
+    {
+        if (dma[ch].bus == bus && dma_channel_is_busy(ch))
+        {
+            bus->stats.collisions++;
+            return;
+        }
+    }
+}
+
+int i2c_write_blocking(i2c_inst_t *i2c, uint8_t addr, const uint8_t *src,
+                       size_t len, bool nostop)
+{
+    (void)nostop;
+    check_collision(i2c);
+    return xfer(i2c, addr, (uint8_t *)src, len, false);
+}
+
+int i2c_read_blocking(i2c_inst_t *i2c, uint8_t addr, uint8_t *dst,
+                      size_t len, bool nostop)
+{
+    (void)nostop;
+    check_collision(i2c);
+    return xfer(i2c, addr, dst, len, true);
+}
+
+int i2c_write_timeout_us(i2c_inst_t *i2c, uint8_t addr, const uint8_t *src,
+                         size_t len, bool nostop, unsigned int timeout_us)
+{
+    (void)timeout_us;
+    return i2c_write_blocking(i2c, addr, src, len, nostop);
+}
+
+int i2c_read_timeout_us(i2c_inst_t *i2c, uint8_t addr, uint8_t *dst,
+                        size_t len, bool nostop, unsigned int timeout_us)
+{
+    (void)timeout_us;
+    return i2c_read_blocking(i2c, addr, dst, len, nostop);
+}
+
+int dma_claim_unused_channel(bool required)
+{
+    (void)required;
+
+    for (int ch = 0; ch < NUM_DMA_CHANNELS; ch++)
+    {
+        if (!(dma_claimed & (1u << ch)))
+        {
+            dma_claimed |= 1u << ch;
+            return ch;
+        }
+    }
+
+    return -1;
+}
+
+void dma_channel_unclaim(unsigned int channel)
+{
+    dma_claimed &= ~(1u << channel);
+}
+
+dma_channel_config dma_channel_get_default_config(unsigned int channel)
+{
+    dma_channel_config c = {DMA_SIZE_32, true, false, 0};
+    (void)channel;
+
+    return c;
+}
+
+/*
+ * Send the bytes of the transaction fed so far. Like the controller, flag
+ * TX_ABRT on a NACK.
+ */
+static bool send_tx(sim_bus_t *bus)
+{
+    i2c_inst_t i2c = {&bus->hw, false};
+    bool ok = xfer(&i2c, (uint8_t)bus->hw.tar, bus->tx, bus->tx_len, false) >= 0;
+
+    if (!ok)
+    {
+        bus->hw.raw_intr_stat |= I2C_IC_RAW_INTR_STAT_TX_ABRT_BITS;
+    }
+    bus->tx_len = 0;
+
+    return ok;
+}
+
+/*
+ * Feed up to n words of a transfer to the controller, one transaction per
+ * STOP. After a NACK the controller flushes the words, and the transfer
+ * stalls until it is aborted.
+ */
+static void feed(sim_dma_t *d, unsigned int n)
+{
+    sim_bus_t *bus = d->bus;
+
+    while (n-- > 0 && d->pos < d->count && !d->stalled)
+    {
+        uint16_t w = d->words[d->pos++];
+
+        if (bus->tx_len < sizeof bus->tx)
+        {
+            bus->tx[bus->tx_len++] = (uint8_t)w;
+        }
+        if (((w & I2C_IC_DATA_CMD_STOP_BITS) || d->pos == d->count) &&
+            !send_tx(bus))
+        {
+            d->stalled = true;
+        }
+    }
+}
+
+void sim_dma_defer(bool on)
+{
+    dma_defer = on;
+}
+
+const volatile uint16_t *sim_dma_pending(unsigned int channel,
+                                         unsigned int *count)
+{
+    sim_dma_t *d = &dma[channel];
+
+    if (!dma_channel_is_busy(channel))
+    {
+        return NULL;
+    }
+    *count = d->count - d->pos;
+
+    return d->words + d->pos;
+}
+
+void sim_dma_advance(unsigned int channel, unsigned int words)
+{
+    if (dma_channel_is_busy(channel))
+    {
+        feed(&dma[channel], words);
+    }
+}
+
+void sim_tick(void)
+{
+    // A requested abort completes: STOP after the byte in progress
+    for (size_t i = 0; i < count_of(buses); i++)
+    {
+        sim_bus_t *bus = &buses[i];
+
+        if (bus->hw.enable & I2C_IC_ENABLE_ABORT_BITS)
+        {
+            if (bus->tx_len > 0)
+            {
+                send_tx(bus);
+            }
+            bus->hw.raw_intr_stat &= ~I2C_IC_RAW_INTR_STAT_TX_ABRT_BITS;
+            bus->hw.enable &= ~I2C_IC_ENABLE_ABORT_BITS;
+        }
+    }
+
+    for (unsigned int ch = 0; ch < NUM_DMA_CHANNELS; ch++)
+    {
+        sim_dma_advance(ch, dma[ch].count);
+    }
+}
+
+void dma_channel_configure(unsigned int channel,
+                           const dma_channel_config *config,
+                           volatile void *write_addr,
+                           const volatile void *read_addr,
+                           unsigned int transfer_count, bool trigger)
+{
+    sim_bus_t *bus = bus_of_hw(write_addr);
+    sim_dma_t *d = &dma[channel];
+
+    if (!trigger || bus == NULL || config->size != DMA_SIZE_16)
+    {
+        return;
+    }
+    d->bus = bus;
+    d->words = read_addr;
+    d->count = transfer_count;
+    d->pos = 0;
+    d->stalled = false;
+    bus->tx_len = 0;
+
+    if (!dma_defer)
+    {
+        feed(d, transfer_count);
+    }
+}
+
+bool dma_channel_is_busy(unsigned int channel)
+{
+    const sim_dma_t *d = &dma[channel];
+
+    return d->words != NULL && d->pos < d->count;
+}
+
+void dma_channel_abort(unsigned int channel)
+{
+    sim_dma_t *d = &dma[channel];
+
+    // The words not yet fed are dropped. The transaction in progress is
+    // cut short by an abort of the controller (see sim_tick()), or was
+    // flushed by a NACK.
+    d->words = NULL;
+    if (d->bus != NULL && d->stalled)
+    {
+        d->bus->tx_len = 0;
+    }
+
+    // Stands in for the read of clr_tx_abrt that follows it in the drivers
+    if (d->bus != NULL)
+    {
+        d->bus->hw.raw_intr_stat &= ~I2C_IC_RAW_INTR_STAT_TX_ABRT_BITS;
+    }
+}
+
+uint64_t time_us_64(void)
+{
+    static uint64_t boot_us;
+    struct timespec ts;
+    uint64_t now;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    now = (uint64_t)ts.tv_sec * 1000000 + (uint64_t)ts.tv_nsec / 1000;
+    if (boot_us == 0)
+    {
+        boot_us = now;
+    }
+
+    return now - boot_us + skipped_us;
+}
+
+void sim_clock_fast_forward(bool on)
+{
+    fast_forward = on;
+}
+
+uint32_t time_us_32(void)
+{
+    return (uint32_t)time_us_64();
+}
+
+void sleep_us(uint64_t us)
+{
+    if (fast_forward)
+    {
+        skipped_us += us;
+        return;
+    }
+
+    struct timespec ts = {
+        .tv_sec = (time_t)(us / 1000000),
+        .tv_nsec = (long)(us % 1000000) * 1000,
+    };
+
+    nanosleep(&ts, NULL);
+}
+
+void sleep_ms(uint32_t ms)
+{
+    sleep_us((uint64_t)ms * 1000);
+}
+
+void sleep_until(absolute_time_t t)
+{
+    uint64_t now = time_us_64();
+
+    if (t > now)
+    {
+        sleep_us(t - now);
+    }
+}
+
+void __sev(void)
+{
+    __atomic_store_n(&event, true, __ATOMIC_RELEASE);
+}
+
+void __wfe(void)
+{
+    __atomic_store_n(&event, false, __ATOMIC_RELEASE);
+}
+
+bool best_effort_wfe_or_timeout(absolute_time_t t)
+{
+    if (__atomic_exchange_n(&event, false, __ATOMIC_ACQ_REL))
+    {
+        return false;
+    }
+    sleep_until(t);
+
+    return true;
+}
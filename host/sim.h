@@ -0,0 +1,129 @@
+#ifndef _SIM_H
+#define _SIM_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "hardware/i2c.h"
+
+/*
+ * Simulated i2c devices for the host build.
+ *
+ * Each transaction on a bus (a blocking write or read, or a STOP-terminated
+ * sequence of data_cmd words written by dma) is delivered to the device
+ * attached at the target address. Unattached addresses are not
+ * acknowledged, as on real hardware.
+ */
+typedef struct sim_i2c_dev
+{
+    uint8_t addr;
+    /* Handle a write transaction; return false to NACK it. */
+    bool (*write)(struct sim_i2c_dev *dev, const uint8_t *src, size_t len);
+    /* Handle a read transaction; return false to NACK it. */
+    bool (*read)(struct sim_i2c_dev *dev, uint8_t *dst, size_t len);
+    struct sim_i2c_dev *next;
+} sim_i2c_dev_t;
+
+/* Bus traffic, for estimating the time spent on the wire. */
+typedef struct sim_i2c_stats
+{
+    /* Transactions, each with a START and an address byte. */
+    uint64_t xfers;
+    /* Data bytes, excluding address bytes. */
+    uint64_t bytes;
+    /*
+     * Blocking transactions started while a dma transfer to the bus was in
+     * progress; on the device, their bytes mix with the queued words.
+     */
+    uint64_t collisions;
+} sim_i2c_stats_t;
+
+/*
+ * With fast_forward, sleeps return at once and advance the clock by the
+ * time they would have taken, so that a loop paced by timers runs at full
+ * speed with the timestamps it would have on the device. Time spent
+ * between sleeps is still the host's. Off by default.
+ */
+void sim_clock_fast_forward(bool on);
+
+void sim_i2c_attach(i2c_inst_t *i2c, sim_i2c_dev_t *dev);
+
+/*
+ * With defer, a dma transfer into data_cmd stays in progress after it is
+ * started: dma_channel_is_busy() is true until its words have been fed to
+ * the controller with sim_dma_advance() or sim_tick(). Words are read from
+ * the source buffer as they are fed, so a driver that reuses the buffer
+ * early sends the wrong bytes. Off by default: transfers complete at once.
+ */
+void sim_dma_defer(bool on);
+
+/*
+ * The words of the transfer on channel not fed yet, and their number in
+ * count, or NULL if the channel is idle.
+ */
+const volatile uint16_t *sim_dma_pending(unsigned int channel,
+                                         unsigned int *count);
+
+/*
+ * Feed up to words words of the transfer on channel to the controller,
+ * which sends each transaction at its STOP.
+ */
+void sim_dma_advance(unsigned int channel, unsigned int words);
+
+/*
+ * Let time pass for the peripherals, as tight_loop_contents() does: an
+ * abort requested with I2C_IC_ENABLE_ABORT_BITS completes, sending the
+ * bytes of the transaction in progress with a STOP after the last, and
+ * deferred transfers are fed to the end.
+ */
+void sim_tick(void);
+
+void sim_i2c_stats(i2c_inst_t *i2c, sim_i2c_stats_t *stats);
+
+/*
+ * Time in us that the traffic counted in stats takes at the baud rate set
+ * by i2c_init(), at 9 clocks per byte.
+ */
+uint64_t sim_i2c_wire_us(i2c_inst_t *i2c, const sim_i2c_stats_t *stats);
+
+/*
+ * BME280 with the datasheet's register map. Measurements complete
+ * instantly: a forced-mode trigger or sim_bme280_set_raw() in normal mode
+ * latches the raw values into the data registers.
+ */
+typedef struct sim_bme280
+{
+    sim_i2c_dev_t dev;
+    uint8_t regs[256];
+    uint8_t ptr;
+    /* 20-bit temperature and pressure and 16-bit humidity ADC values */
+    int32_t raw_t, raw_p, raw_h;
+} sim_bme280_t;
+
+void sim_bme280_init(sim_bme280_t *s, uint8_t addr);
+
+void sim_bme280_set_raw(sim_bme280_t *s, int32_t raw_t, int32_t raw_p,
+                        int32_t raw_h);
+
+/*
+ * SSD1306 in horizontal addressing mode. Only the commands that change the
+ * address window are interpreted, the others are skipped with their
+ * arguments.
+ */
+typedef struct sim_ssd1306
+{
+    sim_i2c_dev_t dev;
+    uint8_t ram[8][128];
+    uint8_t col, col_lo, col_hi;
+    uint8_t page, page_lo, page_hi;
+    /* Command and number of its argument bytes still to come */
+    uint8_t cmd, args, nargs;
+    uint8_t argv[6];
+    /* NACK the nth byte of the writes from now on, 0 for none */
+    uint32_t nack_in;
+} sim_ssd1306_t;
+
+void sim_ssd1306_init(sim_ssd1306_t *s, uint8_t addr);
+
+#endif
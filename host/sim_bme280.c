@@ -0,0 +1,160 @@
+#include <string.h>
+
+#include "sim.h"
+
+#define REG_CALIB_00 (0x88)
+#define REG_CALIB_26 (0xE1)
+#define REG_ID (0xD0)
+#define REG_RESET (0xE0)
+#define REG_CTRL_HUM (0xF2)
+#define REG_STATUS (0xF3)
+#define REG_CTRL_MEAS (0xF4)
+#define REG_CONFIG (0xF5)
+#define REG_DATA (0xF7)
+
+#define CHIP_ID (0x60)
+#define RESET_VAL (0xB6)
+
+#define MODE_MASK (0x03)
+#define MODE_SLEEP (0x00)
+#define MODE_NORMAL (0x03)
+
+/* Typical calibration values, T1..T3 and P1..P9. */
+static const int32_t calib_tp[] = {
+    27504, 26435, -1000,
+    36477, -10685, 3024, 2855, 140, -7, 15500, -14600, 6000,
+};
+
+/* H1..H6 */
+static const int32_t calib_h[] = {75, 370, 0, 313, 50, 30};
+
+static void load_calib(sim_bme280_t *s)
+{
+    uint8_t *r = &s->regs[REG_CALIB_00];
+
+    for (size_t i = 0; i < sizeof calib_tp / sizeof calib_tp[0]; i++)
+    {
+        *r++ = (uint8_t)calib_tp[i];
+        *r++ = (uint8_t)(calib_tp[i] >> 8);
+    }
+    s->regs[0xA1] = (uint8_t)calib_h[0];
+
+    r = &s->regs[REG_CALIB_26];
+    r[0] = (uint8_t)calib_h[1];
+    r[1] = (uint8_t)(calib_h[1] >> 8);
+    r[2] = (uint8_t)calib_h[2];
+    // H4 and H5 are 12 bits each and share the register at 0xE5
+    r[3] = (uint8_t)(calib_h[3] >> 4);
+    r[4] = (uint8_t)((calib_h[3] & 0xF) | ((calib_h[4] & 0xF) << 4));
+    r[5] = (uint8_t)(calib_h[4] >> 4);
+    r[6] = (uint8_t)calib_h[5];
+}
+
+static void reset(sim_bme280_t *s)
+{
+    memset(s->regs, 0, sizeof s->regs);
+    s->regs[REG_ID] = CHIP_ID;
+    load_calib(s);
+    // Data registers read as 0x80000 for skipped measurements
+    s->regs[REG_DATA] = 0x80;
+    s->regs[REG_DATA + 3] = 0x80;
+    s->regs[REG_DATA + 6] = 0x80;
+}
+
+static void latch(sim_bme280_t *s)
+{
+    uint8_t *r = &s->regs[REG_DATA];
+
+    r[0] = (uint8_t)(s->raw_p >> 12);
+    r[1] = (uint8_t)(s->raw_p >> 4);
+    r[2] = (uint8_t)(s->raw_p << 4);
+    r[3] = (uint8_t)(s->raw_t >> 12);
+    r[4] = (uint8_t)(s->raw_t >> 4);
+    r[5] = (uint8_t)(s->raw_t << 4);
+    r[6] = (uint8_t)(s->raw_h >> 8);
+    r[7] = (uint8_t)s->raw_h;
+}
+
+/*
+ * The first byte sets the register pointer. Further bytes are pairs of
+ * data and the next register address, as in the datasheet's write
+ * sequence.
+ */
+static bool bme280_write(sim_i2c_dev_t *dev, const uint8_t *src, size_t len)
+{
+    sim_bme280_t *s = (sim_bme280_t *)dev;
+
+    for (size_t i = 0; i < len; i++)
+    {
+        if (i % 2 == 0)
+        {
+            s->ptr = src[i];
+            continue;
+        }
+
+        switch (s->ptr)
+        {
+        case REG_RESET:
+            if (src[i] == RESET_VAL)
+            {
+                reset(s);
+            }
+            break;
+        case REG_CTRL_HUM:
+        case REG_CONFIG:
+            s->regs[s->ptr] = src[i];
+            break;
+        case REG_CTRL_MEAS:
+            s->regs[s->ptr] = src[i];
+            // A forced measurement completes at once, back to sleep mode
+            if ((src[i] & MODE_MASK) != MODE_SLEEP)
+            {
+                latch(s);
+            }
+            if ((src[i] & MODE_MASK) != MODE_NORMAL)
+            {
+                s->regs[s->ptr] &= ~MODE_MASK;
+            }
+            break;
+        default:
+            // Read-only
+            break;
+        }
+    }
+
+    return true;
+}
+
+static bool bme280_read(sim_i2c_dev_t *dev, uint8_t *dst, size_t len)
+{
+    sim_bme280_t *s = (sim_bme280_t *)dev;
+
+    for (size_t i = 0; i < len; i++)
+    {
+        dst[i] = s->regs[s->ptr++];
+    }
+
+    return true;
+}
+
+void sim_bme280_init(sim_bme280_t *s, uint8_t addr)
+{
+    memset(s, 0, sizeof *s);
+    s->dev.addr = addr;
+    s->dev.write = bme280_write;
+    s->dev.read = bme280_read;
+    reset(s);
+}
+
+void sim_bme280_set_raw(sim_bme280_t *s, int32_t raw_t, int32_t raw_p,
+                        int32_t raw_h)
+{
+    s->raw_t = raw_t;
+    s->raw_p = raw_p;
+    s->raw_h = raw_h;
+
+    if ((s->regs[REG_CTRL_MEAS] & MODE_MASK) == MODE_NORMAL)
+    {
+        latch(s);
+    }
+}
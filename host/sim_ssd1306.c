@@ -0,0 +1,142 @@
+#include <string.h>
+
+#include "sim.h"
+
+#define CTRL_DATA (0x40)
+
+#define SET_MEM_ADDR (0x20)
+#define SET_COL_ADDR (0x21)
+#define SET_PAGE_ADDR (0x22)
+
+/* Number of argument bytes that follow a command. */
+static uint8_t cmd_nargs(uint8_t cmd)
+{
+    switch (cmd)
+    {
+    case SET_COL_ADDR:
+    case SET_PAGE_ADDR:
+    case 0xA3:
+        return 2;
+    case SET_MEM_ADDR:
+    case 0x81:
+    case 0x8D:
+    case 0xA8:
+    case 0xD3:
+    case 0xD5:
+    case 0xD9:
+    case 0xDA:
+    case 0xDB:
+        return 1;
+    case 0x26:
+    case 0x27:
+        return 6;
+    case 0x29:
+    case 0x2A:
+        return 5;
+    default:
+        return 0;
+    }
+}
+
+static void command(sim_ssd1306_t *s)
+{
+    switch (s->cmd)
+    {
+    case SET_COL_ADDR:
+        s->col = s->col_lo = s->argv[0] & 0x7F;
+        s->col_hi = s->argv[1] & 0x7F;
+        break;
+    case SET_PAGE_ADDR:
+        s->page = s->page_lo = s->argv[0] & 0x7;
+        s->page_hi = s->argv[1] & 0x7;
+        break;
+    default:
+        break;
+    }
+}
+
+static void put_cmd_byte(sim_ssd1306_t *s, uint8_t b)
+{
+    // Arguments may arrive in later transactions
+    if (s->args < s->nargs)
+    {
+        s->argv[s->args++] = b;
+    }
+    else
+    {
+        s->cmd = b;
+        s->args = 0;
+        s->nargs = cmd_nargs(b);
+    }
+
+    if (s->args == s->nargs)
+    {
+        command(s);
+        s->nargs = 0;
+        s->args = 0;
+    }
+}
+
+static void put_data_byte(sim_ssd1306_t *s, uint8_t b)
+{
+    s->ram[s->page][s->col] = b;
+
+    if (s->col++ == s->col_hi)
+    {
+        s->col = s->col_lo;
+        s->page = s->page == s->page_hi ? s->page_lo : s->page + 1;
+    }
+}
+
+static bool ssd1306_write(sim_i2c_dev_t *dev, const uint8_t *src, size_t len)
+{
+    sim_ssd1306_t *s = (sim_ssd1306_t *)dev;
+
+    if (len == 0)
+    {
+        return true;
+    }
+
+    // A single control byte, with Co = 0, applies to the rest of the data
+    for (size_t i = 0; i < len; i++)
+    {
+        // The bytes before the NACK were taken
+        if (s->nack_in != 0 && --s->nack_in == 0)
+        {
+            return false;
+        }
+        if (i == 0)
+        {
+            continue;
+        }
+        if (src[0] & CTRL_DATA)
+        {
+            put_data_byte(s, src[i]);
+        }
+        else
+        {
+            put_cmd_byte(s, src[i]);
+        }
+    }
+
+    return true;
+}
+
+static bool ssd1306_read(sim_i2c_dev_t *dev, uint8_t *dst, size_t len)
+{
+    // Status byte
+    (void)dev;
+    memset(dst, 0, len);
+
+    return true;
+}
+
+void sim_ssd1306_init(sim_ssd1306_t *s, uint8_t addr)
+{
+    memset(s, 0, sizeof *s);
+    s->dev.addr = addr;
+    s->dev.write = ssd1306_write;
+    s->dev.read = ssd1306_read;
+    s->col_hi = 127;
+    s->page_hi = 7;
+}
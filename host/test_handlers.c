@@ -0,0 +1,344 @@
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pico/stdlib.h"
+
+#include <ssd1306.h>
+
+#include "acquire.h"
+#include "check.h"
+#include "display.h"
+#include "handlers.h"
+#include "http_sim.h"
+#include "json.h"
+#include "metrics.h"
+#include "profiles.h"
+#include "sample_bin.h"
+#include "sensors.h"
+#include "sim.h"
+
+/*
+ * The custom handlers of src/handlers.c, run through the picow_http shim
+ * on samples that the acquisition loop reads from a simulated bme280.
+ */
+
+static sim_bme280_t sim_sensor;
+static sim_ssd1306_t sim_display;
+static ssd1306_t display;
+static netinfo_t netinfo;
+
+static int32_t rssi = -61;
+
+/* Provided by main.c on the device. */
+int32_t get_rssi(void)
+{
+    return rssi;
+}
+
+void get_loop_stats(loop_stats_t *stats)
+{
+    memset(stats, 0, sizeof *stats);
+    stats->mode = "host";
+}
+
+static const struct
+{
+    const char *path;
+    hndlr_f hndlr;
+    uint8_t methods;
+    void *priv;
+} routes[] = {
+    {"/netinfo", netinfo_handler, HTTP_METHODS_GET_HEAD, &netinfo},
+    {"/sensor", sensor_handler, HTTP_METHODS_GET_HEAD, NULL},
+    {"/sensor.bin", sensor_bin_handler, HTTP_METHODS_GET_HEAD, NULL},
+    {"/sensors", sensors_handler, HTTP_METHODS_GET_HEAD, NULL},
+    {"/sampler", sampler_handler, HTTP_METHODS_GET_HEAD, NULL},
+    {"/eventloop", eventloop_handler, HTTP_METHODS_GET_HEAD, NULL},
+    {"/config/profile", profile_handler,
+     HTTP_METHODS_GET_HEAD | (1U << HTTP_METHOD_POST), NULL},
+    {"/metrics", metrics_handler, HTTP_METHODS_GET_HEAD, NULL},
+    {"/rssi", rssi_handler, HTTP_METHODS_GET_HEAD, NULL},
+    {"/history", history_handler, HTTP_METHODS_GET_HEAD, NULL},
+    {"/history.bin", history_bin_handler, HTTP_METHODS_GET_HEAD, NULL},
+    {"/snapshot", snapshot_handler, HTTP_METHODS_GET_HEAD, &netinfo},
+};
+
+static void setup(void)
+{
+    struct server_cfg cfg = http_default_cfg();
+
+    i2c_init(i2c_default, 1000000);
+    sim_bme280_init(&sim_sensor, 0x76);
+    sim_ssd1306_init(&sim_display, 0x3C);
+    sim_i2c_attach(i2c_default, &sim_sensor.dev);
+    sim_i2c_attach(i2c_default, &sim_display.dev);
+    sim_bme280_set_raw(&sim_sensor, 519888, 415148, 27000);
+    sim_clock_fast_forward(true);
+
+    ssd1306_init(&display, 128, 32, 0x3C, i2c_default);
+    display_init(&display, 0);
+    sensors_init(profiles_active());
+    acquire_init();
+    acquire_start();
+
+    INIT_OBJ(&netinfo, NETINFO_MAGIC);
+    strcpy(netinfo.ip, "192.0.2.7");
+    strcpy(netinfo.mac, "28:cd:c1:00:00:01");
+
+    for (size_t i = 0; i < count_of(routes); i++)
+    {
+        metrics_register(&cfg, routes[i].path, routes[i].hndlr,
+                         routes[i].methods, routes[i].priv);
+    }
+}
+
+/* The Content-Length header, if any, matches the body. */
+static bool length_ok(const sim_http_resp_t *r)
+{
+    const char *len = sim_http_resp_hdr(r, "Content-Length");
+
+    return len == NULL || strtoul(len, NULL, 10) == r->body_len;
+}
+
+static void test_sensor(void)
+{
+    sim_http_resp_t r;
+    sample_t s;
+    char json[JSON_SENSOR_MAX + 1];
+    char etag[SIM_HTTP_HDRS_MAX], inm[SIM_HTTP_HDRS_MAX + 32];
+    history_sample_t bin[2];
+
+    // No sample yet
+    sim_http_request(HTTP_METHOD_GET, "/sensor", NULL, &r);
+    CHECK(r.status == 503);
+    sim_http_resp_free(&r);
+
+    acquire_step(&(acquire_hooks_t){0});
+    CHECK(sensors_get(0, &s));
+    json[json_sensor(json, &s)] = '\0';
+
+    CHECK(sim_http_request(HTTP_METHOD_GET, "/sensor", NULL, &r) == ERR_OK);
+    CHECK(r.status == 200);
+    CHECK(strcmp(sim_http_resp_hdr(&r, "Content-Type"),
+                 "application/json") == 0);
+    CHECK(strcmp((char *)r.body, json) == 0);
+    CHECK(length_ok(&r));
+    CHECK(sim_http_resp_hdr(&r, "ETag") != NULL);
+    strcpy(etag, sim_http_resp_hdr(&r, "ETag"));
+    sim_http_resp_free(&r);
+
+    // Revalidation with the current ETag
+    snprintf(inm, sizeof inm, "If-None-Match: %s\r\n", etag);
+    sim_http_request(HTTP_METHOD_GET, "/sensor", inm, &r);
+    CHECK(r.status == 304);
+    CHECK(r.body_len == 0);
+    sim_http_resp_free(&r);
+
+    // HEAD has the header of GET and no body
+    sim_http_request(HTTP_METHOD_HEAD, "/sensor", NULL, &r);
+    CHECK(r.status == 200);
+    CHECK(r.body_len == 0);
+    CHECK(strtoul(sim_http_resp_hdr(&r, "Content-Length"), NULL, 10) ==
+          strlen(json));
+    sim_http_resp_free(&r);
+
+    sim_http_request(HTTP_METHOD_GET, "/sensor.bin", NULL, &r);
+    CHECK(r.status == 200);
+    CHECK(r.body_len == SAMPLE_BIN_SENSOR_LEN);
+    CHECK(sample_bin_decode(r.body, r.body_len, bin, 2) == 1);
+    CHECK(bin[0].ts == s.ts && bin[0].temperature == s.temperature);
+    CHECK(bin[0].pressure == sample_pressure_pa(&s));
+    sim_http_resp_free(&r);
+
+    sim_http_request(HTTP_METHOD_GET, "/sensor?id=7", NULL, &r);
+    CHECK(r.status == 404);
+    sim_http_resp_free(&r);
+    sim_http_request(HTTP_METHOD_GET, "/sensor?id=x", NULL, &r);
+    CHECK(r.status == 400);
+    sim_http_resp_free(&r);
+}
+
+/*
+ * Accept selects the binary body only for a whole media range, without
+ * regard to case or OWS, and not if it is refused with q=0.
+ */
+static void test_accept(void)
+{
+    static const struct
+    {
+        const char *accept;
+        bool bin;
+    } cases[] = {
+        {SAMPLE_BIN_TYPE, true},
+        {"Application/VND.Pico-Meteo.Samples", true},
+        {"text/html, " SAMPLE_BIN_TYPE ";q=0.9", true},
+        {" " SAMPLE_BIN_TYPE " ; q=1 ,application/json", true},
+        {SAMPLE_BIN_TYPE ";charset=x;Q=0.001", true},
+        {"application/json, " SAMPLE_BIN_TYPE ";q=0", false},
+        {SAMPLE_BIN_TYPE " ; q=0.000", false},
+        {SAMPLE_BIN_TYPE "x", false},
+        {"x-" SAMPLE_BIN_TYPE, false},
+        {"text/plain; foo=\"" SAMPLE_BIN_TYPE "\"", false},
+        {"*/*", false},
+    };
+    sim_http_resp_t r;
+    char hdr[128];
+
+    for (size_t i = 0; i < count_of(cases); i++)
+    {
+        snprintf(hdr, sizeof hdr, "Accept: %s\r\n", cases[i].accept);
+        sim_http_request(HTTP_METHOD_GET, "/sensor", hdr, &r);
+        CHECK(r.status == 200);
+        if (!CHECK((strcmp(sim_http_resp_hdr(&r, "Content-Type"),
+                           SAMPLE_BIN_TYPE) == 0) == cases[i].bin))
+        {
+            fprintf(stderr, "  Accept: %s\n", cases[i].accept);
+        }
+        sim_http_resp_free(&r);
+    }
+
+    sim_http_request(HTTP_METHOD_GET, "/metrics",
+                     "Accept: application/openmetrics-text;q=0\r\n", &r);
+    CHECK(strncmp(sim_http_resp_hdr(&r, "Content-Type"), "text/plain",
+                  STRLEN_LTRL("text/plain")) == 0);
+    sim_http_resp_free(&r);
+}
+
+static void test_rssi_netinfo(void)
+{
+    sim_http_resp_t r;
+
+    sim_http_request(HTTP_METHOD_GET, "/rssi", NULL, &r);
+    CHECK(r.status == 200);
+    CHECK(strcmp((char *)r.body, "{\"valid\":true,\"rssi\":-61}") == 0);
+    sim_http_resp_free(&r);
+
+    rssi = INT32_MAX;
+    sim_http_request(HTTP_METHOD_GET, "/rssi", NULL, &r);
+    CHECK(strncmp((char *)r.body, "{\"valid\":false,", 15) == 0);
+    sim_http_resp_free(&r);
+    rssi = -61;
+
+    sim_http_request(HTTP_METHOD_GET, "/netinfo", NULL, &r);
+    CHECK(r.status == 200);
+    CHECK(strstr((char *)r.body, "\"ip\":\"192.0.2.7\"") != NULL);
+    CHECK(strstr((char *)r.body, "\"mac\":\"28:cd:c1:00:00:01\"") != NULL);
+    CHECK(length_ok(&r));
+    sim_http_resp_free(&r);
+
+    sim_http_request(HTTP_METHOD_GET, "/snapshot?fields=rssi", NULL, &r);
+    CHECK(r.status == 200);
+    CHECK(strstr((char *)r.body, ",\"rssi\":{\"valid\":true,") != NULL);
+    CHECK(strstr((char *)r.body, "\"sensor\"") == NULL);
+    CHECK(length_ok(&r));
+    sim_http_resp_free(&r);
+
+    sim_http_request(HTTP_METHOD_GET, "/snapshot?fields=rssi,bogus", NULL,
+                     &r);
+    CHECK(r.status == 400);
+    sim_http_resp_free(&r);
+}
+
+static void test_profile(void)
+{
+    sim_http_resp_t r;
+
+    sim_http_request(HTTP_METHOD_POST, "/config/profile?name=indoor-nav",
+                     NULL, &r);
+    CHECK(r.status == 200);
+    CHECK(strstr((char *)r.body, "\"requested\":\"indoor-nav\"") != NULL);
+    sim_http_resp_free(&r);
+
+    // core1 applies it before its next read
+    acquire_step(&(acquire_hooks_t){0});
+    CHECK(strcmp(profiles_active()->name, "indoor-nav") == 0);
+
+    sim_http_request(HTTP_METHOD_POST, "/config/profile?name=nope", NULL, &r);
+    CHECK(r.status == 400);
+    sim_http_resp_free(&r);
+
+    sim_http_request(HTTP_METHOD_POST, "/sensor", NULL, &r);
+    CHECK(r.status == 405);
+    sim_http_resp_free(&r);
+
+    sim_http_request(HTTP_METHOD_GET, "/nope", NULL, &r);
+    CHECK(r.status == 404);
+    sim_http_resp_free(&r);
+}
+
+/*
+ * A profile switched while a display frame is on the bus: the sensor
+ * settings are only written once the frame is complete, and neither the
+ * frame nor the settings are mixed up.
+ */
+static void test_profile_frame(void)
+{
+    sim_http_resp_t r;
+    sim_i2c_stats_t before, after;
+    unsigned int n = 0;
+    int32_t raw_t = 519888;
+
+    sim_dma_defer(true);
+    for (int i = 0; i < 100 && sim_dma_pending(display.dma_chan, &n) == NULL;
+         i++)
+    {
+        // A new reading, so that the frame differs from the last
+        raw_t += 5000;
+        sim_bme280_set_raw(&sim_sensor, raw_t, 415148, 27000);
+        acquire_step(&(acquire_hooks_t){0});
+    }
+    CHECK(sim_dma_pending(display.dma_chan, &n) != NULL && n > 0);
+
+    sim_i2c_stats(i2c_default, &before);
+    sim_http_request(HTTP_METHOD_POST, "/config/profile?name=weather", NULL,
+                     &r);
+    CHECK(r.status == 200);
+    sim_http_resp_free(&r);
+    acquire_step(&(acquire_hooks_t){0});
+    sim_i2c_stats(i2c_default, &after);
+
+    CHECK(strcmp(profiles_active()->name, "weather") == 0);
+    CHECK(after.collisions == before.collisions);
+    ssd1306_show_wait(&display);
+    CHECK(memcmp(sim_display.ram, display.buffer, display.bufsize) == 0);
+    sim_dma_defer(false);
+}
+
+static void test_metrics(void)
+{
+    sim_http_resp_t r;
+    char line[128];
+
+    sim_http_request(HTTP_METHOD_GET, "/metrics", NULL, &r);
+    CHECK(r.status == 200);
+    CHECK(r.chunked_end);
+    // The requests for /sensor so far: 503, 200, 304, HEAD, 404, 400, ...
+    snprintf(line, sizeof line,
+             "pico_meteo_http_requests_total{path=\"/sensor\"} %" PRIu32 "\n",
+             metrics_route(1)->requests);
+    CHECK(strstr((char *)r.body, line) != NULL);
+    CHECK(metrics_route(1)->errors == 3);
+    sim_http_resp_free(&r);
+
+    sim_http_request(HTTP_METHOD_GET, "/metrics",
+                     "Accept: application/openmetrics-text; version=1.0.0\r\n",
+                     &r);
+    CHECK(r.body_len > 6 &&
+          strcmp((char *)r.body + r.body_len - 6, "# EOF\n") == 0);
+    sim_http_resp_free(&r);
+}
+
+int main(void)
+{
+    setup();
+
+    test_sensor();
+    test_accept();
+    test_rssi_netinfo();
+    test_profile();
+    test_profile_frame();
+    test_metrics();
+
+    return check_status();
+}
@@ -0,0 +1,392 @@
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pico/stdlib.h"
+#include "hardware/sync.h"
+
+#include <ssd1306.h>
+
+#include "acquire.h"
+#include "check.h"
+#include "display.h"
+#include "handlers.h"
+#include "history.h"
+#include "http_sim.h"
+#include "profiles.h"
+#include "sample_bin.h"
+#include "sensors.h"
+#include "sim.h"
+
+/*
+ * The history ring, and the /history and /history.bin cursor: samples are
+ * taken at the 25 Hz of the indoor-nav profile, so that many share a
+ * second, and every sample must reach a collector exactly once.
+ */
+
+/* Most samples that the tests take */
+#define SAMPLES_MAX (200000)
+
+static sim_bme280_t sim_sensor;
+static sim_ssd1306_t sim_display;
+static ssd1306_t display;
+
+/* The samples appended to the history, indexed by sequence number */
+static history_sample_t appended[SAMPLES_MAX + 1];
+static uint32_t nappended;
+
+/* Ring for test_ring(), apart from the one of acquire.c */
+static history_t ring;
+
+int32_t get_rssi(void)
+{
+    return INT32_MAX;
+}
+
+void get_loop_stats(loop_stats_t *stats)
+{
+    memset(stats, 0, sizeof *stats);
+    stats->mode = "host";
+}
+
+static int32_t walk(int32_t v, int32_t step)
+{
+    return v + rand() % (2 * step + 1) - step;
+}
+
+/* Normally distributed noise with standard deviation sd/100 */
+static int32_t noise(int32_t sd)
+{
+    int32_t sum = 0;
+
+    // Sum of 12 uniform values in 0..1, less 6, has variance 1
+    for (int i = 0; i < 12; i++)
+    {
+        sum += rand() % 1000;
+    }
+
+    return (sum - 6000) * sd / 100000;
+}
+
+static void published(const sample_t *s)
+{
+    history_sample_t *q = &appended[++nappended];
+
+    q->seq = nappended;
+    q->ts = s->ts;
+    q->temperature = s->temperature;
+    q->humidity = sample_humidity_centi(s);
+    q->pressure = sample_pressure_pa(s);
+}
+
+/* Take a sample, with the sensor's readings drifting between samples. */
+static void step(void)
+{
+    static int32_t raw_t = 519888, raw_p = 415148, raw_h = 27000;
+    static const acquire_hooks_t hooks = {.published = published};
+
+    raw_t = walk(raw_t, 200);
+    raw_p = walk(raw_p, 200);
+    raw_h = walk(raw_h, 50);
+    sim_bme280_set_raw(&sim_sensor, raw_t, raw_p, raw_h);
+    acquire_step(&hooks);
+}
+
+static bool same(const history_sample_t *a, const history_sample_t *b)
+{
+    return a->seq == b->seq && a->ts == b->ts &&
+           a->temperature == b->temperature && a->humidity == b->humidity &&
+           a->pressure == b->pressure;
+}
+
+static void setup(void)
+{
+    struct server_cfg cfg = http_default_cfg();
+
+    i2c_init(i2c_default, 1000000);
+    sim_bme280_init(&sim_sensor, 0x76);
+    sim_ssd1306_init(&sim_display, 0x3C);
+    sim_i2c_attach(i2c_default, &sim_sensor.dev);
+    sim_i2c_attach(i2c_default, &sim_display.dev);
+    sim_clock_fast_forward(true);
+
+    ssd1306_init(&display, 128, 32, 0x3C, i2c_default);
+    display_init(&display, 0);
+    sensors_init(profiles_active());
+    acquire_init();
+    acquire_start();
+
+    // As POST /config/profile does; applied on the first step
+    profiles_request(profiles_find((const uint8_t *)"indoor-nav",
+                                   STRLEN_LTRL("indoor-nav")));
+    __sev();
+
+    register_hndlr_methods(&cfg, "/history", history_handler,
+                           HTTP_METHODS_GET_HEAD, NULL);
+    register_hndlr_methods(&cfg, "/history.bin", history_bin_handler,
+                           HTTP_METHODS_GET_HEAD, NULL);
+}
+
+/*
+ * Append to a ring until it has wrapped twice, and check that the blocks
+ * held decode to the samples last appended, numbered without gaps.
+ */
+static void test_ring(void)
+{
+    history_block_t blk;
+    history_iter_t it;
+    history_sample_t s;
+    uint32_t first, last, seq = 0;
+    int32_t t = 2150, h = 45 * 1024, p = 101325 * 256;
+
+    history_init(&ring);
+    CHECK(!history_span(&ring, &first, &last));
+    CHECK(!history_copy_block(&ring, 1, &blk));
+
+    for (uint32_t i = 0; i < SAMPLES_MAX; i++)
+    {
+        sample_t smp = {.ts = i / 25};
+
+        t = walk(t, 3);
+        h = walk(h, 40);
+        p = walk(p, 64);
+        smp.temperature = t;
+        smp.humidity = (uint32_t)h;
+        smp.pressure = (uint32_t)p;
+        history_append(&ring, &smp);
+        published(&smp);
+        if (history_span(&ring, &first, &last) && first > 2 * HISTORY_BLOCKS)
+        {
+            break;
+        }
+    }
+    CHECK(history_span(&ring, &first, &last));
+    CHECK(last - first + 1 == HISTORY_BLOCKS);
+
+    // Overwritten, and not yet written
+    CHECK(!history_copy_block(&ring, first - 1, &blk));
+    CHECK(!history_copy_block(&ring, last + 1, &blk));
+
+    for (uint32_t b = first; b <= last; b++)
+    {
+        CHECK(history_copy_block(&ring, b, &blk));
+        CHECK(blk.seq == b);
+        if (b == first)
+        {
+            seq = blk.key.seq;
+        }
+        history_iter_init(&it, &blk);
+        while (history_iter_next(&it, &s))
+        {
+            CHECK(s.seq == seq);
+            CHECK(same(&s, &appended[seq]));
+            seq++;
+        }
+        CHECK(blk.ts_last == appended[seq - 1].ts);
+    }
+    CHECK(seq - 1 == nappended);
+
+    nappended = 0;
+}
+
+/*
+ * Fill a ring at 1 Hz with steady readings plus the noise of the weather
+ * profile (osrs x1, filter off): about 1 centi-degree C, 2 centi-%RH and
+ * 3 Pa RMS. The time the ring spans must be the capacity that history.h
+ * states, about 6 hours for the default of 384 blocks.
+ */
+static void test_capacity(void)
+{
+    history_block_t blk;
+    uint32_t first, last, ts;
+
+    history_init(&ring);
+    for (ts = 0; !history_span(&ring, &first, &last) || first == 1; ts++)
+    {
+        sample_t smp = {
+            .ts = ts,
+            .temperature = 2150 + noise(100),
+            .humidity = (uint32_t)(45 * 1024 + noise(2 * 1024)),
+            .pressure = (uint32_t)(101325 * 256 + noise(3 * 256 * 100)),
+        };
+
+        history_append(&ring, &smp);
+    }
+    CHECK(history_copy_block(&ring, first, &blk));
+    // ts is one past the last sample
+    ts -= blk.key.ts + 1;
+    printf("capacity: %" PRIu32 " s in %d blocks\n", ts, HISTORY_BLOCKS);
+
+    // 50 to 60 samples per block
+    CHECK(ts >= 50 * HISTORY_BLOCKS && ts <= 60 * HISTORY_BLOCKS);
+}
+
+/*
+ * Get /history.bin after cursor, check that the records continue from it
+ * without gaps if contiguous is set, and return the new cursor.
+ */
+static uint32_t collect(uint32_t after, bool contiguous, uint32_t *n)
+{
+    static history_sample_t rec[SAMPLES_MAX];
+    sim_http_resp_t r;
+    char target[64];
+    int nrec;
+    uint32_t next = after;
+
+    snprintf(target, sizeof target, "/history.bin?after=%" PRIu32, after);
+    CHECK(sim_http_request(HTTP_METHOD_GET, target, NULL, &r) == ERR_OK);
+    CHECK(r.status == 200 && r.chunked_end);
+    nrec = sample_bin_decode(r.body, r.body_len, rec, SAMPLES_MAX);
+    CHECK(nrec >= 0);
+    for (int i = 0; i < nrec; i++)
+    {
+        CHECK(rec[i].seq > next);
+        if (contiguous)
+        {
+            CHECK(rec[i].seq == next + 1);
+        }
+        CHECK(rec[i].seq <= nappended && same(&rec[i], &appended[rec[i].seq]));
+        next = rec[i].seq;
+    }
+    sim_http_resp_free(&r);
+    *n = nrec < 0 ? 0 : (uint32_t)nrec;
+
+    return next;
+}
+
+/* The value of "next" of a /history JSON body, and its number of samples */
+static uint32_t json_next(const char *target, uint32_t *n)
+{
+    sim_http_resp_t r;
+    const char *p;
+    uint32_t next = 0;
+
+    *n = 0;
+    CHECK(sim_http_request(HTTP_METHOD_GET, target, NULL, &r) == ERR_OK);
+    CHECK(r.status == 200);
+    for (p = (char *)r.body; (p = strstr(p, "],[")) != NULL; p++)
+    {
+        (*n)++;
+    }
+    if (strstr((char *)r.body, "\"samples\":[[") != NULL)
+    {
+        (*n)++;
+    }
+    CHECK((p = strstr((char *)r.body, "\"next\":")) != NULL);
+    if (p != NULL)
+    {
+        next = strtoul(p + STRLEN_LTRL("\"next\":"), NULL, 10);
+    }
+    sim_http_resp_free(&r);
+
+    return next;
+}
+
+/*
+ * A collector polls with the cursor between bursts of samples, and gets
+ * each one exactly once, although many share a timestamp.
+ */
+static void test_cursor(void)
+{
+    uint32_t cursor = 0, n, total = 0, same_second = 0, next, nsamples;
+    char target[64];
+    sim_http_resp_t r;
+
+    for (unsigned round = 0; round < 200; round++)
+    {
+        for (unsigned i = rand() % 60; i > 0; i--)
+        {
+            step();
+        }
+        cursor = collect(cursor, true, &n);
+        total += n;
+    }
+    CHECK(total == nappended);
+    CHECK(cursor == nappended);
+    for (uint32_t seq = 2; seq <= nappended; seq++)
+    {
+        same_second += appended[seq].ts == appended[seq - 1].ts;
+    }
+    CHECK(same_second > nappended / 2);
+
+    // Nothing new: the cursor stays
+    CHECK(collect(cursor, true, &n) == cursor && n == 0);
+
+    // JSON has the same cursor
+    step();
+    step();
+    snprintf(target, sizeof target, "/history?after=%" PRIu32, cursor);
+    next = json_next(target, &nsamples);
+    CHECK(next == nappended && nsamples == 2);
+    next = json_next("/history", &nsamples);
+    CHECK(next == nappended);
+
+    // since filters by time; the cursor still covers the skipped samples
+    snprintf(target, sizeof target, "/history?since=%" PRIu32,
+             appended[nappended].ts);
+    next = json_next(target, &nsamples);
+    CHECK(next == nappended && nsamples == 0);
+
+    sim_http_request(HTTP_METHOD_GET, "/history?after=x", NULL, &r);
+    CHECK(r.status == 400);
+    sim_http_resp_free(&r);
+}
+
+static uint32_t overwrite_until;
+
+/*
+ * Sent after the first chunk: take samples until the history has
+ * overwritten every block that was held when the response started.
+ */
+static void overwrite(void)
+{
+    uint32_t first, last;
+
+    while (get_history_span(&first, &last) && first <= overwrite_until)
+    {
+        step();
+    }
+    sim_http_on_chunk(NULL);
+}
+
+/*
+ * Blocks overwritten while the response is sent fail to copy, and the
+ * response continues with the oldest block still held: the records stay
+ * in order, without repeats, and the cursor picks up after them.
+ */
+static void test_resync(void)
+{
+    uint32_t first, last, cursor, resumed, n;
+
+    while (get_history_span(&first, &last) && last < HISTORY_BLOCKS / 2)
+    {
+        step();
+    }
+    CHECK(get_history_span(&first, &last));
+    overwrite_until = last;
+    sim_http_on_chunk(overwrite);
+
+    cursor = collect(0, false, &n);
+    CHECK(n > 0 && n < nappended);
+    CHECK(cursor == nappended);
+
+    // The samples taken meanwhile were all sent, after the resync
+    CHECK(get_history_span(&first, &last) && first > overwrite_until);
+
+    step();
+    resumed = collect(cursor, true, &n);
+    CHECK(n == 1 && resumed == nappended);
+}
+
+int main(void)
+{
+    setup();
+
+    test_ring();
+    test_capacity();
+    test_cursor();
+    test_resync();
+
+    return check_status();
+}
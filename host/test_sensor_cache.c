@@ -0,0 +1,160 @@
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "check.h"
+#include "json.h"
+#include "sample_bin.h"
+#include "sensor_cache.h"
+
+/*
+ * The /sensor body cache: every sample is published however fast samples
+ * arrive, and a held body stays unchanged until it is released, also while
+ * a writer thread publishes as fast as it can.
+ */
+
+/* Samples published by the writer thread; may be overridden */
+#define DEFAULT_UPDATES (1000000)
+
+static sensor_cache_t cache;
+static bool done;
+
+static sample_t sample(uint32_t n)
+{
+    sample_t s = {
+        .ts = n,
+        .temperature = (int32_t)(n % 10000) - 4000,
+        .humidity = n % (100 * 1024),
+        .pressure = 101325 * 256 + n % 4096,
+    };
+
+    return s;
+}
+
+/* The body b is the one rendered for s. */
+static bool renders(const sensor_body_t *b, const sample_t *s)
+{
+    char json[JSON_SENSOR_MAX];
+    uint8_t bin[SAMPLE_BIN_SENSOR_LEN];
+    size_t len = json_sensor(json, s);
+
+    sample_bin_sensor(bin, s);
+
+    return b->len == len && memcmp(b->body, json, len) == 0 &&
+           memcmp(b->bin, bin, sizeof bin) == 0;
+}
+
+static void test_newest(void)
+{
+    const sensor_body_t *b, *held;
+    sensor_body_t copy;
+    sample_t s;
+
+    CHECK(sensor_cache_hold(&cache) == NULL);
+
+    // Far faster than any response could complete: none is skipped
+    for (uint32_t n = 1; n <= 1000; n++)
+    {
+        s = sample(n);
+        sensor_cache_update(&cache, &s);
+        CHECK((b = sensor_cache_hold(&cache)) != NULL && renders(b, &s));
+        sensor_cache_release(&cache);
+    }
+
+    // A held body stays, and newer ones are still published
+    held = sensor_cache_hold(&cache);
+    memcpy(&copy, held, sizeof copy);
+    for (uint32_t n = 1001; n <= 2000; n++)
+    {
+        s = sample(n);
+        sensor_cache_update(&cache, &s);
+        CHECK(memcmp(held, &copy, sizeof copy) == 0);
+        CHECK(cache.current != held);
+    }
+    sensor_cache_release(&cache);
+    CHECK((b = sensor_cache_hold(&cache)) != NULL && renders(b, &s));
+    sensor_cache_release(&cache);
+}
+
+static void *writer(void *arg)
+{
+    unsigned long updates = *(unsigned long *)arg;
+
+    for (uint32_t n = 1; n <= updates; n++)
+    {
+        sample_t s = sample(n);
+
+        sensor_cache_update(&cache, &s);
+    }
+    __atomic_store_n(&done, true, __ATOMIC_RELEASE);
+
+    return NULL;
+}
+
+/*
+ * Hold the body as a handler does, and check that it is the complete
+ * rendering of one sample and does not change until it is released.
+ */
+static void test_concurrent(unsigned long updates)
+{
+    pthread_t w;
+    sensor_body_t copy;
+    uint64_t holds = 0, torn = 0, changed = 0, backwards = 0;
+    uint32_t last = 0;
+
+    memset(&cache, 0, sizeof cache);
+    pthread_create(&w, NULL, writer, &updates);
+
+    while (!__atomic_load_n(&done, __ATOMIC_ACQUIRE))
+    {
+        const sensor_body_t *b = sensor_cache_hold(&cache);
+        history_sample_t d;
+
+        if (b == NULL)
+        {
+            continue;
+        }
+        memcpy(&copy, b, sizeof copy);
+        holds++;
+
+        // The sample is recovered from the binary body
+        if (sample_bin_decode(copy.bin, sizeof copy.bin, &d, 1) != 1)
+        {
+            torn++;
+        }
+        else
+        {
+            sample_t s = sample(d.ts);
+
+            torn += !renders(&copy, &s);
+            backwards += d.ts < last;
+            last = d.ts;
+        }
+
+        // Time for the writer to reuse the slot, if it would
+        for (volatile int i = 0; i < 200; i++)
+            ;
+        changed += memcmp(b, &copy, sizeof copy) != 0;
+        sensor_cache_release(&cache);
+    }
+    pthread_join(w, NULL);
+
+    CHECK(holds > 0);
+    CHECK(torn == 0);
+    CHECK(changed == 0);
+    CHECK(backwards == 0);
+    printf("%lu updates, %" PRIu64 " holds\n", updates, holds);
+}
+
+int main(int argc, char **argv)
+{
+    unsigned long updates = argc > 1 ? strtoul(argv[1], NULL, 0)
+                                     : DEFAULT_UPDATES;
+
+    test_newest();
+    test_concurrent(updates);
+
+    return check_status();
+}
@@ -0,0 +1,137 @@
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "check.h"
+#include "seqlock.h"
+
+/*
+ * Stress test of the sequence lock: a writer thread updates a record word
+ * by word, as the sampler and the display update their statistics on
+ * core1, while reader threads copy it as the handlers do on core0. Every
+ * word of a record is derived from the same counter, so a torn copy is
+ * detected.
+ */
+
+/* Updates by the writer; may be overridden on the command line */
+#define DEFAULT_UPDATES (2000000)
+
+#define READERS (3)
+
+/* Words per record, as many as in the largest record protected so */
+#define WORDS (16)
+
+typedef struct
+{
+    uint32_t w[WORDS];
+} record_t;
+
+static seqlock_t lock;
+static record_t shared;
+static bool done;
+
+typedef struct
+{
+    uint64_t reads;
+    uint64_t retries;
+    uint64_t torn;
+    uint64_t backwards;
+    uint32_t last;
+} reader_stats_t;
+
+static void fill(record_t *r, uint32_t n)
+{
+    for (unsigned i = 0; i < WORDS; i++)
+    {
+        r->w[i] = n * 2654435761U + i;
+    }
+}
+
+static void *writer(void *arg)
+{
+    unsigned long updates = *(unsigned long *)arg;
+
+    for (uint32_t n = 1; n <= updates; n++)
+    {
+        seqlock_write_begin(&lock);
+        fill(&shared, n);
+        seqlock_write_end(&lock);
+    }
+    __atomic_store_n(&done, true, __ATOMIC_RELEASE);
+
+    return NULL;
+}
+
+static void *reader(void *arg)
+{
+    reader_stats_t *st = arg;
+    record_t copy;
+    uint32_t seq;
+
+    while (!__atomic_load_n(&done, __ATOMIC_ACQUIRE))
+    {
+        for (;;)
+        {
+            seq = seqlock_read_begin(&lock);
+            copy = shared;
+            if (!seqlock_read_retry(&lock, seq))
+            {
+                break;
+            }
+            st->retries++;
+        }
+        st->reads++;
+
+        // The counter is recovered from the first word
+        uint32_t n = copy.w[0] * 244002641U;
+
+        for (unsigned i = 1; i < WORDS; i++)
+        {
+            if (copy.w[i] != n * 2654435761U + i)
+            {
+                st->torn++;
+                break;
+            }
+        }
+        // Updates are seen in order
+        if (n < st->last)
+        {
+            st->backwards++;
+        }
+        st->last = n;
+    }
+
+    return NULL;
+}
+
+int main(int argc, char **argv)
+{
+    unsigned long updates = argc > 1 ? strtoul(argv[1], NULL, 0)
+                                     : DEFAULT_UPDATES;
+    pthread_t w, r[READERS];
+    reader_stats_t st[READERS] = {0};
+    uint64_t reads = 0, retries = 0;
+
+    seqlock_init(&lock);
+    fill(&shared, 0);
+    for (unsigned i = 0; i < READERS; i++)
+    {
+        pthread_create(&r[i], NULL, reader, &st[i]);
+    }
+    pthread_create(&w, NULL, writer, &updates);
+
+    pthread_join(w, NULL);
+    for (unsigned i = 0; i < READERS; i++)
+    {
+        pthread_join(r[i], NULL);
+        CHECK(st[i].torn == 0);
+        CHECK(st[i].backwards == 0);
+        reads += st[i].reads;
+        retries += st[i].retries;
+    }
+    printf("%lu updates, %" PRIu64 " reads, %" PRIu64 " retries\n", updates,
+           reads, retries);
+
+    return check_status();
+}
@@ -0,0 +1,305 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "pico/stdlib.h"
+#include "hardware/dma.h"
+
+#include <ssd1306.h>
+
+#include "check.h"
+#include "sim.h"
+
+/*
+ * ssd1306_show_async() against the i2c controller and dma of the host sim
+ * in deferred mode, so that a transfer stays in progress until the test
+ * feeds its words: the data_cmd words queued, their STOP bits, that the
+ * staging buffer is left alone while the transfer is in progress, and the
+ * recovery from an abort and from a NACK.
+ */
+
+#define WIDTH (128)
+#define HEIGHT (64)
+#define PAGES (HEIGHT / 8)
+
+#define SET_COL_ADDR (0x21)
+#define SET_PAGE_ADDR (0x22)
+#define NOP (0xE3)
+
+static sim_ssd1306_t sim;
+static ssd1306_t disp;
+
+/* Column window sent for each page, lo > hi if none */
+typedef struct
+{
+    int lo[PAGES], hi[PAGES];
+    /* Led by the no-ops sent after a transfer was cut short */
+    bool resync;
+} windows_t;
+
+/* The words pending on the display's channel, and their number */
+static const volatile uint16_t *pending(unsigned int *n)
+{
+    const volatile uint16_t *w = sim_dma_pending(disp.dma_chan, n);
+
+    if (w == NULL)
+    {
+        *n = 0;
+    }
+
+    return w;
+}
+
+/*
+ * Check that the n words w are, after two no-ops ending with STOP if the
+ * display ram is unknown, for each page window in increasing page
+ * order: a control byte for commands, the column and page address commands
+ * ending with STOP, a control byte for data and the window's columns of
+ * frame, the last with STOP; and no STOP elsewhere. Return the windows.
+ */
+static windows_t check_words(const volatile uint16_t *w, unsigned int n,
+                             const uint8_t *frame)
+{
+    windows_t win;
+    unsigned int i = 0;
+    int last_pg = -1;
+
+    for (int pg = 0; pg < PAGES; pg++)
+    {
+        win.lo[pg] = 1;
+        win.hi[pg] = 0;
+    }
+    win.resync = n >= 3 && w[1] == NOP;
+    if (win.resync)
+    {
+        CHECK(w[0] == 0x00 && w[2] == (NOP | I2C_IC_DATA_CMD_STOP_BITS));
+        i = 3;
+    }
+
+    for (unsigned int k = 0; k < n; k++)
+    {
+        CHECK((w[k] & ~(0xFFu | I2C_IC_DATA_CMD_STOP_BITS)) == 0);
+    }
+
+    while (i < n)
+    {
+        if (!CHECK(n - i >= 9))
+        {
+            break;
+        }
+        int lo = w[i + 2] & 0xFF, hi = w[i + 3] & 0xFF, pg = w[i + 5] & 0xFF;
+
+        CHECK(w[i] == 0x00);
+        CHECK(w[i + 1] == SET_COL_ADDR);
+        CHECK(w[i + 2] == lo && w[i + 3] == hi && lo <= hi && hi < WIDTH);
+        CHECK(w[i + 4] == SET_PAGE_ADDR);
+        CHECK(w[i + 5] == pg && pg < PAGES && pg > last_pg);
+        CHECK(w[i + 6] == (pg | I2C_IC_DATA_CMD_STOP_BITS));
+        CHECK(w[i + 7] == 0x40);
+        i += 8;
+        if (!CHECK(pg < PAGES && lo <= hi && n - i >= (unsigned)(hi - lo + 1)))
+        {
+            break;
+        }
+        for (int col = lo; col <= hi; col++, i++)
+        {
+            uint16_t want = frame[pg * WIDTH + col];
+
+            if (col == hi)
+            {
+                want |= I2C_IC_DATA_CMD_STOP_BITS;
+            }
+            CHECK(w[i] == want);
+        }
+        win.lo[pg] = lo;
+        win.hi[pg] = hi;
+        last_pg = pg;
+    }
+
+    return win;
+}
+
+/* The display ram holds frame. */
+static bool ram_is(const uint8_t *frame)
+{
+    for (int pg = 0; pg < PAGES; pg++)
+    {
+        if (memcmp(sim.ram[pg], frame + pg * WIDTH, WIDTH) != 0)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static bool all_pages_full(const windows_t *win)
+{
+    for (int pg = 0; pg < PAGES; pg++)
+    {
+        if (win->lo[pg] != 0 || win->hi[pg] != WIDTH - 1)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static void setup(void)
+{
+    i2c_init(i2c0, 1000000);
+    sim_ssd1306_init(&sim, 0x3C);
+    sim_i2c_attach(i2c0, &sim.dev);
+    CHECK(ssd1306_init(&disp, WIDTH, HEIGHT, 0x3C, i2c0));
+    CHECK(disp.dma_chan >= 0);
+    sim_dma_defer(true);
+}
+
+/*
+ * The first frame is sent whole. While it is in progress the buffer is
+ * redrawn, a second show is refused, and the queued words stay as they
+ * were; the next show sends only the changed columns.
+ */
+static void test_busy(void)
+{
+    uint8_t frame[PAGES * WIDTH];
+    uint16_t staged[3 + PAGES * (8 + WIDTH)];
+    const volatile uint16_t *w;
+    unsigned int n;
+    windows_t win;
+
+    ssd1306_clear(&disp);
+    ssd1306_draw_string(&disp, 0, 0, 2, "21.50 C");
+    ssd1306_draw_square(&disp, 100, 40, 20, 20);
+    memcpy(frame, disp.buffer, sizeof frame);
+
+    CHECK(ssd1306_show_async(&disp));
+    CHECK(ssd1306_show_busy(&disp));
+    CHECK((w = pending(&n)) != NULL && n == 3 + PAGES * (8 + WIDTH));
+    win = check_words(w, n, frame);
+    CHECK(win.resync && all_pages_full(&win));
+    for (unsigned int i = 0; i < n; i++)
+    {
+        staged[i] = w[i];
+    }
+
+    // Redrawn while the frame is on the bus
+    ssd1306_clear(&disp);
+    ssd1306_draw_string(&disp, 0, 0, 2, "21.75 C");
+    CHECK(!ssd1306_show_async(&disp));
+    sim_dma_advance(disp.dma_chan, n / 3);
+    CHECK(ssd1306_show_busy(&disp));
+    CHECK(!ssd1306_show_async(&disp));
+    w = pending(&n);
+    for (unsigned int i = 0; i < n; i++)
+    {
+        CHECK(w[i] == staged[3 + PAGES * (8 + WIDTH) - n + i]);
+    }
+
+    ssd1306_show_wait(&disp);
+    CHECK(!ssd1306_show_busy(&disp));
+    CHECK(ram_is(frame));
+
+    // Only the columns that differ from the display ram
+    CHECK(ssd1306_show_async(&disp));
+    w = pending(&n);
+    win = check_words(w, n, disp.buffer);
+    CHECK(!win.resync);
+    for (int pg = 0; pg < PAGES; pg++)
+    {
+        int lo = WIDTH, hi = -1;
+
+        for (int col = 0; col < WIDTH; col++)
+        {
+            if (disp.buffer[pg * WIDTH + col] != frame[pg * WIDTH + col])
+            {
+                lo = col < lo ? col : lo;
+                hi = col;
+            }
+        }
+        if (hi < 0)
+        {
+            CHECK(win.lo[pg] > win.hi[pg]);
+        }
+        else
+        {
+            CHECK(win.lo[pg] == lo && win.hi[pg] == hi);
+        }
+    }
+    ssd1306_show_wait(&disp);
+    CHECK(ram_is(disp.buffer));
+
+    // Nothing changed: nothing is sent
+    CHECK(ssd1306_show_async(&disp));
+    CHECK(!ssd1306_show_busy(&disp));
+    CHECK(pending(&n) == NULL);
+}
+
+/*
+ * An abort in the middle of a page leaves the display ram unknown, so the
+ * next show sends every page whole, after the no-ops that complete a
+ * command cut short.
+ */
+static void test_abort(void)
+{
+    const volatile uint16_t *w;
+    unsigned int n;
+    windows_t win;
+
+    ssd1306_clear(&disp);
+    for (int y = 0; y < HEIGHT; y += 4)
+    {
+        ssd1306_draw_line(&disp, 0, y, WIDTH - 1, HEIGHT - 1 - y);
+    }
+    CHECK(ssd1306_show_async(&disp));
+    pending(&n);
+    sim_dma_advance(disp.dma_chan, n / 2 + 5);
+    CHECK(ssd1306_show_busy(&disp));
+    ssd1306_show_abort(&disp);
+    CHECK(!ssd1306_show_busy(&disp));
+    CHECK(!ram_is(disp.buffer));
+
+    CHECK(ssd1306_show_async(&disp));
+    w = pending(&n);
+    win = check_words(w, n, disp.buffer);
+    CHECK(win.resync && all_pages_full(&win));
+    ssd1306_show_wait(&disp);
+    CHECK(ram_is(disp.buffer));
+}
+
+/*
+ * A NACK stops the transfer; the driver stops the dma and sends every
+ * page whole on the next show.
+ */
+static void test_nack(void)
+{
+    const volatile uint16_t *w;
+    unsigned int n;
+    windows_t win;
+
+    sim.dev.addr = 0x3D;
+    ssd1306_draw_string(&disp, 0, 48, 1, "nack");
+    CHECK(ssd1306_show_async(&disp));
+    sim_dma_advance(disp.dma_chan, 8);
+    CHECK(!ssd1306_show_busy(&disp));
+    CHECK(pending(&n) == NULL);
+    sim.dev.addr = 0x3C;
+
+    CHECK(ssd1306_show_async(&disp));
+    w = pending(&n);
+    win = check_words(w, n, disp.buffer);
+    CHECK(win.resync && all_pages_full(&win));
+    ssd1306_show_wait(&disp);
+    CHECK(ram_is(disp.buffer));
+}
+
+int main(void)
+{
+    setup();
+
+    test_busy();
+    test_abort();
+    test_nack();
+
+    return check_status();
+}
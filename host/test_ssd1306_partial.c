@@ -0,0 +1,194 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pico/stdlib.h"
+#include "hardware/dma.h"
+
+#include <ssd1306.h>
+
+#include "check.h"
+#include "sim.h"
+
+/*
+ * Partial updates against full refreshes: random edits are drawn frame
+ * after frame and sent to one display with ssd1306_show() or
+ * ssd1306_show_async(), which send only the changed columns, and to a
+ * second display whole. The display ram of both must be the same after
+ * every frame, also after frames cut short by an abort or a NACK.
+ *
+ * Usage: test-ssd1306-partial [frames]
+ */
+
+#define DEFAULT_FRAMES (2000)
+
+#define WIDTH (128)
+#define HEIGHT (64)
+
+/* How a frame is sent to the display with partial updates */
+enum
+{
+    SHOW_SYNC,
+    SHOW_ASYNC,
+    SHOW_ABORT,
+    SHOW_NACK_SYNC,
+    SHOW_NACK_ASYNC,
+    SHOW_MODES
+};
+
+static sim_ssd1306_t sim_part, sim_full;
+static ssd1306_t part, full;
+
+static uint32_t rnd(uint32_t n)
+{
+    return (uint32_t)rand() % n;
+}
+
+/* A few random edits of the frame, seldom a new one */
+static void edit(ssd1306_t *p)
+{
+    static const char *const strs[] = {"21.50 C", "45 %", "1013 hPa", "-", "8"};
+
+    if (rnd(50) == 0)
+    {
+        ssd1306_clear(p);
+    }
+    for (uint32_t n = rnd(4); n > 0; n--)
+    {
+        uint32_t x = rnd(WIDTH), y = rnd(HEIGHT);
+
+        switch (rnd(5))
+        {
+        case 0:
+            ssd1306_draw_pixel(p, x, y);
+            break;
+        case 1:
+            ssd1306_clear_pixel(p, x, y);
+            break;
+        case 2:
+            ssd1306_draw_square(p, x, y, 1 + rnd(20), 1 + rnd(12));
+            break;
+        case 3:
+            ssd1306_clear_square(p, x, y, 1 + rnd(20), 1 + rnd(12));
+            break;
+        default:
+            ssd1306_draw_string(p, x, y, 1 + rnd(2), strs[rnd(count_of(strs))]);
+            break;
+        }
+    }
+}
+
+static bool same_ram(void)
+{
+    return memcmp(sim_part.ram, sim_full.ram, sizeof sim_part.ram) == 0;
+}
+
+static uint64_t bytes_sent(void)
+{
+    sim_i2c_stats_t st;
+
+    sim_i2c_stats(i2c0, &st);
+
+    return st.bytes;
+}
+
+/* Send the frame to the display with partial updates, as mode says. */
+static void show_part(int mode)
+{
+    unsigned int n;
+
+    switch (mode)
+    {
+    case SHOW_SYNC:
+        ssd1306_show(&part);
+        break;
+    case SHOW_ASYNC:
+        CHECK(ssd1306_show_async(&part));
+        ssd1306_show_wait(&part);
+        break;
+    case SHOW_ABORT:
+        CHECK(ssd1306_show_async(&part));
+        if (sim_dma_pending(part.dma_chan, &n) != NULL)
+        {
+            sim_dma_advance(part.dma_chan, rnd(n));
+            ssd1306_show_abort(&part);
+        }
+        break;
+    case SHOW_NACK_SYNC:
+        sim_part.nack_in = 1 + rnd(400);
+        ssd1306_show(&part);
+        break;
+    default:
+        sim_part.nack_in = 1 + rnd(400);
+        CHECK(ssd1306_show_async(&part));
+        ssd1306_show_wait(&part);
+        break;
+    }
+    // If the frame was shorter than that
+    sim_part.nack_in = 0;
+}
+
+int main(int argc, char **argv)
+{
+    unsigned long frames = argc > 1 ? strtoul(argv[1], NULL, 0)
+                                    : DEFAULT_FRAMES;
+    unsigned long cut = 0, stale = 0, compared = 0;
+    uint64_t part_bytes = 0, full_bytes = 0, t;
+
+    i2c_init(i2c0, 1000000);
+    sim_ssd1306_init(&sim_part, 0x3C);
+    sim_ssd1306_init(&sim_full, 0x3D);
+    sim_i2c_attach(i2c0, &sim_part.dev);
+    sim_i2c_attach(i2c0, &sim_full.dev);
+    CHECK(ssd1306_init(&part, WIDTH, HEIGHT, 0x3C, i2c0));
+    CHECK(ssd1306_init(&full, WIDTH, HEIGHT, 0x3D, i2c0));
+    CHECK(part.dma_chan >= 0);
+    sim_dma_defer(true);
+
+    srand(1);
+    for (unsigned long f = 0; f < frames; f++)
+    {
+        int mode = (int)rnd(SHOW_MODES * 4);
+
+        // Mostly complete frames
+        mode = mode < SHOW_MODES ? mode : (int)rnd(2);
+        edit(&part);
+
+        t = bytes_sent();
+        show_part(mode);
+        part_bytes += bytes_sent() - t;
+        CHECK(!ssd1306_show_busy(&part));
+
+        memcpy(full.buffer, part.buffer, full.bufsize);
+        full.shadow_valid = false;
+        t = bytes_sent();
+        ssd1306_show(&full);
+        full_bytes += bytes_sent() - t;
+
+        // After a cut frame the display ram is unknown until the next one
+        if (!part.shadow_valid)
+        {
+            cut++;
+            stale += !same_ram();
+            continue;
+        }
+        CHECK(same_ram());
+        compared++;
+    }
+
+    // The frame after the last cut one
+    edit(&part);
+    show_part(SHOW_ASYNC);
+    memcpy(full.buffer, part.buffer, full.bufsize);
+    full.shadow_valid = false;
+    ssd1306_show(&full);
+    CHECK(same_ram());
+
+    CHECK(stale > 0 && compared > 0);
+    CHECK(part_bytes < full_bytes);
+    printf("%lu frames, %lu cut short, bytes sent partial %llu full %llu\n",
+           frames, cut, (unsigned long long)part_bytes,
+           (unsigned long long)full_bytes);
+
+    return check_status();
+}
@@ -0,0 +1,487 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "pico/stdlib.h"
+
+#include "bme280.h"
+
+/*
+ * Benchmark of the bme280 compensation functions.
+ *
+ * Runs BME280_compensate_{T,P,H} over a corpus of raw ADC values for each
+ * calibration set below, reports the cost per call and checks every result
+ * bit for bit against the datasheet's reference implementation (section
+ * 4.2.3, copied below unchanged apart from the calibration argument).
+ * BME280_compensate_P_int32 is checked to be within P32_TOLERANCE instead.
+ * bme280_compensate_batch, whose pressure formula depends on the driver's
+ * build, is checked like that too, and timed per (T, P, H) triple.
+ *
+ * Before that, bme280_decode_raw is checked against the register dumps in
+ * frames[] and against the register encoding of every corpus value.
+ *
+ * Built for the host with PICO_METEO_HOST, where time is counted in ns, or
+ * as the bme280-bench image with PICO_METEO_BENCH, where cycles are counted
+ * with SysTick. The P64/P32 column is the cost of the 64-bit pressure
+ * compensation over the 32-bit one, the case for BME280_PRESSURE_INT32; on
+ * the host it says little about the Cortex-M0+. The image repeats the run
+ * every RERUN_MS, so that a console opened late still gets the results.
+ */
+
+/* Largest difference in LSB allowed for BME280_compensate_P_int32. */
+#define P32_TOLERANCE (4)
+
+/* Raw (T, P, H) triples per calibration set. */
+#define CORPUS_LEN (4096)
+
+/* Calls per timed batch; keeps a batch within SysTick's 24 bits. */
+#define BATCH (256)
+
+/* Times each corpus is run. */
+#define ROUNDS (64)
+
+/* Pause between runs of the bench image. */
+#define RERUN_MS (10000)
+
+#if PICO_ON_DEVICE
+#include "hardware/clocks.h"
+#include "hardware/structs/systick.h"
+
+#define BENCH_UNIT "cycles"
+
+static inline void bench_init(void)
+{
+    systick_hw->csr = 0;
+    systick_hw->rvr = 0xFFFFFF;
+    systick_hw->cvr = 0;
+    // Processor clock, no interrupt
+    systick_hw->csr = 0x5;
+}
+
+static inline uint32_t bench_now(void)
+{
+    // Counts down
+    return 0xFFFFFF - systick_hw->cvr;
+}
+
+static inline uint32_t bench_elapsed(uint32_t from, uint32_t to)
+{
+    return (to - from) & 0xFFFFFF;
+}
+#else
+#include <time.h>
+
+#define BENCH_UNIT "ns"
+
+static inline void bench_init(void)
+{
+}
+
+static inline uint32_t bench_now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint32_t)((uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec);
+}
+
+static inline uint32_t bench_elapsed(uint32_t from, uint32_t to)
+{
+    return to - from;
+}
+#endif
+
+typedef struct calib
+{
+    const char *name;
+    uint16_t T1;
+    int16_t T2, T3;
+    uint16_t P1;
+    int16_t P2, P3, P4, P5, P6, P7, P8, P9;
+    uint8_t H1;
+    int16_t H2;
+    uint8_t H3;
+    int16_t H4, H5;
+    int8_t H6;
+} calib_t;
+
+/* Representative calibration sets, spanning the spread between parts. */
+static const calib_t calibs[] = {
+    {"typical", 27504, 26435, -1000, 36477, -10685, 3024, 2855, 140, -7,
+     15500, -14600, 6000, 75, 370, 0, 313, 50, 30},
+    {"set-a", 28485, 26735, 50, 39064, -10872, 3024, 8373, -140, -7, 9900,
+     -10230, 4285, 75, 362, 0, 324, 0, 30},
+    {"set-b", 27636, 26594, 50, 37815, -10612, 3024, 6547, -147, -7, 9900,
+     -10230, 4285, 75, 364, 0, 301, 50, 30},
+    {"set-c", 28267, 26520, 50, 38012, -10639, 3024, 4683, 58, -7, 9900,
+     -10230, 4285, 75, 360, 0, 331, 0, 30},
+};
+
+typedef struct raw
+{
+    int32_t t, p, h;
+} raw_t;
+
+static raw_t corpus[CORPUS_LEN];
+
+/* Dumps of the data registers 0xF7..0xFE, and the raw values they hold. */
+static const struct
+{
+    uint8_t regs[BME280_DATA_LEN];
+    raw_t raw;
+} frames[] = {
+    // Room conditions, the values the host harness starts from
+    {{0x65, 0x5A, 0xC0, 0x7E, 0xED, 0x00, 0x69, 0x78}, {519888, 415148, 27000}},
+    // Measurements skipped, or not yet taken after a reset
+    {{0x80, 0x00, 0x00, 0x80, 0x00, 0x00, 0x80, 0x00}, {0x80000, 0x80000, 0x8000}},
+    // All bits set; the reserved lower nibbles of xlsb read as 0
+    {{0xFF, 0xFF, 0xF0, 0xFF, 0xFF, 0xF0, 0xFF, 0xFF}, {0xFFFFF, 0xFFFFF, 0xFFFF}},
+    // Only the xlsb bits, which land in the 4 low bits of the value
+    {{0x00, 0x00, 0x10, 0x00, 0x00, 0x80, 0x00, 0x00}, {8, 1, 0}},
+    {{0x00, 0x00, 0xA0, 0x00, 0x00, 0x50, 0x00, 0x00}, {5, 10, 0}},
+    // The reserved nibbles are ignored
+    {{0x00, 0x00, 0x0F, 0x00, 0x00, 0x0F, 0x00, 0x00}, {0, 0, 0}},
+    // Only hum_lsb, the last byte of the burst
+    {{0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01}, {0, 0, 1}},
+    // Each byte distinct, so that a byte out of place shows up
+    {{0x12, 0x34, 0x50, 0x67, 0x89, 0xA0, 0xBC, 0xDE}, {0x6789A, 0x12345, 0xBCDE}},
+};
+
+static bme280_raw_t batch_raw[CORPUS_LEN];
+static bme280_reading_t batch_out[CORPUS_LEN];
+
+static volatile uint32_t sink;
+
+/* --- Datasheet reference ------------------------------------------------ */
+
+static int32_t ref_t_fine;
+
+static int32_t ref_compensate_T(const calib_t *c, int32_t adc_T)
+{
+    int32_t var1, var2, T;
+    var1 = ((((adc_T >> 3) - ((int32_t)c->T1 << 1))) * ((int32_t)c->T2)) >> 11;
+    var2 = (((((adc_T >> 4) - ((int32_t)c->T1)) * ((adc_T >> 4) - ((int32_t)c->T1))) >> 12) * ((int32_t)c->T3)) >> 14;
+    ref_t_fine = var1 + var2;
+    T = (ref_t_fine * 5 + 128) >> 8;
+    return T;
+}
+
+static uint32_t ref_compensate_P(const calib_t *c, int32_t adc_P)
+{
+    int64_t var1, var2, p;
+    var1 = ((int64_t)ref_t_fine) - 128000;
+    var2 = var1 * var1 * (int64_t)c->P6;
+    var2 = var2 + ((var1 * (int64_t)c->P5) << 17);
+    var2 = var2 + (((int64_t)c->P4) << 35);
+    var1 = ((var1 * var1 * (int64_t)c->P3) >> 8) + ((var1 * (int64_t)c->P2) << 12);
+    var1 = (((((int64_t)1) << 47) + var1)) * ((int64_t)c->P1) >> 33;
+    if (var1 == 0)
+    {
+        return 0;
+    }
+    p = 1048576 - adc_P;
+    p = (((p << 31) - var2) * 3125) / var1;
+    var1 = (((int64_t)c->P9) * (p >> 13) * (p >> 13)) >> 25;
+    var2 = (((int64_t)c->P8) * p) >> 19;
+    p = ((p + var1 + var2) >> 8) + (((int64_t)c->P7) << 4);
+    return (uint32_t)p;
+}
+
+static uint32_t ref_compensate_H(const calib_t *c, int32_t adc_H)
+{
+    int32_t v_x1_u32r;
+    v_x1_u32r = (ref_t_fine - ((int32_t)76800));
+    v_x1_u32r = (((((adc_H << 14) - (((int32_t)c->H4) << 20) - (((int32_t)c->H5) * v_x1_u32r)) + ((int32_t)16384)) >> 15) *
+                 (((((((v_x1_u32r * ((int32_t)c->H6)) >> 10) * (((v_x1_u32r * ((int32_t)c->H3)) >> 11) + ((int32_t)32768))) >> 10) + ((int32_t)2097152)) * ((int32_t)c->H2) + 8192) >> 14));
+    v_x1_u32r = (v_x1_u32r - (((((v_x1_u32r >> 15) * (v_x1_u32r >> 15)) >> 7) * ((int32_t)c->H1)) >> 4));
+    v_x1_u32r = (v_x1_u32r < 0 ? 0 : v_x1_u32r);
+    v_x1_u32r = (v_x1_u32r > 419430400 ? 419430400 : v_x1_u32r);
+    return (uint32_t)(v_x1_u32r >> 12);
+}
+
+/* ------------------------------------------------------------------------ */
+
+static void load_calib(bme280_t *sensor, const calib_t *c)
+{
+    sensor->dig_T1 = c->T1;
+    sensor->dig_T2 = c->T2;
+    sensor->dig_T3 = c->T3;
+    sensor->dig_P1 = c->P1;
+    sensor->dig_P2 = c->P2;
+    sensor->dig_P3 = c->P3;
+    sensor->dig_P4 = c->P4;
+    sensor->dig_P5 = c->P5;
+    sensor->dig_P6 = c->P6;
+    sensor->dig_P7 = c->P7;
+    sensor->dig_P8 = c->P8;
+    sensor->dig_P9 = c->P9;
+    sensor->dig_H1 = c->H1;
+    sensor->dig_H2 = c->H2;
+    sensor->dig_H3 = c->H3;
+    sensor->dig_H4 = c->H4;
+    sensor->dig_H5 = c->H5;
+    sensor->dig_H6 = c->H6;
+    bme280_calib_derive(sensor);
+}
+
+/*
+ * Raw values over the whole ADC range the sensor produces for -40..85 DegC,
+ * 300..1100 hPa and 0..100 %RH, from a fixed seed so that runs compare.
+ */
+static void make_corpus(void)
+{
+    uint32_t x = 1;
+
+    for (int i = 0; i < CORPUS_LEN; i++)
+    {
+        x = x * 1664525 + 1013904223;
+        corpus[i].t = 300000 + (int32_t)((x >> 8) % 420000);
+        x = x * 1664525 + 1013904223;
+        corpus[i].p = 150000 + (int32_t)((x >> 8) % 500000);
+        x = x * 1664525 + 1013904223;
+        corpus[i].h = (int32_t)((x >> 8) % 65536);
+
+        batch_raw[i].T = corpus[i].t;
+        batch_raw[i].P = corpus[i].p;
+        batch_raw[i].H = corpus[i].h;
+    }
+}
+
+/* Store a raw reading in the data registers as the sensor does. */
+static void encode_frame(const raw_t *r, uint8_t regs[BME280_DATA_LEN])
+{
+    regs[0] = (uint8_t)(r->p >> 12);
+    regs[1] = (uint8_t)(r->p >> 4);
+    regs[2] = (uint8_t)(r->p << 4);
+    regs[3] = (uint8_t)(r->t >> 12);
+    regs[4] = (uint8_t)(r->t >> 4);
+    regs[5] = (uint8_t)(r->t << 4);
+    regs[6] = (uint8_t)(r->h >> 8);
+    regs[7] = (uint8_t)r->h;
+}
+
+static int decode_mismatch(const uint8_t regs[BME280_DATA_LEN],
+                           const raw_t *expected)
+{
+    bme280_raw_t raw;
+
+    bme280_decode_raw(regs, &raw);
+    if (raw.T == expected->t && raw.P == expected->p && raw.H == expected->h)
+    {
+        return 0;
+    }
+
+    printf("  decoded %02x %02x %02x %02x %02x %02x %02x %02x as "
+           "%ld/%ld/%ld, expected %ld/%ld/%ld\n",
+           regs[0], regs[1], regs[2], regs[3], regs[4], regs[5], regs[6],
+           regs[7], (long)raw.T, (long)raw.P, (long)raw.H, (long)expected->t,
+           (long)expected->p, (long)expected->h);
+    return 1;
+}
+
+/* Number of frames and corpus values that bme280_decode_raw gets wrong. */
+static int verify_decode(void)
+{
+    uint8_t regs[BME280_DATA_LEN];
+    int mismatches = 0;
+
+    for (size_t i = 0; i < count_of(frames); i++)
+    {
+        mismatches += decode_mismatch(frames[i].regs, &frames[i].raw);
+    }
+    for (int i = 0; i < CORPUS_LEN; i++)
+    {
+        encode_frame(&corpus[i], regs);
+        mismatches += decode_mismatch(regs, &corpus[i]);
+    }
+
+    return mismatches;
+}
+
+/*
+ * Number of results that differ from the reference. The largest difference
+ * of BME280_compensate_P_int32 is stored in p32_err.
+ */
+static int verify(bme280_t *sensor, const calib_t *c, uint32_t *p32_err)
+{
+    int mismatches = 0;
+
+    *p32_err = 0;
+    bme280_compensate_batch(sensor, batch_raw, batch_out, CORPUS_LEN);
+    for (int i = 0; i < CORPUS_LEN; i++)
+    {
+        const raw_t *r = &corpus[i];
+
+        int32_t t = BME280_compensate_T_int32(sensor, r->t);
+        uint32_t p = BME280_compensate_P_int64(sensor, r->p);
+        uint32_t h = BME280_compensate_H_int32(sensor, r->h);
+        uint32_t p32 = BME280_compensate_P_int32(sensor, r->p);
+
+        int32_t ref_t = ref_compensate_T(c, r->t);
+        uint32_t ref_p = ref_compensate_P(c, r->p);
+        uint32_t ref_h = ref_compensate_H(c, r->h);
+        uint32_t err = p32 > ref_p ? p32 - ref_p : ref_p - p32;
+        const bme280_reading_t *b = &batch_out[i];
+        uint32_t batch_err = b->pressure > ref_p ? b->pressure - ref_p
+                                                 : ref_p - b->pressure;
+
+        if (err > *p32_err)
+        {
+            *p32_err = err;
+        }
+        if (b->temperature != ref_t || b->humidity != ref_h ||
+            batch_err > P32_TOLERANCE)
+        {
+            if (mismatches++ == 0)
+            {
+                printf("  batch mismatch at raw %ld/%ld/%ld\n", (long)r->t,
+                       (long)r->p, (long)r->h);
+            }
+        }
+
+        if (t != ref_t || p != ref_p || h != ref_h)
+        {
+            if (mismatches++ == 0)
+            {
+                printf("  mismatch at raw %ld/%ld/%ld: %ld/%lu/%lu, "
+                       "expected %ld/%lu/%lu\n",
+                       (long)r->t, (long)r->p, (long)r->h, (long)t,
+                       (unsigned long)p, (unsigned long)h, (long)ref_t,
+                       (unsigned long)ref_p, (unsigned long)ref_h);
+            }
+        }
+    }
+
+    return mismatches;
+}
+
+enum
+{
+    FN_T,
+    FN_P64,
+    FN_P32,
+    FN_H,
+    FN_BATCH,
+    NUM_FNS
+};
+
+/*
+ * Time each function separately. P and H depend on the t_fine of the
+ * temperature compensated last, so T runs once per sample before each of
+ * them; its cost is subtracted.
+ */
+static void bench(bme280_t *sensor, double per_call[NUM_FNS])
+{
+    uint64_t total[NUM_FNS] = {0};
+
+    for (int round = 0; round < ROUNDS; round++)
+    {
+        for (int i = 0; i < CORPUS_LEN; i += BATCH)
+        {
+            const raw_t *r = &corpus[i];
+            uint32_t acc = 0, t0;
+
+            t0 = bench_now();
+            for (int j = 0; j < BATCH; j++)
+            {
+                acc += (uint32_t)BME280_compensate_T_int32(sensor, r[j].t);
+            }
+            total[FN_T] += bench_elapsed(t0, bench_now());
+
+            t0 = bench_now();
+            for (int j = 0; j < BATCH; j++)
+            {
+                acc += (uint32_t)BME280_compensate_T_int32(sensor, r[j].t);
+                acc += BME280_compensate_P_int64(sensor, r[j].p);
+            }
+            total[FN_P64] += bench_elapsed(t0, bench_now());
+
+            t0 = bench_now();
+            for (int j = 0; j < BATCH; j++)
+            {
+                acc += (uint32_t)BME280_compensate_T_int32(sensor, r[j].t);
+                acc += BME280_compensate_P_int32(sensor, r[j].p);
+            }
+            total[FN_P32] += bench_elapsed(t0, bench_now());
+
+            t0 = bench_now();
+            for (int j = 0; j < BATCH; j++)
+            {
+                acc += (uint32_t)BME280_compensate_T_int32(sensor, r[j].t);
+                acc += BME280_compensate_H_int32(sensor, r[j].h);
+            }
+            total[FN_H] += bench_elapsed(t0, bench_now());
+
+            t0 = bench_now();
+            bme280_compensate_batch(sensor, &batch_raw[i], &batch_out[i], BATCH);
+            total[FN_BATCH] += bench_elapsed(t0, bench_now());
+
+            sink += acc;
+        }
+    }
+
+    double calls = (double)ROUNDS * CORPUS_LEN;
+    per_call[FN_T] = total[FN_T] / calls;
+    for (int fn = FN_T + 1; fn < FN_BATCH; fn++)
+    {
+        per_call[fn] = (total[fn] - (double)total[FN_T]) / calls;
+    }
+    per_call[FN_BATCH] = total[FN_BATCH] / calls;
+}
+
+static int run(void)
+{
+    static bme280_t sensor;
+    int failed = 0;
+
+#if PICO_ON_DEVICE
+    printf("bme280-bench: clk_sys %lu Hz\n",
+           (unsigned long)clock_get_hz(clk_sys));
+#endif
+    int decode_errs = verify_decode();
+    printf("decode: %u frames, %d values: %s\n", (unsigned)count_of(frames),
+           CORPUS_LEN, decode_errs == 0 ? "exact" : "MISMATCH");
+    failed |= decode_errs != 0;
+
+    printf("%-8s %8s %8s %8s %8s %8s %8s  (%s/call)\n", "calib", "T", "P64",
+           "P32", "H", "batch", "P64/P32", BENCH_UNIT);
+    for (size_t i = 0; i < count_of(calibs); i++)
+    {
+        const calib_t *c = &calibs[i];
+        double per_call[NUM_FNS];
+        uint32_t p32_err;
+
+        load_calib(&sensor, c);
+        int mismatches = verify(&sensor, c, &p32_err);
+        bench(&sensor, per_call);
+
+        printf("%-8s %8.1f %8.1f %8.1f %8.1f %8.1f %8.2f  %s, "
+               "P32 within %lu LSB\n",
+               c->name, per_call[FN_T], per_call[FN_P64], per_call[FN_P32],
+               per_call[FN_H], per_call[FN_BATCH],
+               per_call[FN_P64] / per_call[FN_P32],
+               mismatches == 0 ? "exact" : "MISMATCH",
+               (unsigned long)p32_err);
+        failed |= mismatches != 0 || p32_err > P32_TOLERANCE;
+    }
+
+    return failed;
+}
+
+int main(void)
+{
+    stdio_init_all();
+    bench_init();
+    make_corpus();
+
+#if PICO_ON_DEVICE
+    for (;;)
+    {
+        // Also gives the usb host time to open the console
+        sleep_ms(RERUN_MS);
+        run();
+    }
+#else
+    return run();
+#endif
+}
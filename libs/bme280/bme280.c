@@ -4,6 +4,16 @@
 #include <string.h>
 #include "stdio.h"
 
+// Pressure compensation used by the read functions
+#if BME280_PRESSURE_INT32
+#define compensate_P compensate_P_int32
+#else
+#define compensate_P compensate_P_int64
+#endif
+
+// Longest wait for an address probe by get_bme280_addrs(), in us
+#define BME280_PROBE_TIMEOUT_US (1000)
+
 const char *bme280_strerr(int8_t errcode)
 {
     switch (errcode)
@@ -45,6 +55,10 @@ uint8_t *get_bme280_addrs(i2c_inst_t *const i2c_bus)
     // First element contains array length!
     int addr_max = 3;
     uint8_t *addrs = malloc(sizeof(uint8_t) * addr_max);
+    if (addrs == NULL)
+    {
+        return NULL;
+    }
     addrs[0] = 1;
 
     // scan for address
@@ -56,29 +70,26 @@ uint8_t *get_bme280_addrs(i2c_inst_t *const i2c_bus)
         }
 
         uint8_t rt_data;
-        if (i2c_read_blocking(i2c_bus, addr, &rt_data, 1, false) != PICO_ERROR_GENERIC)
+        // Bounded, so that a stuck bus does not hang the scan
+        if (i2c_read_timeout_us(i2c_bus, addr, &rt_data, 1, false,
+                                BME280_PROBE_TIMEOUT_US) == 1)
         {
             // found device!
             if (addrs[0] == addr_max)
             {
-                void *new = realloc(addrs, addr_max + 2);
+                addr_max *= 2;
+                void *new = realloc(addrs, addr_max);
                 if (new == NULL)
                 {
-                    free(new);
                     free(addrs);
                     return NULL;
                 }
-                else
-                {
-                    addrs = (uint8_t *)new;
-                }
-            }
-            else
-            {
-                // add address to the furthest back pos and inc count
-                addrs[addrs[0]] = addr;
-                addrs[0]++;
+                addrs = (uint8_t *)new;
             }
+
+            // add address to the furthest back pos and inc count
+            addrs[addrs[0]] = addr;
+            addrs[0]++;
         }
     }
 
@@ -120,22 +131,23 @@ int write_bme280(bme280_t *sensor, uint8_t *data, int to_write)
     return res;
 }
 
-// t_fine carries fine temperature as global value
-int32_t t_fine;
-int32_t BME280_compensate_T_int32(bme280_t *const sensor, int32_t raw_T)
+// The datasheet formulas, with t_fine passed explicitly instead of in a global,
+// shared by the single value and the batch functions.
+
+static inline int32_t compensate_T(const bme280_t *const sensor, int32_t raw_T, int32_t *const t_fine)
 {
     int32_t var1, var2, T;
     var1 = ((((raw_T >> 3) - ((int32_t)sensor->dig_T1 << 1))) * ((int32_t)sensor->dig_T2)) >> 11;
     var2 = (((((raw_T >> 4) - ((int32_t)sensor->dig_T1)) * ((raw_T >> 4) - ((int32_t)sensor->dig_T1))) >> 12) * ((int32_t)sensor->dig_T3)) >> 14;
-    t_fine = var1 + var2;
-    T = (t_fine * 5 + 128) >> 8;
+    *t_fine = var1 + var2;
+    T = (*t_fine * 5 + 128) >> 8;
 
     return T;
 }
 
 // Returns pressure in Pa as unsigned 32 bit integer in Q24.8 format (24 integer bits and 8 fractional bits).
 // Output value of “24674867” represents 24674867/256 = 96386.2 Pa = 963.862 hPa
-uint32_t BME280_compensate_P_int64(bme280_t *const sensor, int32_t raw_P)
+static inline uint32_t compensate_P_int64(const bme280_t *const sensor, int32_t t_fine, int32_t raw_P)
 {
     int64_t var1, var2, p;
     var1 = ((int64_t)t_fine) - 128000;
@@ -160,9 +172,91 @@ uint32_t BME280_compensate_P_int64(bme280_t *const sensor, int32_t raw_P)
     return (uint32_t)p;
 }
 
+// (a * b) >> s, with 32-bit multiplies only. The Cortex-M0+ has no 32x32->64
+// multiply, so a 64-bit product would need a call into libgcc.
+static inline uint32_t umul_shr(uint32_t a, uint32_t b, unsigned s)
+{
+    uint32_t al = a & 0xFFFF, ah = a >> 16;
+    uint32_t bl = b & 0xFFFF, bh = b >> 16;
+    uint32_t ll = al * bl, lh = al * bh, hl = ah * bl, hh = ah * bh;
+    uint32_t mid = (ll >> 16) + (lh & 0xFFFF) + (hl & 0xFFFF);
+    uint32_t lo = (mid << 16) | (ll & 0xFFFF);
+    uint32_t hi = hh + (lh >> 16) + (hl >> 16) + (mid >> 16);
+
+    return s >= 32 ? hi >> (s - 32) : (hi << (32 - s)) | (lo >> s);
+}
+
+// Signed variant of umul_shr, rounding towards zero
+static inline int32_t smul_shr(int32_t a, int32_t b, unsigned s)
+{
+    uint32_t r = umul_shr(a < 0 ? -(uint32_t)a : (uint32_t)a,
+                          b < 0 ? -(uint32_t)b : (uint32_t)b, s);
+
+    return (a < 0) != (b < 0) ? -(int32_t)r : (int32_t)r;
+}
+
+// (a * b) >> s for a 16-bit b, such as a calibration value, which takes two
+// multiplies. Rounds down like the shifts in the datasheet formulas. hi may
+// be negative, so it is shifted left as unsigned.
+static inline int32_t smul16_shr(int32_t a, int16_t b, unsigned s)
+{
+    int32_t hi = (a >> 16) * b;
+    int32_t lo = (int32_t)(a & 0xFFFF) * b;
+
+    return s >= 16 ? (hi + (lo >> 16)) >> (s - 16)
+                   : (int32_t)((uint32_t)hi << (16 - s)) + (lo >> s);
+}
+
+// Same result as BME280_compensate_P_int64 within 4 LSB. Intermediate values
+// are in Q.8 (raw units), Q2.30 (factors) or Q24.8 (pressure).
+static inline uint32_t compensate_P_int32(const bme280_t *const sensor, int32_t t_fine, int32_t raw_P)
+{
+    if (sensor->p_scale == 0)
+    {
+        return compensate_P_int64(sensor, t_fine, raw_P);
+    }
+
+    int32_t u = t_fine - 128000;
+    uint32_t abs_u = u < 0 ? -(uint32_t)u : (uint32_t)u;
+    int32_t sq = (int32_t)umul_shr(abs_u, abs_u, 16);
+
+    // Offset of the raw value, var2 / 2^31 in the 64-bit formula
+    int32_t off = (int32_t)sensor->dig_P4 * 4096 +
+                  smul16_shr(u, sensor->dig_P5, 6) +
+                  smul16_shr(sq, sensor->dig_P6, 7);
+
+    // The divisor var1 is dig_P1 * 2^14 * (1 + x)
+    int32_t x = smul16_shr(u, sensor->dig_P2, 5) + smul16_shr(sq, sensor->dig_P3, 9);
+    uint32_t d = (1u << 30) + x;
+
+    // 1 / (1 + x), starting from 1 - x + x^2
+    uint32_t y = (1u << 30) - x + smul_shr(x, x, 30);
+    for (int i = 0; i < 2; i++)
+    {
+        uint32_t e = (1u << 31) - umul_shr(d, y, 30);
+        y = umul_shr(y, e, 30);
+    }
+
+    int32_t m = ((1048576 - raw_P) << 8) - off;
+    if (m <= 0)
+    {
+        return 0;
+    }
+
+    uint32_t scale = umul_shr(sensor->p_scale, y, 32);
+    int32_t p = (int32_t)umul_shr(m, scale, 30);
+
+    int32_t p_sq = (int32_t)umul_shr(p, p, 20);
+    p += smul16_shr(p, sensor->dig_P8, 19) +
+         smul16_shr(p_sq, sensor->dig_P9, 23) +
+         (int32_t)sensor->dig_P7 * 16;
+
+    return (uint32_t)p;
+}
+
 // Returns humidity in %RH as unsigned 32 bit integer in Q22.10 format (22 integer and 10 fractional bits).
 // Output value of “47445” represents 47445/1024 = 46.333 %RH
-uint32_t BME280_compensate_H_int32(bme280_t *const sensor, int32_t raw_H)
+static inline uint32_t compensate_H(const bme280_t *const sensor, int32_t t_fine, int32_t raw_H)
 {
     int32_t v_x1_u32r;
     v_x1_u32r = (t_fine - ((int32_t)76800));
@@ -177,11 +271,138 @@ uint32_t BME280_compensate_H_int32(bme280_t *const sensor, int32_t raw_H)
     return (uint32_t)(v_x1_u32r >> 12);
 }
 
+int32_t BME280_compensate_T_int32(bme280_t *const sensor, int32_t raw_T)
+{
+    return compensate_T(sensor, raw_T, &sensor->t_fine);
+}
+
+uint32_t BME280_compensate_P_int64(bme280_t *const sensor, int32_t raw_P)
+{
+    return compensate_P_int64(sensor, sensor->t_fine, raw_P);
+}
+
+uint32_t BME280_compensate_P_int32(bme280_t *const sensor, int32_t raw_P)
+{
+    return compensate_P_int32(sensor, sensor->t_fine, raw_P);
+}
+
+uint32_t BME280_compensate_H_int32(bme280_t *const sensor, int32_t raw_H)
+{
+    return compensate_H(sensor, sensor->t_fine, raw_H);
+}
+
+void bme280_compensate_batch(bme280_t *const sensor,
+                             const bme280_raw_t *raw,
+                             bme280_reading_t *out,
+                             size_t n)
+{
+    // out cannot alias a local copy, so the calibration values are loaded
+    // once instead of after every store
+    const bme280_t calib = *sensor;
+    int32_t t_fine = calib.t_fine;
+
+    for (size_t i = 0; i < n; i++)
+    {
+        out[i].temperature = compensate_T(&calib, raw[i].T, &t_fine);
+        out[i].pressure = compensate_P(&calib, t_fine, raw[i].P);
+        out[i].humidity = compensate_H(&calib, t_fine, raw[i].H);
+    }
+
+    sensor->t_fine = t_fine;
+}
+
+static void store_reading(bme280_t *const sensor, int32_t temp_raw, int32_t press_raw, int32_t hum_raw)
+{
+    bme280_raw_t raw = {.T = temp_raw, .P = press_raw, .H = hum_raw};
+    bme280_reading_t reading;
+
+    bme280_compensate_batch(sensor, &raw, &reading, 1);
+    sensor->temperature = reading.temperature;
+    sensor->pressure = reading.pressure;
+    sensor->humidity = reading.humidity;
+}
+
+void bme280_calib_derive(bme280_t *const sensor)
+{
+    // 6250 / dig_P1 must be less than 1 to fit in Q0.32
+    if (sensor->dig_P1 > 6250)
+    {
+        sensor->p_scale = (uint32_t)(((uint64_t)6250 << 32) / sensor->dig_P1);
+    }
+    else
+    {
+        sensor->p_scale = 0;
+    }
+}
+
+// Oversampling factors of the osrs_t, osrs_p and osrs_h register fields
+static const uint8_t osrs_factor[8] = {0, 1, 2, 4, 8, 16, 16, 16};
+
+uint32_t bme280_meas_time_us(const bme280_t *const sensor)
+{
+    unsigned t = osrs_factor[(sensor->ctrl_meas >> 5) & 0x7];
+    unsigned p = osrs_factor[(sensor->ctrl_meas >> 2) & 0x7];
+    unsigned h = osrs_factor[sensor->ctrl_hum & 0x7];
+
+    // Maximum measurement time, datasheet section 9.1
+    uint32_t us = 1250 + 2300 * t;
+    if (p > 0)
+    {
+        us += 2300 * p + 575;
+    }
+    if (h > 0)
+    {
+        us += 2300 * h + 575;
+    }
+
+    return us;
+}
+
+void bme280_decode_raw(const uint8_t *const buffer, bme280_raw_t *const raw)
+{
+    // Pressure and temperature are 20 bits, with the 4 low bits in the upper
+    // nibble of the xlsb register, whose lower nibble is reserved
+    raw->P = (buffer[0] << 12) | (buffer[1] << 4) | (buffer[2] >> 4);
+    raw->T = (buffer[3] << 12) | (buffer[4] << 4) | (buffer[5] >> 4);
+    raw->H = (buffer[6] << 8) | buffer[7];
+}
+
+int8_t bme280_trigger(bme280_t *const sensor)
+{
+    // ctrl_hum and config were written by the last settings update, and a
+    // write to ctrl_meas is all that starts a measurement
+    uint8_t write_buff[2] = {BME280_REG_CTRL_MEAS, sensor->ctrl_meas};
+    if (write_bme280(sensor, write_buff, 2) < 0)
+    {
+        return BME280_WRITE_ERR;
+    }
+
+    return BME280_OK;
+}
+
+int8_t bme280_burst_read(bme280_t *const sensor)
+{
+    uint8_t buffer[BME280_DATA_LEN];
+    bme280_raw_t raw;
+
+    // The data registers are shadowed during a burst read, so they are
+    // consistent even if a measurement completes meanwhile
+    if (read_bme280(sensor, BME280_READ_ALL_START_REG, buffer, sizeof buffer) < 0)
+    {
+        return BME280_READ_ERR;
+    }
+
+    bme280_decode_raw(buffer, &raw);
+    store_reading(sensor, raw.T, raw.P, raw.H);
+
+    return BME280_OK;
+}
+
 int8_t bme280_forced_read(bme280_t *sensor)
 {
     uint8_t write_buff[2] = {BME280_REG_CONFIG, sensor->config};
     // write config
-    if (write_bme280(sensor, write_buff, 2) == BME280_WRITE_ERR)
+    if (write_bme280(sensor, write_buff, 2) < 0)
     {
         return BME280_SETTINGS_WRITE_ERR;
     }
@@ -189,7 +410,7 @@ int8_t bme280_forced_read(bme280_t *sensor)
     // write ctrl_hum
     write_buff[0] = BME280_REG_CTRL_HUM;
     write_buff[1] = sensor->ctrl_hum;
-    if (write_bme280(sensor, write_buff, 2) == BME280_WRITE_ERR)
+    if (write_bme280(sensor, write_buff, 2) < 0)
     {
         return BME280_SETTINGS_WRITE_ERR;
     }
@@ -197,65 +418,36 @@ int8_t bme280_forced_read(bme280_t *sensor)
     // write ctrl_meas
     write_buff[0] = BME280_REG_CTRL_MEAS;
     write_buff[1] = sensor->ctrl_meas;
-    if (write_bme280(sensor, write_buff, 2) == BME280_WRITE_ERR)
+    if (write_bme280(sensor, write_buff, 2) < 0)
     {
         return BME280_SETTINGS_WRITE_ERR;
     }
 
     do
     {
-        if (read_bme280(sensor, BME280_REG_STATUS, &write_buff[0], 1) == BME280_READ_ERR)
+        if (read_bme280(sensor, BME280_REG_STATUS, &write_buff[0], 1) < 0)
         {
             return BME280_SETTINGS_READ_ERR;
         }
 
     } while ((write_buff[0] & 0x9) > 0);
 
-    uint8_t buffer[8];
-    if (read_bme280(sensor, BME280_READ_ALL_START_REG, buffer, 7) == BME280_READ_ERR)
-    {
-        return BME280_SETTINGS_READ_ERR;
-    }
-
-    int32_t press_raw = (buffer[0] << 12) | (buffer[1] << 4) | (buffer[2] & 0xF);
-    int32_t temp_raw = (buffer[3] << 12) | (buffer[4] << 4) | (buffer[5] & 0xF);
-    int32_t hum_raw = (buffer[6] << 8) | buffer[7];
-
-    sensor->temperature = BME280_compensate_T_int32(sensor, temp_raw);
-    sensor->pressure = BME280_compensate_P_int64(sensor, press_raw);
-    sensor->humidity = BME280_compensate_H_int32(sensor, hum_raw);
-
-    return BME280_OK;
+    return bme280_burst_read(sensor);
 }
 
 int8_t bme280_normal_read(bme280_t *const sensor)
 {
-    uint8_t buffer[8];
+    uint8_t status;
     do
     {
-        if (read_bme280(sensor, BME280_REG_STATUS, &buffer[0], 1) == BME280_READ_ERR)
+        if (read_bme280(sensor, BME280_REG_STATUS, &status, 1) < 0)
         {
             return BME280_SETTINGS_READ_ERR;
         }
 
-    } while ((buffer[0] & 0x9) > 0);
+    } while ((status & 0x9) > 0);
 
-    memset(&buffer[0], 0, sizeof buffer);
-
-    if (read_bme280(sensor, BME280_READ_ALL_START_REG, buffer, 7) == BME280_READ_ERR)
-    {
-        return BME280_SETTINGS_READ_ERR;
-    }
-
-    int32_t press_raw = (buffer[0] << 12) | (buffer[1] << 4) | (buffer[2] & 0xF);
-    int32_t temp_raw = (buffer[3] << 12) | (buffer[4] << 4) | (buffer[5] & 0xF);
-    int32_t hum_raw = (buffer[6] << 8) | buffer[7];
-
-    sensor->temperature = BME280_compensate_T_int32(sensor, temp_raw);
-    sensor->pressure = BME280_compensate_P_int64(sensor, press_raw);
-    sensor->humidity = BME280_compensate_H_int32(sensor, hum_raw);
-
-    return BME280_OK;
+    return bme280_burst_read(sensor);
 }
 
 void bme280_fmt_temp(bme280_t *const sensor, char *dest)
@@ -346,6 +538,7 @@ int8_t bme280_init(
     sensor->dig_H4 = (int16_t)((calib_buff[28] << 4) | (calib_buff[29] & 0xF));
     sensor->dig_H5 = (int16_t)(((calib_buff[29] & 0xF0) << 4) | calib_buff[30]);
     sensor->dig_H6 = (int8_t)calib_buff[31];
+    bme280_calib_derive(sensor);
 
     sensor->config = config;
     sensor->ctrl_hum = humidity_oversample;
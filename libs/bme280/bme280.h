@@ -45,6 +45,9 @@ typedef struct
     /** @brief Contains humidity as a percentage, first 22 bits represent
      * integer part and last 10 bits represent fractional part. */
     uint32_t humidity;
+    /** @brief Fine temperature of the last temperature compensation, used to
+     * compensate pressure and humidity. */
+    int32_t t_fine;
     /**
      * \name Below is Calibration Data - DO NOT MODIFY - Set by init function
      * from constant data on sensor. See datasheet for more information.
@@ -85,8 +88,35 @@ typedef struct
     int16_t dig_H5;
     /** @brief Constant calibration data - DO NOT MODIFY! */
     int8_t dig_H6;
+    /** @brief 6250 / dig_P1 in Q0.32 format, or 0 if it does not fit. Derived
+     * from the calibration data by `bme280_calib_derive`. */
+    uint32_t p_scale;
 } bme280_t;
 
+/**
+ * @brief Raw ADC values of one reading, as read from the data registers.
+ */
+typedef struct
+{
+    /** @brief 20-bit temperature value */
+    int32_t T;
+    /** @brief 20-bit pressure value */
+    int32_t P;
+    /** @brief 16-bit humidity value */
+    int32_t H;
+} bme280_raw_t;
+
+/**
+ * @brief One compensated reading, in the formats of the temperature, pressure
+ * and humidity members of `bme280_t`.
+ */
+typedef struct
+{
+    int32_t temperature;
+    uint32_t pressure;
+    uint32_t humidity;
+} bme280_reading_t;
+
 /**
  * @brief Call with driver error code to get a string explaining the error.
  * @return A string literal containing a description of the error.
@@ -148,6 +178,8 @@ int write_bme280(bme280_t *const sensor, uint8_t *data, int to_write);
  * values).
  * @param raw_T Raw temperature value to compensate.
  *
+ * The fine temperature is stored in sensor for the pressure and humidity
+ * compensation functions that follow.
  * This function should typically only need to be used by the driver internally.
  */
 int32_t BME280_compensate_T_int32(bme280_t *const sensor, int32_t raw_T);
@@ -167,6 +199,29 @@ int32_t BME280_compensate_T_int32(bme280_t *const sensor, int32_t raw_T);
  */
 uint32_t BME280_compensate_P_int64(bme280_t *const sensor, int32_t raw_P);
 
+/**
+ * @brief Pressure compensation with 32-bit integer multiplies only and no
+ * division, as an alternative to `BME280_compensate_P_int64`.
+ * @return Type uint32_t containing pressure in Pa, first 24 bits contain
+ * represent part and last 8 bits represent fractional part.
+ * @param sensor Sensor instance reading was taken from (to get compensation
+ * values).
+ * @param raw_P Raw pressure value to compensate.
+ *
+ * The datasheet formula divides by a term that depends on the temperature.
+ * Here that term is split into dig_P1, whose reciprocal is precomputed by
+ * `bme280_calib_derive`, and a factor close to 1, whose reciprocal is found
+ * with two Newton iterations. Over -40..85 DegC and 300..1100 hPa the result
+ * is within 4 LSB (1/64 Pa) of `BME280_compensate_P_int64`, see
+ * `bench/bme280_bench.c`. If dig_P1 is too small for the precomputed
+ * reciprocal, the 64-bit formula is used instead.
+ *
+ * The read functions use this formula if the driver is built with
+ * BME280_PRESSURE_INT32 defined to 1.
+ * This function should typically only need to be used by the driver internally.
+ */
+uint32_t BME280_compensate_P_int32(bme280_t *const sensor, int32_t raw_P);
+
 /**
  * @brief Pressure compensation formula implementation from BME280 datasheet.
  * @return Type uint32_t Containing humidity as a percentage, first 22 bits
@@ -179,6 +234,45 @@ uint32_t BME280_compensate_P_int64(bme280_t *const sensor, int32_t raw_P);
  */
 uint32_t BME280_compensate_H_int32(bme280_t *const sensor, int32_t raw_H);
 
+/**
+ * @brief Decode the data registers 0xF7..0xFE, as read in one burst.
+ * @param buffer The `BME280_DATA_LEN` register values, from press_msb to
+ * hum_lsb.
+ * @param raw The raw reading to write the 20-bit pressure and temperature and
+ * 16-bit humidity values to.
+ *
+ * The 4 low bits of pressure and temperature are in the upper nibble of their
+ * xlsb registers; the lower nibble is ignored. A skipped measurement decodes
+ * as 0x80000 (0x8000 for humidity).
+ */
+void bme280_decode_raw(const uint8_t *const buffer, bme280_raw_t *const raw);
+
+/**
+ * @brief Compensate n raw readings of a sensor at once.
+ * @param sensor Sensor instance the readings were taken from.
+ * @param raw Array of n raw readings.
+ * @param out Array of n readings to write the compensated values to.
+ * @param n Number of readings.
+ *
+ * Gives the same results as calling the compensation functions for each
+ * reading in turn, including the fine temperature left in sensor, but loads
+ * the calibration data only once. The pressure formula is the one used by
+ * the read functions.
+ */
+void bme280_compensate_batch(bme280_t *const sensor,
+                             const bme280_raw_t *raw,
+                             bme280_reading_t *out,
+                             size_t n);
+
+/**
+ * @brief Compute the values derived from the calibration data held in sensor.
+ * @param sensor Sensor instance to update.
+ *
+ * Called by `bme280_init`. Only needs to be called otherwise if the
+ * calibration data is set by hand.
+ */
+void bme280_calib_derive(bme280_t *const sensor);
+
 /**
  * @brief Perform a forced-mode sensor read using settings contained in sensor
  * instance struct (The sensor must be in forced mode!).
@@ -202,6 +296,43 @@ int8_t bme280_forced_read(bme280_t *const sensor);
  */
 int8_t bme280_normal_read(bme280_t *const sensor);
 
+/**
+ * @brief Maximum time a measurement takes with the oversampling settings held
+ * in sensor, from datasheet section 9.1.
+ * @return The measurement time in microseconds, e.g. 9300 with 1x
+ * oversampling of all three values.
+ * @param sensor The sensor instance to get the settings from.
+ *
+ * In forced mode, the data registers hold the new values this long after
+ * `bme280_trigger`. In normal mode, a measurement is taken every measurement
+ * time plus standby time.
+ */
+uint32_t bme280_meas_time_us(const bme280_t *const sensor);
+
+/**
+ * @brief Start a forced-mode measurement with the settings held in sensor,
+ * without waiting for it to complete.
+ * @return Returns BME280_OK on success or BME280_WRITE_ERR on error.
+ * @param sensor BME280 sensor instance, which must be in forced mode.
+ *
+ * This is a single register write. Read the result with `bme280_burst_read`
+ * after `bme280_meas_time_us`.
+ */
+int8_t bme280_trigger(bme280_t *const sensor);
+
+/**
+ * @brief Read the data registers in a single 8-byte burst, without polling
+ * the status register.
+ * @return Returns BME280_OK on success or BME280_READ_ERR on error.
+ * @param sensor BME280 sensor instance to read from.
+ *
+ * The sensor values are read, then compensated, then stored in the sensor
+ * instance struct. The caller must schedule the read after a measurement has
+ * completed (see `bme280_meas_time_us`); in normal mode, the registers always
+ * hold the latest complete measurement.
+ */
+int8_t bme280_burst_read(bme280_t *const sensor);
+
 /**
  * @brief Writes a formatted output of the temperature value currently held in
  * sensor to dest. dest MUST be of at least `BME280_T_STRLEN`.
@@ -12,6 +12,8 @@
 #define BME280_REG_CTRL_MEAS 0xF4
 #define BME280_REG_CONFIG 0xF5
 #define BME280_READ_ALL_START_REG 0xF7
+/** @brief Length of the data registers 0xF7..0xFE, read in one burst */
+#define BME280_DATA_LEN 8
 
 #define BME280_CALIB_0_25 0x88
 #define BME280_CALIB_26_41 0xE1
@@ -1,5 +1,6 @@
 #include <pico/stdlib.h>
 #include <hardware/i2c.h>
+#include <hardware/dma.h>
 #include <pico/binary_info.h>
 #include <stdlib.h>
 #include <string.h>
@@ -15,23 +16,89 @@ inline static void swap(int32_t *a, int32_t *b)
     *b = t;
 }
 
-inline static void fancy_write(i2c_inst_t *i2c, uint8_t addr, const uint8_t *src, size_t len, char *name)
+inline static bool fancy_write(i2c_inst_t *i2c, uint8_t addr, const uint8_t *src, size_t len, char *name)
 {
     switch (i2c_write_blocking(i2c, addr, src, len, false))
     {
     case PICO_ERROR_GENERIC:
         printf("[%s] addr not acknowledged!\n", name);
-        break;
+        return false;
     case PICO_ERROR_TIMEOUT:
         printf("[%s] timeout!\n", name);
-        break;
+        return false;
     default:
-        break;
+        return true;
+    }
+}
+
+inline static void ssd1306_mark_dirty(ssd1306_t *const p, uint32_t x, uint32_t page)
+{
+    if (x < p->dirty_lo[page])
+    {
+        p->dirty_lo[page] = x;
+    }
+    if (x > p->dirty_hi[page])
+    {
+        p->dirty_hi[page] = x;
     }
 }
 
+inline static void ssd1306_mark_all(ssd1306_t *const p)
+{
+    for (uint8_t pg = 0; pg < p->pages; ++pg)
+    {
+        p->dirty_lo[pg] = 0;
+        p->dirty_hi[pg] = p->width - 1;
+    }
+}
+
+inline static void ssd1306_mark_clean(ssd1306_t *const p)
+{
+    memset(p->dirty_lo, 0xFF, sizeof(p->dirty_lo));
+    memset(p->dirty_hi, 0, sizeof(p->dirty_hi));
+}
+
+/*
+ * Find the columns of a page that have to be sent: the drawn columns,
+ * trimmed at both ends to the ones that differ from the display ram. If the
+ * display ram contents are unknown, the whole page is sent.
+ */
+static bool ssd1306_page_window(ssd1306_t *const p, uint8_t pg, uint8_t *lo, uint8_t *hi)
+{
+    if (!p->shadow_valid)
+    {
+        *lo = 0;
+        *hi = p->width - 1;
+        return true;
+    }
+
+    const uint8_t *row = p->buffer + pg * p->width;
+    const uint8_t *old = p->shadow + pg * p->width;
+    int32_t l = p->dirty_lo[pg];
+    int32_t h = p->dirty_hi[pg];
+
+    while (l <= h && row[l] == old[l])
+    {
+        ++l;
+    }
+    if (l > h)
+    {
+        return false;
+    }
+    while (row[h] == old[h])
+    {
+        --h;
+    }
+
+    *lo = l;
+    *hi = h;
+    return true;
+}
+
 inline static void ssd1306_write(ssd1306_t *const p, uint8_t val)
 {
+    ssd1306_show_wait(p);
+
     uint8_t d[2] = {0x00, val};
     fancy_write(p->i2c_i, p->address, d, 2, "ssd1306_write");
 }
@@ -45,14 +112,36 @@ bool ssd1306_init(ssd1306_t *const p, uint16_t width, uint16_t height, uint8_t a
 
     p->i2c_i = i2c_instance;
 
+    if (p->pages > SSD1306_MAX_PAGES)
+    {
+        return false;
+    }
+
+    // One byte in front of the buffer for the control byte, then the buffer
+    // and its shadow copy of the display ram
     p->bufsize = (p->pages) * (p->width);
-    if ((p->buffer = malloc(p->bufsize + 1)) == NULL)
+    if ((p->buffer = malloc(2 * p->bufsize + 1)) == NULL)
     {
         p->bufsize = 0;
         return false;
     }
 
     ++(p->buffer);
+    p->shadow = p->buffer + p->bufsize;
+    p->shadow_valid = false;
+    ssd1306_mark_all(p);
+
+    // The async show needs a dma channel and a staging buffer with one
+    // data_cmd word per byte: control byte and 2 no-ops, then for each page
+    // control byte and 6 command bytes, control byte and page contents.
+    // Without them, show is always blocking.
+    p->dma_buf = NULL;
+    if ((p->dma_chan = dma_claim_unused_channel(false)) >= 0 &&
+        (p->dma_buf = malloc((3 + p->pages * (8 + p->width)) * sizeof(uint16_t))) == NULL)
+    {
+        dma_channel_unclaim(p->dma_chan);
+        p->dma_chan = -1;
+    }
 
     // See datasheet
     uint8_t cmds[] = {
@@ -98,6 +187,12 @@ bool ssd1306_init(ssd1306_t *const p, uint16_t width, uint16_t height, uint8_t a
 
 inline void ssd1306_deinit(ssd1306_t *const p)
 {
+    if (p->dma_chan >= 0)
+    {
+        ssd1306_show_wait(p);
+        dma_channel_unclaim(p->dma_chan);
+        free(p->dma_buf);
+    }
     free(p->buffer - 1);
 }
 
@@ -125,6 +220,7 @@ inline void ssd1306_invert(ssd1306_t *const p, uint8_t inv)
 inline void ssd1306_clear(ssd1306_t *const p)
 {
     memset(p->buffer, 0, p->bufsize);
+    ssd1306_mark_all(p);
 }
 
 inline void ssd1306_clear_pixel(ssd1306_t *const p, uint32_t x, uint32_t y)
@@ -136,6 +232,7 @@ inline void ssd1306_clear_pixel(ssd1306_t *const p, uint32_t x, uint32_t y)
     }
 
     p->buffer[x + p->width * (y >> 3)] &= ~(0x1 << (y & 0x07));
+    ssd1306_mark_dirty(p, x, y >> 3);
 }
 
 inline void ssd1306_draw_pixel(ssd1306_t *const p, uint32_t x, uint32_t y)
@@ -146,6 +243,7 @@ inline void ssd1306_draw_pixel(ssd1306_t *const p, uint32_t x, uint32_t y)
     }
 
     p->buffer[x + p->width * (y >> 3)] |= 0x1 << (y & 0x07);
+    ssd1306_mark_dirty(p, x, y >> 3);
 }
 
 void ssd1306_draw_line(ssd1306_t *const p, int32_t x1, int32_t y1, int32_t x2, int32_t y2)
@@ -210,6 +308,71 @@ void ssd1306_draw_empty_square(ssd1306_t *const p, uint32_t x, uint32_t y, uint3
     ssd1306_draw_line(p, x + width, y, x + width, y + height);
 }
 
+/*
+ * Draw a glyph of a font at most 8 pixels high directly into the buffer.
+ *
+ * Each font column byte is scaled once into a mask of 8 * scale bits, shifted
+ * to the bit offset of y within its page and ORed into the pages it spans,
+ * for each of the scale buffer columns it covers. The result is the same as
+ * drawing a scale x scale square per set bit. The mask holds 64 bits, so
+ * scale must not exceed SSD1306_BLIT_MAX_SCALE.
+ */
+#define SSD1306_BLIT_MAX_SCALE 7
+
+static void ssd1306_blit_glyph8(ssd1306_t *const p, uint32_t x, uint32_t y, uint32_t scale, const uint8_t *glyph, uint8_t width)
+{
+    uint32_t page = y >> 3;
+    uint32_t shift = y & 7;
+    uint64_t unit = (1u << scale) - 1;
+
+    if (page >= p->pages)
+    {
+        return;
+    }
+
+    for (uint8_t w = 0; w < width; ++w)
+    {
+        uint8_t line = glyph[w];
+        if (line == 0)
+        {
+            continue;
+        }
+
+        uint64_t mask = line;
+        if (scale > 1)
+        {
+            mask = 0;
+            for (uint32_t j = 0; j < 8; ++j, line >>= 1)
+            {
+                if (line & 1)
+                {
+                    mask |= unit << (j * scale);
+                }
+            }
+        }
+        mask <<= shift;
+
+        for (uint32_t sx = 0; sx < scale; ++sx)
+        {
+            uint32_t cx = x + w * scale + sx;
+            if (cx >= p->width)
+            {
+                return;
+            }
+
+            uint64_t m = mask;
+            for (uint32_t pg = page; m != 0 && pg < p->pages; ++pg, m >>= 8)
+            {
+                if (m & 0xFF)
+                {
+                    p->buffer[cx + p->width * pg] |= m & 0xFF;
+                    ssd1306_mark_dirty(p, cx, pg);
+                }
+            }
+        }
+    }
+}
+
 inline void ssd1306_draw_char_with_font(ssd1306_t *const p, uint32_t x, uint32_t y, uint32_t scale, const uint8_t *font, char c)
 {
     if (c < font[3] || c > font[4])
@@ -218,6 +381,12 @@ inline void ssd1306_draw_char_with_font(ssd1306_t *const p, uint32_t x, uint32_t
     }
 
     uint32_t parts_per_line = (font[0] >> 3) + ((font[0] & 7) > 0);
+    if (parts_per_line == 1 && scale <= SSD1306_BLIT_MAX_SCALE)
+    {
+        ssd1306_blit_glyph8(p, x, y, scale, &font[(c - font[3]) * font[1] + 5], font[1]);
+        return;
+    }
+
     for (uint8_t w = 0; w < font[1]; ++w)
     { // width
         uint32_t pp = (c - font[3]) * font[1] * parts_per_line + w * parts_per_line + 5;
@@ -334,19 +503,174 @@ inline void ssd1306_bmp_show_image(ssd1306_t *const p, const uint8_t *data, cons
 
 inline void ssd1306_show(ssd1306_t *const p)
 {
-    uint8_t payload[] = {SET_COL_ADDR, 0, p->width - 1, SET_PAGE_ADDR, 0, p->pages - 1};
-    if (p->width == 64)
+    uint8_t col_offset = p->width == 64 ? 32 : 0;
+    bool ok = true;
+
+    ssd1306_show_wait(p);
+
+    // A show cut short may have left the display waiting for the arguments
+    // of an address command. Two no-ops complete it, or are no-ops.
+    if (!p->shadow_valid)
     {
-        payload[1] += 32;
-        payload[2] += 32;
+        uint8_t nops[] = {0x00, NOP, NOP};
+        ok &= fancy_write(p->i2c_i, p->address, nops, sizeof(nops), "ssd1306_show");
     }
 
-    for (size_t i = 0; i < sizeof(payload); ++i)
+    for (uint8_t pg = 0; pg < p->pages; ++pg)
     {
-        ssd1306_write(p, payload[i]);
+        uint8_t lo, hi;
+        if (!ssd1306_page_window(p, pg, &lo, &hi))
+        {
+            continue;
+        }
+
+        uint8_t cmds[] = {0x00, SET_COL_ADDR, col_offset + lo, col_offset + hi, SET_PAGE_ADDR, pg, pg};
+        ok &= fancy_write(p->i2c_i, p->address, cmds, sizeof(cmds), "ssd1306_show");
+
+        // The byte in front of the window temporarily holds the control byte
+        uint8_t *row = p->buffer + pg * p->width + lo;
+        size_t len = hi - lo + 1;
+        uint8_t saved = *(row - 1);
+        *(row - 1) = 0x40;
+        ok &= fancy_write(p->i2c_i, p->address, row - 1, len + 1, "ssd1306_show");
+        *(row - 1) = saved;
+
+        memcpy(p->shadow + (row - p->buffer), row, len);
     }
 
-    *(p->buffer - 1) = 0x40;
+    ssd1306_mark_clean(p);
+    p->shadow_valid = ok;
+}
+
+bool ssd1306_show_async(ssd1306_t *const p)
+{
+    if (p->dma_chan < 0)
+    {
+        ssd1306_show(p);
+        return true;
+    }
+
+    if (ssd1306_show_busy(p))
+    {
+        return false;
+    }
+
+    uint8_t col_offset = p->width == 64 ? 32 : 0;
+    uint16_t *w = p->dma_buf;
+
+    // See ssd1306_show()
+    if (!p->shadow_valid)
+    {
+        *w++ = 0x00;
+        *w++ = NOP;
+        *w++ = NOP | I2C_IC_DATA_CMD_STOP_BITS;
+    }
+
+    // Each transaction ends with STOP, the controller issues a new START
+    // for the next one by itself.
+    for (uint8_t pg = 0; pg < p->pages; ++pg)
+    {
+        uint8_t lo, hi;
+        if (!ssd1306_page_window(p, pg, &lo, &hi))
+        {
+            continue;
+        }
+
+        *w++ = 0x00; // commands follow
+        *w++ = SET_COL_ADDR;
+        *w++ = col_offset + lo;
+        *w++ = col_offset + hi;
+        *w++ = SET_PAGE_ADDR;
+        *w++ = pg;
+        *w++ = pg | I2C_IC_DATA_CMD_STOP_BITS;
+
+        uint8_t *row = p->buffer + pg * p->width;
+        *w++ = 0x40; // display data follows
+        for (uint32_t i = lo; i <= hi; ++i)
+        {
+            *w++ = row[i];
+        }
+        w[-1] |= I2C_IC_DATA_CMD_STOP_BITS;
+
+        memcpy(p->shadow + pg * p->width + lo, row + lo, hi - lo + 1);
+    }
 
-    fancy_write(p->i2c_i, p->address, p->buffer - 1, p->bufsize + 1, "ssd1306_show");
+    ssd1306_mark_clean(p);
+    p->shadow_valid = true;
+
+    // Nothing has changed
+    if (w == p->dma_buf)
+    {
+        return true;
+    }
+
+    // The target address can only be changed while the controller is disabled
+    i2c_hw_t *hw = i2c_get_hw(p->i2c_i);
+    hw->enable = 0;
+    hw->tar = p->address;
+    hw->enable = 1;
+
+    dma_channel_config c = dma_channel_get_default_config(p->dma_chan);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_16);
+    channel_config_set_read_increment(&c, true);
+    channel_config_set_write_increment(&c, false);
+    channel_config_set_dreq(&c, i2c_get_dreq(p->i2c_i, true));
+    dma_channel_configure(p->dma_chan, &c, &hw->data_cmd, p->dma_buf,
+                          w - p->dma_buf, true);
+
+    return true;
+}
+
+bool ssd1306_show_busy(ssd1306_t *const p)
+{
+    if (p->dma_chan < 0)
+    {
+        return false;
+    }
+
+    i2c_hw_t *hw = i2c_get_hw(p->i2c_i);
+
+    // On a NACK the controller flushes and holds the tx fifo until the abort
+    // is cleared. Stop the dma first, so that no stale words are sent.
+    if (hw->raw_intr_stat & I2C_IC_RAW_INTR_STAT_TX_ABRT_BITS)
+    {
+        dma_channel_abort(p->dma_chan);
+        (void)hw->clr_tx_abrt;
+        // The display ram contents are unknown now
+        p->shadow_valid = false;
+        printf("[ssd1306_show_async] addr not acknowledged!\n");
+        return false;
+    }
+
+    return dma_channel_is_busy(p->dma_chan) ||
+           !(hw->status & I2C_IC_STATUS_TFE_BITS) ||
+           (hw->status & I2C_IC_STATUS_ACTIVITY_BITS);
+}
+
+void ssd1306_show_abort(ssd1306_t *const p)
+{
+    if (!ssd1306_show_busy(p))
+    {
+        return;
+    }
+
+    i2c_hw_t *hw = i2c_get_hw(p->i2c_i);
+
+    dma_channel_abort(p->dma_chan);
+    // The controller flushes the tx fifo, issues STOP and clears the bit
+    hw->enable |= I2C_IC_ENABLE_ABORT_BITS;
+    while (hw->enable & I2C_IC_ENABLE_ABORT_BITS)
+    {
+        tight_loop_contents();
+    }
+    (void)hw->clr_tx_abrt;
+    p->shadow_valid = false;
+}
+
+void ssd1306_show_wait(ssd1306_t *const p)
+{
+    while (ssd1306_show_busy(p))
+    {
+        tight_loop_contents();
+    }
 }
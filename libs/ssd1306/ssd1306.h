@@ -25,9 +25,15 @@ typedef enum
     SET_DISP_CLK_DIV = 0xD5,
     SET_PRECHARGE = 0xD9,
     SET_VCOM_DESEL = 0xDB,
-    SET_CHARGE_PUMP = 0x8D
+    SET_CHARGE_PUMP = 0x8D,
+    NOP = 0xE3
 } ssd1306_command_t;
 
+/**
+ *	@brief maximum number of pages (height / 8) of a display
+ */
+#define SSD1306_MAX_PAGES 8
+
 /**
  *	@brief holds the configuration
  */
@@ -41,6 +47,12 @@ typedef struct
     bool external_vcc; // whether display uses external vcc */
     uint8_t *buffer;   // display buffer
     size_t bufsize;    // buffer size
+    int dma_chan;      // dma channel for ssd1306_show_async, -1 if none
+    uint16_t *dma_buf; // i2c data_cmd words queued by ssd1306_show_async
+    uint8_t *shadow;   // display ram contents as last sent
+    bool shadow_valid; // false if display ram contents are unknown
+    uint8_t dirty_lo[SSD1306_MAX_PAGES]; // first column drawn per page since show
+    uint8_t dirty_hi[SSD1306_MAX_PAGES]; // last column drawn per page since show
 } ssd1306_t;
 
 /**
@@ -109,11 +121,60 @@ void ssd1306_invert(ssd1306_t *const p,
 /**
     @brief display buffer, should be called on change
 
+    Only the columns of each page that were drawn since the last show and
+    differ from the display ram contents are sent.
+
     @param[in] p : instance of display
 
 */
 void ssd1306_show(ssd1306_t *const p);
 
+/**
+    @brief start sending the display buffer without blocking
+
+    Commands and buffer contents are copied to a staging buffer and fed to
+    the i2c peripheral by dma, so the display buffer may be redrawn as soon
+    as this returns. No other transfer may be started on the i2c bus until
+    ssd1306_show_busy() returns false. If no dma channel is available, the
+    buffer is sent with ssd1306_show().
+
+    @param[in] p : instance of display
+
+    @return bool.
+    @retval true if the transfer was started
+    @retval false if the previous transfer is still in progress
+*/
+bool ssd1306_show_async(ssd1306_t *const p);
+
+/**
+    @brief poll for completion of ssd1306_show_async
+
+    @param[in] p : instance of display
+
+    @return bool.
+    @retval true while the transfer is in progress
+    @retval false if the transfer has completed or was aborted
+*/
+bool ssd1306_show_busy(ssd1306_t *const p);
+
+/**
+    @brief abort a transfer started by ssd1306_show_async
+
+    The i2c controller sends STOP after the byte in progress, so that the bus
+    is free for the next transfer. The display ram contents are unknown
+    afterwards, so the next show sends the whole buffer.
+
+    @param[in] p : instance of display
+*/
+void ssd1306_show_abort(ssd1306_t *const p);
+
+/**
+    @brief wait for completion of ssd1306_show_async
+
+    @param[in] p : instance of display
+*/
+void ssd1306_show_wait(ssd1306_t *const p);
+
 /**
     @brief clear display buffer
 
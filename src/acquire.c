@@ -0,0 +1,115 @@
+#include <stdio.h>
+
+#include "pico/stdlib.h"
+#include "pico/sync.h"
+
+#include "acquire.h"
+#include "display.h"
+#include "i2c_arbiter.h"
+#include "profiles.h"
+#include "sampler.h"
+#include "sensors.h"
+
+// Past samples, appended by core1 and read by the /history handler
+static history_t history;
+static critical_section_t history_lock;
+
+// Number of sensors, and the one read next
+static unsigned nsensors;
+static unsigned next_id;
+
+static inline void stage_end(const acquire_hooks_t *hooks,
+                             acquire_stage_t stage)
+{
+    if (hooks->stage_end != NULL)
+    {
+        hooks->stage_end(stage);
+    }
+}
+
+void acquire_init(void)
+{
+    critical_section_init(&history_lock);
+    history_init(&history);
+}
+
+void acquire_start(void)
+{
+    nsensors = sensors_count();
+    next_id = 0;
+
+    // The reads are spread evenly over the profile's interval, so that a
+    // slow or failing sensor only delays its own slot.
+    sampler_start(profiles_active()->interval_ms * 1000 / nsensors);
+}
+
+void acquire_step(const acquire_hooks_t *hooks)
+{
+    const profile_t *requested;
+    absolute_time_t due;
+    unsigned id;
+
+    // A new profile ends the wait early, profile_handler() sends an event
+    // after the request. The schedule restarts with its interval.
+    while (!sampler_wait(&due, profiles_pending))
+    {
+        if ((requested = profiles_take()) != NULL)
+        {
+            printf("Core1: profile %s\n", requested->name);
+            sensors_apply(requested);
+            acquire_start();
+        }
+    }
+    id = next_id;
+    next_id = (next_id + 1) % nsensors;
+    stage_end(hooks, ACQUIRE_WAIT);
+
+    // A display frame still in progress on the bus is cut short
+    i2c_arbiter_acquire(sensors_bus(id));
+
+    // Samples are stamped with their due time, which is evenly spaced
+    sample_t sample;
+    bool ok = sensors_read(id, to_ms_since_boot(due), &sample);
+    stage_end(hooks, ACQUIRE_READ);
+
+    if (ok && id == 0)
+    {
+        // Only the primary sensor is recorded and shown
+        critical_section_enter_blocking(&history_lock);
+        history_append(&history, &sample);
+        critical_section_exit(&history_lock);
+
+        if (hooks->published != NULL)
+        {
+            hooks->published(&sample);
+        }
+    }
+    stage_end(hooks, ACQUIRE_RECORD);
+
+    // The display renders from the published sample in the time left
+    // before the next one is due, or skips it
+    display_task(sampler_next_due());
+    stage_end(hooks, ACQUIRE_DISPLAY);
+}
+
+bool get_history_span(uint32_t *first, uint32_t *last)
+{
+    bool ret;
+
+    critical_section_enter_blocking(&history_lock);
+    ret = history_span(&history, first, last);
+    critical_section_exit(&history_lock);
+
+    return ret;
+}
+
+bool get_history_block(uint32_t seq, history_block_t *blk)
+{
+    bool ret;
+
+    critical_section_enter_blocking(&history_lock);
+    ret = history_copy_block(&history, seq, blk);
+    critical_section_exit(&history_lock);
+
+    return ret;
+}
@@ -0,0 +1,77 @@
+#ifndef _ACQUIRE_H
+#define _ACQUIRE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "history.h"
+#include "sample.h"
+
+/*
+ * core1's acquisition loop: the sensors are read in turn on the sampler's
+ * schedule (see sampler.h), samples of the primary sensor are recorded in
+ * the history and published, and the display renders in the time left
+ * before the next read.
+ *
+ * The firmware runs acquire_step() forever on core1. The host build
+ * (host/main.c) runs the same steps against simulated devices, with hooks
+ * to profile each stage.
+ *
+ * acquire_step() is only called on core1; get_history_span() and
+ * get_history_block() may be called on either core.
+ */
+
+/* Stages of a step, in the order in which they end. */
+typedef enum
+{
+    /* Waiting for the read to be due, and applying a new profile */
+    ACQUIRE_WAIT,
+    /* The sensor read, including the wait for its measurement */
+    ACQUIRE_READ,
+    /* Recording and publishing the sample */
+    ACQUIRE_RECORD,
+    /* The display task */
+    ACQUIRE_DISPLAY,
+    ACQUIRE_STAGES,
+} acquire_stage_t;
+
+typedef struct acquire_hooks
+{
+    /* Called with each sample of the primary sensor after it has been
+     * recorded, or NULL */
+    void (*published)(const sample_t *s);
+    /* Called at the end of each stage, or NULL */
+    void (*stage_end)(acquire_stage_t stage);
+} acquire_hooks_t;
+
+/*
+ * Reset the history. Called once, before core1 is started.
+ */
+void acquire_init(void);
+
+/*
+ * Start the schedule with the interval of the active profile, spread evenly
+ * over the sensors found by sensors_init(), beginning with sensor 0.
+ */
+void acquire_start(void);
+
+/*
+ * Wait until the next read is due, read the sensor and run the display
+ * task. If a profile is requested in the meantime, it is applied and the
+ * schedule restarts with its interval.
+ */
+void acquire_step(const acquire_hooks_t *hooks);
+
+/*
+ * Get the range of sequence numbers of the blocks currently held in the
+ * sample history. Returns false if no samples have been recorded yet.
+ */
+bool get_history_span(uint32_t *first, uint32_t *last);
+
+/*
+ * Copy the history block with sequence number seq into blk. Returns false
+ * if the block has already been overwritten.
+ */
+bool get_history_block(uint32_t seq, history_block_t *blk);
+
+#endif
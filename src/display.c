@@ -0,0 +1,133 @@
+#include <string.h>
+
+#include "display.h"
+#include "i2c_arbiter.h"
+#include "seqlock.h"
+#include "sensors.h"
+#include "utils.h"
+
+static ssd1306_t *dev;
+static uint32_t intvl_us;
+
+/* Earliest time for the next frame */
+static absolute_time_t next_frame;
+/* Reads of the primary sensor when the last frame was rendered */
+static uint32_t rendered;
+/* A frame was started, and its outcome has not been checked yet */
+static bool sending;
+/* The frame in progress was aborted by the arbiter */
+static bool aborted;
+
+static display_stats_t stats;
+static seqlock_t stats_lock;
+
+static bool show_busy(void *priv)
+{
+    return ssd1306_show_busy(priv);
+}
+
+static void show_abort(void *priv)
+{
+    ssd1306_show_abort(priv);
+    aborted = true;
+}
+
+static i2c_holder_t holder = {
+    .busy = show_busy,
+    .abort = show_abort,
+};
+
+static void draw_line(uint32_t y, int32_t centi, const char *unit)
+{
+    char line[FMT_CENTI_MAX + 5];
+    char *p = fmt_centi(line, centi);
+
+    *p++ = ' ';
+    strcpy(p, unit);
+    ssd1306_draw_string(dev, 4, y, 1, line);
+}
+
+static void render(const sample_t *s)
+{
+    ssd1306_clear(dev);
+    draw_line(0, s->temperature, "C");
+    draw_line(8, sample_humidity_centi(s), "%RH");
+    draw_line(16, sample_pressure_pa(s), "hPa");
+}
+
+void display_init(ssd1306_t *d, uint32_t intvl_ms)
+{
+    dev = d;
+    holder.priv = d;
+    intvl_us = intvl_ms * 1000;
+    next_frame = get_absolute_time();
+}
+
+bool display_task(absolute_time_t deadline)
+{
+    absolute_time_t now = get_absolute_time();
+    sensor_stats_t st;
+    sample_t s;
+
+    // The display ram is only unknown after a completed transfer if the
+    // display did not acknowledge
+    if (sending && !ssd1306_show_busy(dev))
+    {
+        sending = false;
+        if (!dev->shadow_valid)
+        {
+            seqlock_write_begin(&stats_lock);
+            if (aborted)
+            {
+                stats.aborted++;
+            }
+            else
+            {
+                stats.errors++;
+                next_frame = delayed_by_us(now, DISPLAY_RETRY_MS * 1000);
+            }
+            seqlock_write_end(&stats_lock);
+        }
+        aborted = false;
+    }
+
+    if (!sensors_stats(0, &st) || st.reads == rendered ||
+        absolute_time_diff_us(next_frame, now) < 0 ||
+        absolute_time_diff_us(now, deadline) < DISPLAY_SLACK_US ||
+        !sensors_get(0, &s))
+    {
+        return false;
+    }
+    if (!i2c_arbiter_try(dev->i2c_i, &holder))
+    {
+        return false;
+    }
+
+    render(&s);
+    ssd1306_show_async(dev);
+    sending = true;
+
+    seqlock_write_begin(&stats_lock);
+    stats.frames++;
+    if (rendered != 0)
+    {
+        stats.skipped += st.reads - rendered - 1;
+    }
+    seqlock_write_end(&stats_lock);
+
+    rendered = st.reads;
+    next_frame = delayed_by_us(now, intvl_us);
+
+    return true;
+}
+
+void display_stats(display_stats_t *s)
+{
+    uint32_t seq;
+
+    do
+    {
+        seq = seqlock_read_begin(&stats_lock);
+        *s = stats;
+    } while (seqlock_read_retry(&stats_lock, seq));
+}
@@ -0,0 +1,63 @@
+#ifndef _DISPLAY_H
+#define _DISPLAY_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "pico/stdlib.h"
+
+#include <ssd1306.h>
+
+/*
+ * Display of the latest sample of the primary sensor, as a task that runs
+ * on core1 in the time between samples.
+ *
+ * The sampler publishes each sample (see sensors_get()), and the display
+ * renders from that snapshot at its own rate, at most one frame per
+ * interval. Each frame is sent by dma, and the display holds the bus
+ * through the i2c arbiter (see i2c_arbiter.h) until the transfer has
+ * completed. A frame is only started if there is time for it before the
+ * next sample is due and the previous frame has been sent; otherwise the
+ * display falls behind, and samples that are superseded before they are
+ * shown are skipped. If the display does not acknowledge, as when it is
+ * unplugged, it is retried after DISPLAY_RETRY_MS.
+ *
+ * All functions except display_stats() are only called on core1.
+ */
+
+/* Least time in us before the next sample for a frame to be started. A
+ * full 128x32 frame takes about 5 ms at 1 MHz. */
+#define DISPLAY_SLACK_US (8 * 1000)
+
+/* Time in ms after which a display that did not acknowledge is retried. */
+#define DISPLAY_RETRY_MS (5 * 1000)
+
+typedef struct display_stats
+{
+    /* Frames started */
+    uint32_t frames;
+    /* Samples that were superseded before they were shown */
+    uint32_t skipped;
+    /* Frames aborted by the arbiter for a sensor read */
+    uint32_t aborted;
+    /* Frames that the display did not acknowledge */
+    uint32_t errors;
+} display_stats_t;
+
+/*
+ * Show samples on dev, which must have been initialized, with at least
+ * intvl_ms between frames.
+ */
+void display_init(ssd1306_t *dev, uint32_t intvl_ms);
+
+/*
+ * Render and start sending a frame if a new sample has been published, a
+ * frame is due and it can be sent before deadline. Returns true if a frame
+ * was started.
+ */
+bool display_task(absolute_time_t deadline);
+
+/* Copy the statistics. */
+void display_stats(display_stats_t *stats);
+
+#endif
@@ -0,0 +1,393 @@
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "lwip/pbuf.h"
+#include "lwip/tcp.h"
+#include "picow_http/http.h"
+
+#include "events.h"
+#include "json.h"
+
+/* Longest event, see events.h */
+#define EVENT_MAX (STRLEN_LTRL("id: 4294967295\ndata: \n\n") + JSON_SENSOR_MAX)
+
+/* tcp_poll() interval, in units of the TCP coarse timer (500 ms). */
+#define POLL_INTVL (4)
+#define POLL_S (POLL_INTVL / 2)
+
+/* Seconds without data after which a comment is sent to keep the stream up. */
+#define KEEPALIVE_S (14)
+
+/* Longest request header that is accepted. */
+#define REQ_MAX (1024)
+
+#define REQ_PREFIX ("GET /events")
+
+typedef enum
+{
+    SUB_FREE,
+    SUB_REQUEST,
+    SUB_STREAMING,
+} sub_state_t;
+
+typedef struct subscriber
+{
+    struct tcp_pcb *pcb;
+    sub_state_t state;
+    /* Request bytes received so far. */
+    uint16_t req_len;
+    /* Number of characters matched of "\r\n\r\n", the end of the header. */
+    uint8_t eoh;
+    /* false if the request is not GET /events */
+    bool found;
+    /* An event was skipped because the send buffer was full. */
+    bool pending;
+    /* Seconds since the peer last acknowledged data. */
+    uint16_t stalled_s;
+    /* Seconds since data was last written. */
+    uint16_t quiet_s;
+} subscriber_t;
+
+static subscriber_t subs[EVENTS_MAX_SUBSCRIBERS];
+
+/* The most recent event, sent to all subscribers. */
+static char event[EVENT_MAX];
+static size_t event_len = 0;
+
+static const char hdr_ok[] =
+    "HTTP/1.1 200 OK\r\n"
+    "Content-Type: text/event-stream\r\n"
+    "Cache-Control: no-store\r\n"
+    "Access-Control-Allow-Origin: *\r\n"
+    "\r\n"
+    "retry: 5000\n\n";
+static const char hdr_not_found[] =
+    "HTTP/1.1 404 Not Found\r\n"
+    "Content-Length: 0\r\n"
+    "Connection: close\r\n"
+    "\r\n";
+static const char hdr_busy[] =
+    "HTTP/1.1 503 Service Unavailable\r\n"
+    "Content-Length: 0\r\n"
+    "Retry-After: 10\r\n"
+    "Connection: close\r\n"
+    "\r\n";
+static const char keepalive[] = ":\n\n";
+
+/*
+ * Close the connection. Returns ERR_ABRT if the pcb had to be aborted,
+ * which must then be returned from the lwIP callback.
+ */
+static err_t close_pcb(struct tcp_pcb *pcb)
+{
+    tcp_arg(pcb, NULL);
+    tcp_recv(pcb, NULL);
+    tcp_sent(pcb, NULL);
+    tcp_err(pcb, NULL);
+    tcp_poll(pcb, NULL, 0);
+
+    if (tcp_close(pcb) != ERR_OK)
+    {
+        tcp_abort(pcb);
+        return ERR_ABRT;
+    }
+
+    return ERR_OK;
+}
+
+static err_t sub_close(subscriber_t *sub)
+{
+    struct tcp_pcb *pcb = sub->pcb;
+
+    sub->pcb = NULL;
+    sub->state = SUB_FREE;
+
+    return close_pcb(pcb);
+}
+
+/*
+ * Queue data for sending if the send buffer has room for all of it.
+ * Constant data is referenced, anything else must be copied.
+ */
+static bool sub_write(subscriber_t *sub, const void *data, size_t len,
+                      u8_t flags)
+{
+    if (tcp_sndbuf(sub->pcb) < len ||
+        tcp_sndqueuelen(sub->pcb) >= TCP_SND_QUEUELEN - 1)
+    {
+        return false;
+    }
+
+    if (tcp_write(sub->pcb, data, len, flags) != ERR_OK)
+    {
+        return false;
+    }
+    sub->quiet_s = 0;
+
+    return true;
+}
+
+/*
+ * Send the most recent event, or remember to do so when the send buffer
+ * has drained. Events that could not be sent in the meantime are dropped.
+ */
+static void sub_push(subscriber_t *sub)
+{
+    if (event_len == 0)
+    {
+        return;
+    }
+
+    if (sub_write(sub, event, event_len, TCP_WRITE_FLAG_COPY))
+    {
+        sub->pending = false;
+        tcp_output(sub->pcb);
+    }
+    else
+    {
+        sub->pending = true;
+    }
+}
+
+/*
+ * Check the request line and wait for the end of the request header.
+ * Returns true when the complete header has been received.
+ */
+static bool parse_req(subscriber_t *sub, const char *p, size_t len)
+{
+    for (size_t i = 0; i < len; i++, sub->req_len++)
+    {
+        char c = p[i];
+
+        if (sub->req_len < STRLEN_LTRL(REQ_PREFIX))
+        {
+            if (c != REQ_PREFIX[sub->req_len])
+            {
+                sub->found = false;
+            }
+        }
+        else if (sub->req_len == STRLEN_LTRL(REQ_PREFIX))
+        {
+            if (c != ' ' && c != '?')
+            {
+                sub->found = false;
+            }
+        }
+
+        if (c == "\r\n\r\n"[sub->eoh])
+        {
+            if (++sub->eoh == 4)
+            {
+                return true;
+            }
+        }
+        else
+        {
+            sub->eoh = (c == '\r');
+        }
+    }
+
+    return false;
+}
+
+static err_t events_recv(void *arg, struct tcp_pcb *pcb, struct pbuf *p,
+                         err_t err)
+{
+    subscriber_t *sub = arg;
+    bool complete = false;
+
+    // The peer closed the connection.
+    if (p == NULL)
+    {
+        return sub_close(sub);
+    }
+    if (err != ERR_OK)
+    {
+        pbuf_free(p);
+        return err;
+    }
+
+    tcp_recved(pcb, p->tot_len);
+    if (sub->state == SUB_REQUEST)
+    {
+        for (struct pbuf *q = p; q != NULL && !complete; q = q->next)
+        {
+            complete = parse_req(sub, q->payload, q->len);
+        }
+    }
+    pbuf_free(p);
+
+    if (!complete)
+    {
+        if (sub->state == SUB_REQUEST && sub->req_len > REQ_MAX)
+        {
+            return sub_close(sub);
+        }
+        return ERR_OK;
+    }
+
+    if (!sub->found)
+    {
+        sub_write(sub, hdr_not_found, STRLEN_LTRL(hdr_not_found), 0);
+        return sub_close(sub);
+    }
+
+    if (!sub_write(sub, hdr_ok, STRLEN_LTRL(hdr_ok), 0))
+    {
+        return sub_close(sub);
+    }
+    sub->state = SUB_STREAMING;
+    sub->stalled_s = 0;
+    sub_push(sub);
+    tcp_output(pcb);
+
+    return ERR_OK;
+}
+
+static err_t events_sent(void *arg, struct tcp_pcb *pcb, u16_t len)
+{
+    subscriber_t *sub = arg;
+    (void)pcb;
+    (void)len;
+
+    sub->stalled_s = 0;
+    if (sub->pending)
+    {
+        sub_push(sub);
+    }
+
+    return ERR_OK;
+}
+
+static err_t events_poll(void *arg, struct tcp_pcb *pcb)
+{
+    subscriber_t *sub = arg;
+
+    // Unacknowledged data, or a request that never completes.
+    if (sub->state == SUB_REQUEST || sub->pending || pcb->unacked != NULL)
+    {
+        sub->stalled_s += POLL_S;
+        if (sub->stalled_s >= EVENTS_STALL_S)
+        {
+            HTTP_LOG_DEBUG("events: dropping stalled subscriber");
+            return sub_close(sub);
+        }
+    }
+    else
+    {
+        sub->stalled_s = 0;
+    }
+
+    if (sub->state == SUB_STREAMING)
+    {
+        sub->quiet_s += POLL_S;
+        if (sub->quiet_s >= KEEPALIVE_S &&
+            sub_write(sub, keepalive, STRLEN_LTRL(keepalive), 0))
+        {
+            tcp_output(pcb);
+        }
+    }
+
+    return ERR_OK;
+}
+
+/* The pcb has already been freed when this is called. */
+static void events_err(void *arg, err_t err)
+{
+    subscriber_t *sub = arg;
+    (void)err;
+
+    if (sub != NULL)
+    {
+        sub->pcb = NULL;
+        sub->state = SUB_FREE;
+    }
+}
+
+static err_t events_accept(void *arg, struct tcp_pcb *pcb, err_t err)
+{
+    subscriber_t *sub = NULL;
+    (void)arg;
+
+    if (err != ERR_OK || pcb == NULL)
+    {
+        return ERR_VAL;
+    }
+
+    for (int i = 0; i < EVENTS_MAX_SUBSCRIBERS; i++)
+    {
+        if (subs[i].state == SUB_FREE)
+        {
+            sub = &subs[i];
+            break;
+        }
+    }
+
+    if (sub == NULL)
+    {
+        tcp_write(pcb, hdr_busy, STRLEN_LTRL(hdr_busy), 0);
+        return close_pcb(pcb);
+    }
+
+    memset(sub, 0, sizeof *sub);
+    sub->pcb = pcb;
+    sub->state = SUB_REQUEST;
+    sub->found = true;
+
+    tcp_arg(pcb, sub);
+    tcp_recv(pcb, events_recv);
+    tcp_sent(pcb, events_sent);
+    tcp_err(pcb, events_err);
+    tcp_poll(pcb, events_poll, POLL_INTVL);
+    // Events are small and should go out right away.
+    tcp_nagle_disable(pcb);
+
+    return ERR_OK;
+}
+
+err_t events_init(void)
+{
+    struct tcp_pcb *pcb, *lpcb;
+    err_t err;
+
+    if ((pcb = tcp_new_ip_type(IPADDR_TYPE_ANY)) == NULL)
+    {
+        return ERR_MEM;
+    }
+
+    if ((err = tcp_bind(pcb, IP_ANY_TYPE, EVENTS_PORT)) != ERR_OK)
+    {
+        tcp_close(pcb);
+        return err;
+    }
+
+    if ((lpcb = tcp_listen_with_backlog(pcb, EVENTS_MAX_SUBSCRIBERS)) == NULL)
+    {
+        tcp_close(pcb);
+        return ERR_MEM;
+    }
+    tcp_accept(lpcb, events_accept);
+
+    return ERR_OK;
+}
+
+void events_publish(const sample_t *s)
+{
+    size_t len;
+
+    len = snprintf(event, sizeof event, "id: %lu\ndata: ",
+                   (unsigned long)s->ts);
+    len += json_sensor(&event[len], s);
+    event[len++] = '\n';
+    event[len++] = '\n';
+    event_len = len;
+
+    for (int i = 0; i < EVENTS_MAX_SUBSCRIBERS; i++)
+    {
+        if (subs[i].state == SUB_STREAMING)
+        {
+            sub_push(&subs[i]);
+        }
+    }
+}
@@ -0,0 +1,49 @@
+#ifndef _EVENTS_H
+#define _EVENTS_H
+
+#include "lwip/err.h"
+
+#include "sample.h"
+
+/*
+ * Server-Sent Events stream of new samples.
+ *
+ * picow_http completes a response when its handler returns, so the stream
+ * is served by a minimal HTTP responder on its own port, directly on the
+ * lwIP raw TCP API. A GET request for /events is answered with a
+ * text/event-stream response that stays open; each published sample is
+ * pushed as one event:
+ *
+ *     id: <ts>
+ *     data: {"temperature":..,"humidity":..,"pressure":..}
+ *
+ * At most EVENTS_MAX_SUBSCRIBERS streams are served at a time, further
+ * connections get status 503. If a subscriber's send buffer is full, events
+ * are not queued: the subscriber is sent the most recent sample when the
+ * buffer has drained, and is disconnected if it stalls for EVENTS_STALL_S.
+ *
+ * All functions must be called in lwIP context (see cyw43_arch_lwip_begin()).
+ */
+
+/* TCP port of the event stream. */
+#ifndef EVENTS_PORT
+#define EVENTS_PORT (8092)
+#endif
+
+/* Maximum number of concurrent event streams. */
+#define EVENTS_MAX_SUBSCRIBERS (4)
+
+/* Seconds after which a subscriber that accepts no data is disconnected. */
+#define EVENTS_STALL_S (30)
+
+/*
+ * Start listening for subscribers on EVENTS_PORT.
+ */
+err_t events_init(void);
+
+/*
+ * Push a new sample to all subscribers.
+ */
+void events_publish(const sample_t *s);
+
+#endif
@@ -0,0 +1,147 @@
+#include <stdio.h>
+
+#include "gauges.h"
+
+#define PREFIX "pico_meteo_"
+
+/* Longest template, with room to spare */
+#define TEMPLATE_MAX (1536)
+
+typedef struct field
+{
+    const char *name;
+    const char *help;
+    bool counter;
+    /* The value may be negative */
+    bool sign;
+    /* Digits before and after the decimal point */
+    uint8_t digits;
+    uint8_t decimals;
+} field_t;
+
+static const field_t fields[GAUGE_FIELDS] = {
+    [GAUGE_TEMPERATURE] = {"temperature_celsius",
+                           "Temperature of the primary sensor.",
+                           false, true, 5, 2},
+    [GAUGE_HUMIDITY] = {"humidity_percent",
+                        "Relative humidity of the primary sensor.",
+                        false, false, 3, 2},
+    [GAUGE_PRESSURE] = {"pressure_pascals",
+                        "Air pressure of the primary sensor.",
+                        false, false, 7, 0},
+    [GAUGE_SENSOR_VALID] = {"sensor_valid",
+                            "1 if the primary sensor has been read.",
+                            false, false, 1, 0},
+    [GAUGE_RSSI] = {"wifi_rssi_dbm", "Signal strength of the access point.",
+                    false, true, 3, 0},
+    [GAUGE_RSSI_VALID] = {"wifi_rssi_valid", "1 if the rssi is known.",
+                          false, false, 1, 0},
+    [GAUGE_UPTIME] = {"uptime_seconds", "Time since boot.",
+                      false, false, 10, 0},
+    [GAUGE_SAMPLES] = {"samples", "Samples read from the primary sensor.",
+                       true, false, 10, 0},
+    [GAUGE_I2C_ERRORS] = {"i2c_errors", "Failed sensor reads on all buses.",
+                          true, false, 10, 0},
+    [GAUGE_HEAP_FREE] = {"heap_free_bytes", "Heap not allocated by malloc().",
+                         false, false, 10, 0},
+};
+
+typedef struct template
+{
+    char text[TEMPLATE_MAX];
+    size_t len;
+    /* Offset of each field's value */
+    uint16_t off[GAUGE_FIELDS];
+} template_t;
+
+/* One per format, rendered on first use */
+static template_t templates[2];
+
+static void build(template_t *t, bool openmetrics)
+{
+    size_t len = 0;
+
+    for (unsigned i = 0; i < GAUGE_FIELDS; i++)
+    {
+        const field_t *f = &fields[i];
+        const char *suffix = f->counter ? "_total" : "";
+        const char *type_suffix = openmetrics ? "" : suffix;
+        unsigned width = f->sign + f->digits;
+
+        if (f->decimals > 0)
+        {
+            width += 1 + f->decimals;
+        }
+        len += snprintf(t->text + len, sizeof t->text - len,
+                        "# HELP " PREFIX "%s%s %s\n"
+                        "# TYPE " PREFIX "%s%s %s\n"
+                        PREFIX "%s%s ",
+                        f->name, type_suffix, f->help,
+                        f->name, type_suffix, f->counter ? "counter" : "gauge",
+                        f->name, suffix);
+        t->off[i] = len;
+        // Placeholder, overwritten by each render
+        len += snprintf(t->text + len, sizeof t->text - len, "%0*u\n",
+                        width, 0);
+    }
+    t->len = len;
+}
+
+/* Write v into the field at dst, which ends with the newline. */
+static void patch(char *dst, const field_t *f, int64_t v)
+{
+    uint64_t u;
+    char *p;
+
+    if (f->sign)
+    {
+        *dst++ = v < 0 ? '-' : '+';
+    }
+    u = v < 0 ? (f->sign ? -(uint64_t)v : 0) : (uint64_t)v;
+
+    p = dst + f->digits + (f->decimals > 0 ? 1 + f->decimals : 0);
+    for (unsigned i = 0; i < f->decimals; i++)
+    {
+        *--p = '0' + u % 10;
+        u /= 10;
+    }
+    if (f->decimals > 0)
+    {
+        *--p = '.';
+    }
+    for (unsigned i = 0; i < f->digits; i++)
+    {
+        *--p = '0' + u % 10;
+        u /= 10;
+    }
+
+    // Clamp values that do not fit
+    if (u != 0)
+    {
+        for (p = dst; *p != '\n'; p++)
+        {
+            if (*p != '.')
+            {
+                *p = '9';
+            }
+        }
+    }
+}
+
+const char *gauges_render(bool openmetrics, const int64_t values[GAUGE_FIELDS],
+                          size_t *len)
+{
+    template_t *t = &templates[openmetrics];
+
+    if (t->len == 0)
+    {
+        build(t, openmetrics);
+    }
+    for (unsigned i = 0; i < GAUGE_FIELDS; i++)
+    {
+        patch(t->text + t->off[i], &fields[i], values[i]);
+    }
+    *len = t->len;
+
+    return t->text;
+}
@@ -0,0 +1,56 @@
+#ifndef _GAUGES_H
+#define _GAUGES_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Sensor, network and system metrics in the OpenMetrics or Prometheus text
+ * format, for /metrics.
+ *
+ * The text is rendered once into a static template, in which every value
+ * is a fixed-width field: a sign if the value may be negative, then zero
+ * padded digits, e.g. "+0021.34" or "0000004711". Both formats accept
+ * leading zeros and an explicit sign. A scrape only overwrites the digits
+ * of the fields in place, so there is no formatting of names, no malloc()
+ * and no floating point. Values beyond the width of a field are clamped.
+ *
+ * Temperature, humidity and pressure are those of the primary sensor, and
+ * are 0 until it has been read, as is the rssi until it is known; the
+ * *_valid gauges tell these cases apart.
+ *
+ * The two formats only differ in the TYPE lines of counters, which name
+ * the metric family without "_total" in OpenMetrics. The "# EOF" line that
+ * ends an OpenMetrics exposition is not included, so that other metrics
+ * can follow.
+ */
+
+/* Fields of the template, in order */
+typedef enum gauge_field
+{
+    GAUGE_TEMPERATURE,
+    GAUGE_HUMIDITY,
+    GAUGE_PRESSURE,
+    GAUGE_SENSOR_VALID,
+    GAUGE_RSSI,
+    GAUGE_RSSI_VALID,
+    GAUGE_UPTIME,
+    GAUGE_SAMPLES,
+    GAUGE_I2C_ERRORS,
+    GAUGE_HEAP_FREE,
+    GAUGE_FIELDS,
+} gauge_field_t;
+
+/*
+ * Patch values into the template for the format, and return it. Values
+ * are integers in the unit of the field's last digit: temperature in
+ * centi-degrees C, humidity in centi-%RH, pressure in Pa, rssi in dBm,
+ * uptime in seconds and the heap in bytes.
+ *
+ * Not reentrant; all calls must be made in the same context.
+ */
+const char *gauges_render(bool openmetrics, const int64_t values[GAUGE_FIELDS],
+                          size_t *len);
+
+#endif
@@ -1,4 +1,11 @@
+#include <inttypes.h>
+#include <malloc.h>
+#include <stdarg.h>
+#include <string.h>
+#include <strings.h>
+
 #include "pico/cyw43_arch.h"
+#include "hardware/sync.h"
 
 /*
  * Include picow_http/http.h for picow-http's public API.
@@ -6,55 +13,833 @@
  */
 #include "picow_http/http.h"
 
+#include "acquire.h"
+#include "display.h"
+#include "gauges.h"
 #include "handlers.h"
+#include "i2c_arbiter.h"
+#include "json.h"
+#include "metrics.h"
+#include "profiles.h"
+#include "sample_bin.h"
+#include "sampler.h"
+#include "sensors.h"
 #include "utils.h"
 
-// Custom handler for GET/HEAD /get_sensor_data
+/*
+ * Parse the decimal value of a query parameter, which is not
+ * NUL-terminated.
+ */
+static bool
+parse_u32(const uint8_t *s, size_t len, uint32_t *val)
+{
+	uint32_t v = 0;
+
+	if (len == 0 || len > STRLEN_LTRL("4294967295"))
+		return false;
+	for (size_t i = 0; i < len; i++)
+	{
+		if (s[i] < '0' || s[i] > '9')
+			return false;
+		if (v > (UINT32_MAX - (s[i] - '0')) / 10)
+			return false;
+		v = v * 10 + (s[i] - '0');
+	}
+	*val = v;
+	return true;
+}
+
+/* Is c optional whitespace (OWS)? */
+static inline bool
+is_ows(char c)
+{
+	return c == ' ' || c == '\t';
+}
+
+/* Narrow s[*lo, *hi) to exclude OWS at both ends. */
+static void
+ows_trim(const char *s, size_t *lo, size_t *hi)
+{
+	while (*lo < *hi && is_ows(s[*lo]))
+		(*lo)++;
+	while (*hi > *lo && is_ows(s[*hi - 1]))
+		(*hi)--;
+}
+
+/* Is the qvalue s[0, len) zero, i.e. "0" or "0." and up to 3 zeroes? */
+static bool
+qvalue_zero(const char *s, size_t len)
+{
+	if (len == 0 || s[0] != '0')
+		return false;
+	if (len == 1)
+		return true;
+	if (s[1] != '.' || len > 5)
+		return false;
+	for (size_t i = 2; i < len; i++)
+		if (s[i] != '0')
+			return false;
+	return true;
+}
+
+/*
+ * Return true if the value of request header name, a comma-separated list
+ * such as Accept, has an element whose media range is token, compared
+ * without regard to case, and which is not refused with q=0. Other
+ * parameters and wildcards are not considered.
+ */
+static bool
+hdr_has_token(struct req *req, const char *name, size_t name_len,
+			  const char *token, size_t token_len)
+{
+	const char *val;
+	size_t val_len, end;
+
+	if ((val = http_req_hdr(req, name, name_len, &val_len)) == NULL)
+		return false;
+	for (size_t start = 0; start < val_len; start = end + 1)
+	{
+		size_t lo = start, hi, param;
+
+		for (end = start; end < val_len && val[end] != ','; end++)
+			;
+		for (param = start; param < end && val[param] != ';'; param++)
+			;
+		hi = param;
+		ows_trim(val, &lo, &hi);
+		if (hi - lo != token_len ||
+			strncasecmp(val + lo, token, token_len) != 0)
+			continue;
+
+		// The parameters, each after a ';'
+		while (param < end)
+		{
+			lo = param + 1;
+			for (param = lo; param < end && val[param] != ';'; param++)
+				;
+			hi = param;
+			ows_trim(val, &lo, &hi);
+			if (hi - lo >= 2 && (val[lo] == 'q' || val[lo] == 'Q') &&
+				val[lo + 1] == '=')
+				return !qvalue_zero(val + lo + 2, hi - lo - 2);
+		}
+		return true;
+	}
+	return false;
+}
+
+/* The client asked for the binary representation (see sample_bin.h). */
+static bool
+accepts_bin(struct req *req)
+{
+	return hdr_has_token(req, "Accept", STRLEN_LTRL("Accept"),
+						 SAMPLE_BIN_TYPE, STRLEN_LTRL(SAMPLE_BIN_TYPE));
+}
+
+/*
+ * Send the pre-rendered body for /sensor or /sensor.bin.
+ *
+ * The response body is rendered by core1 once per sample (see
+ * sensor_cache.h), in JSON and in the binary representation, so the
+ * handler only sends a buffer that is already formatted. As for /netinfo,
+ * the ETag is a hash of the body, and a request with a matching
+ * If-None-Match header gets status 304 with no body. Cache-Control
+ * "no-cache" permits clients to store the response, but requires them to
+ * revalidate it each time. If the representation was negotiated, Vary
+ * tells caches that it depends on Accept.
+ */
+static err_t
+sensor_send(struct http *http, const sensor_body_t *body, bool bin,
+			bool negotiated)
+{
+	struct req *req = http_req(http);
+	struct resp *resp = http_resp(http);
+	const char *etag = bin ? body->bin_etag : body->etag;
+	err_t err;
+
+	// Set the ETag and Cache-Control headers, for both 200 and 304.
+	if ((err = http_resp_set_hdr(resp, "ETag", STRLEN_LTRL("ETag"),
+								 etag, SENSOR_ETAG_LEN)) != ERR_OK)
+	{
+		HTTP_LOG_ERROR("Set header ETag failed: %d", err);
+
+		return metrics_resp_err(http, HTTP_STATUS_INTERNAL_SERVER_ERROR);
+	}
+	if ((err = http_resp_set_hdr_ltrl(resp, "Cache-Control", "no-cache")) != ERR_OK)
+	{
+		HTTP_LOG_ERROR("Set header Cache-Control failed: %d", err);
+
+		return metrics_resp_err(http, HTTP_STATUS_INTERNAL_SERVER_ERROR);
+	}
+	if (negotiated &&
+		(err = http_resp_set_hdr_ltrl(resp, "Vary", "Accept")) != ERR_OK)
+	{
+		HTTP_LOG_ERROR("Set header Vary failed: %d", err);
+
+		return metrics_resp_err(http, HTTP_STATUS_INTERNAL_SERVER_ERROR);
+	}
+
+	// The client already has the current sample.
+	if (http_req_hdr_eq(req, "If-None-Match", STRLEN_LTRL("If-None-Match"),
+						etag, SENSOR_ETAG_LEN))
+	{
+		if ((err = http_resp_set_status(resp, HTTP_STATUS_NOT_MODIFIED)) != ERR_OK)
+		{
+			HTTP_LOG_ERROR("Set status 304 failed: %d", err);
+
+			return metrics_resp_err(http, HTTP_STATUS_INTERNAL_SERVER_ERROR);
+		}
+
+		return http_resp_send_hdr(http);
+	}
+
+	// Set the Content-Length response header.
+	if ((err = http_resp_set_len(resp, bin ? sizeof body->bin : body->len))
+		!= ERR_OK)
+	{
+		HTTP_LOG_ERROR("http_resp_set_len() failed: %d", err);
+
+		return metrics_resp_err(http, HTTP_STATUS_INTERNAL_SERVER_ERROR);
+	}
+	// Set the Content-Type response header.
+	if (bin)
+		err = http_resp_set_type_ltrl(resp, SAMPLE_BIN_TYPE);
+	else
+		err = http_resp_set_type_ltrl(resp, "application/json");
+	if (err != ERR_OK)
+	{
+		HTTP_LOG_ERROR("http_resp_set_type_ltrl() failed: %d", err);
+
+		return metrics_resp_err(http, HTTP_STATUS_INTERNAL_SERVER_ERROR);
+	}
+
+	/*
+	 * The body is held only until the handler returns, so it is not
+	 * durable; lwIP copies it.
+	 */
+	if (bin)
+		return http_resp_send_buf(http, body->bin, sizeof body->bin, false);
+	return http_resp_send_buf(http, (const uint8_t *)body->body, body->len,
+							  false);
+}
+
+/*
+ * Response for /sensor and /sensor.bin
+ *
+ * The query parameter "id" selects the sensor (see sensors.h), default 0.
+ * An id for which no sensor was found gets status 404. The sensor's
+ * current body is held while it is sent, so that core1 renders newer
+ * samples into other slots meanwhile.
+ */
+static err_t
+sensor_respond(struct http *http, bool bin, bool negotiated)
+{
+	struct req *req = http_req(http);
+	const sensor_body_t *body;
+	const uint8_t *query, *val;
+	size_t query_len, val_len;
+	uint32_t id = 0;
+	err_t err;
+
+	if ((query = http_req_query(req, &query_len)) != NULL &&
+		(val = http_req_query_val(query, query_len, (const uint8_t *)"id",
+								  STRLEN_LTRL("id"), &val_len)) != NULL &&
+		!parse_u32(val, val_len, &id))
+		return metrics_resp_err(http, HTTP_STATUS_BAD_REQUEST);
+	if (id >= sensors_count())
+		return metrics_resp_err(http, HTTP_STATUS_NOT_FOUND);
+
+	// No sample has been taken yet.
+	if ((body = sensors_body_hold(id)) == NULL)
+		return metrics_resp_err(http, HTTP_STATUS_SERVICE_UNAVAILABLE);
+	err = sensor_send(http, body, bin, negotiated);
+	sensors_body_release(id);
+
+	return err;
+}
+
+/*
+ * Custom handler for GET/HEAD /sensor
+ *
+ * The body is JSON, or binary if the Accept header names SAMPLE_BIN_TYPE.
+ */
 err_t sensor_handler(struct http *http, void *p)
 {
 	(void)p;
 
+	return sensor_respond(http, accepts_bin(http_req(http)), true);
+}
+
+/*
+ * Custom handler for GET/HEAD /sensor.bin
+ *
+ * As /sensor, always binary.
+ */
+err_t sensor_bin_handler(struct http *http, void *p)
+{
+	(void)p;
+
+	return sensor_respond(http, true, false);
+}
+
+/* Longest element of the "sensors" array in the /sensors body. */
+#define SENSORS_JSON_REC_MAX                                           \
+	(STRLEN_LTRL(",{\"id\":4294967295,\"bus\":255,\"addr\":255,"  \
+				 "\"ts\":4294967295,\"bus_us\":4294967295,}") +       \
+	 JSON_SENSOR_FIELDS_MAX)
+#define SENSORS_JSON_MAX                                               \
+	(STRLEN_LTRL("{\"sensors\":[]}") + SENSORS_MAX * SENSORS_JSON_REC_MAX)
+
+/*
+ * Custom handler for GET/HEAD /sensors
+ *
+ * Lists the latest sample of every sensor that has been read successfully:
+ *
+ * {"sensors":[{"id":0,"bus":0,"addr":118,"ts":<ts>,"bus_us":<us>,
+ *   "temperature":..,"humidity":..,"pressure":..},...]}
+ *
+ * ts is the time of the sample in seconds since boot, bus_us the time the
+ * last read spent in i2c transactions. The samples change
+ * every round, so the response is not cached.
+ */
+err_t sensors_handler(struct http *http, void *p)
+{
 	struct resp *resp = http_resp(http);
+	char body[SENSORS_JSON_MAX];
+	size_t len;
+	unsigned n = sensors_count();
+	bool sep = false;
 	err_t err;
+	(void)p;
 
-	// Get the current temperature value.
-	sensor_data_t data = get_sensor_data();
-	char *body = new_string("{\"temperature\":%.2f,\"humidity\":%.2f,\"pressure\":%.2f}",
-							data.temperature,
-							data.humidity,
-							data.pressure);
+	len = snprintf(body, sizeof body, "{\"sensors\":[");
+	for (unsigned id = 0; id < n; id++)
+	{
+		sensor_info_t info;
+		sensor_stats_t stats;
+		sample_t s;
 
-	size_t body_len = strlen(body);
-	// Set the Content-Length response header.
-	if ((err = http_resp_set_len(resp, body_len)) != ERR_OK)
+		if (!sensors_info(id, &info) || !sensors_get(id, &s) ||
+			!sensors_stats(id, &stats))
+			continue;
+		len += snprintf(body + len, sizeof body - len,
+						"%s{\"id\":%u,\"bus\":%u,\"addr\":%u,\"ts\":%" PRIu32
+						",\"bus_us\":%" PRIu32 ",",
+						sep ? "," : "", id, info.bus, info.addr, s.ts,
+						stats.bus_us);
+		len += json_sensor_fields(body + len, &s);
+		body[len++] = '}';
+		sep = true;
+	}
+	body[len++] = ']';
+	body[len++] = '}';
+
+	if ((err = http_resp_set_len(resp, len)) != ERR_OK)
 	{
-		free(body);
 		HTTP_LOG_ERROR("http_resp_set_len() failed: %d", err);
+		return metrics_resp_err(http, HTTP_STATUS_INTERNAL_SERVER_ERROR);
+	}
+	if ((err = http_resp_set_type_ltrl(resp, "application/json")) != ERR_OK)
+	{
+		HTTP_LOG_ERROR("http_resp_set_type_ltrl() failed: %d", err);
+		return metrics_resp_err(http, HTTP_STATUS_INTERNAL_SERVER_ERROR);
+	}
+	if ((err = http_resp_set_hdr_ltrl(resp, "Cache-Control", "no-store")) != ERR_OK)
+	{
+		HTTP_LOG_ERROR("Set header Cache-Control failed: %d", err);
+		return metrics_resp_err(http, HTTP_STATUS_INTERNAL_SERVER_ERROR);
+	}
+
+	// The body is in a local array, so it is not durable.
+	return http_resp_send_buf(http, (const uint8_t *)body, len, false);
+}
+
+/* Size of the buffer for the /config/profile response body. */
+#define PROFILE_JSON_MAX (256)
+
+/*
+ * Custom handler for GET/HEAD/POST /config/profile
+ *
+ * POST with the query parameter "name" requests the acquisition profile of
+ * that name (see profiles.h); a missing or unknown name gets status 400.
+ * core1 applies the profile to all sensors before its next read, so the
+ * response is sent before the new settings are in effect. All methods
+ * respond with the state of the profiles:
+ *
+ * {"active":"weather","interval_ms":1000,"requested":"indoor-nav",
+ *  "profiles":["low-power","weather","indoor-nav"]}
+ *
+ * where "requested" is only present in the response to POST.
+ */
+err_t profile_handler(struct http *http, void *p)
+{
+	struct req *req = http_req(http);
+	struct resp *resp = http_resp(http);
+	const profile_t *active = profiles_active(), *requested = NULL;
+	const uint8_t *query, *val;
+	size_t query_len, val_len, len;
+	char body[PROFILE_JSON_MAX];
+	err_t err;
+	(void)p;
+
+	if (http_req_method(req) == HTTP_METHOD_POST)
+	{
+		if ((query = http_req_query(req, &query_len)) == NULL ||
+			(val = http_req_query_val(query, query_len,
+									  (const uint8_t *)"name",
+									  STRLEN_LTRL("name"), &val_len)) == NULL ||
+			(requested = profiles_find(val, val_len)) == NULL)
+			return metrics_resp_err(http, HTTP_STATUS_BAD_REQUEST);
+
+		profiles_request(requested);
+		// Wake core1 from its wait for the next read
+		__sev();
+	}
 
-		return http_resp_err(http, HTTP_STATUS_INTERNAL_SERVER_ERROR);
+	len = snprintf(body, sizeof body,
+				   "{\"active\":\"%s\",\"interval_ms\":%" PRIu32,
+				   active->name, active->interval_ms);
+	if (requested != NULL)
+		len += snprintf(body + len, sizeof body - len,
+						",\"requested\":\"%s\"", requested->name);
+	len += snprintf(body + len, sizeof body - len, ",\"profiles\":[");
+	for (unsigned i = 0; i < profiles_count(); i++)
+		len += snprintf(body + len, sizeof body - len, "%s\"%s\"",
+						i > 0 ? "," : "", profiles_get(i)->name);
+	len += snprintf(body + len, sizeof body - len, "]}");
+
+	if ((err = http_resp_set_len(resp, len)) != ERR_OK)
+	{
+		HTTP_LOG_ERROR("http_resp_set_len() failed: %d", err);
+		return metrics_resp_err(http, HTTP_STATUS_INTERNAL_SERVER_ERROR);
 	}
-	// Set the Content-Type response header, in this case to "application/json".
 	if ((err = http_resp_set_type_ltrl(resp, "application/json")) != ERR_OK)
 	{
-		free(body);
 		HTTP_LOG_ERROR("http_resp_set_type_ltrl() failed: %d", err);
+		return metrics_resp_err(http, HTTP_STATUS_INTERNAL_SERVER_ERROR);
+	}
+	if ((err = http_resp_set_hdr_ltrl(resp, "Cache-Control", "no-store")) != ERR_OK)
+	{
+		HTTP_LOG_ERROR("Set header Cache-Control failed: %d", err);
+		return metrics_resp_err(http, HTTP_STATUS_INTERNAL_SERVER_ERROR);
+	}
+
+	return http_resp_send_buf(http, (const uint8_t *)body, len, false);
+}
+
+/* Longest /sampler response body. */
+#define SAMPLER_JSON_MAX                                               \
+	(STRLEN_LTRL("{\"samples\":4294967295,\"slot_us\":4294967295,"     \
+				 "\"due_us\":18446744073709551615,"                      \
+				 "\"start_us\":18446744073709551615,"                    \
+				 "\"late_us\":4294967295,\"late_max_us\":4294967295,"  \
+				 "\"late_avg_us\":4294967295,\"missed\":4294967295,"   \
+				 "\"period_us\":4294967295,\"awake_us\":4294967295,"   \
+				 "\"duty\":,\"duty_avg\":,"                             \
+				 "\"display\":{\"frames\":4294967295,"                  \
+				 "\"skipped\":4294967295,\"aborted\":4294967295,"     \
+				 "\"errors\":4294967295,\"bus_waits\":4294967295,"    \
+				 "\"bus_wait_max_us\":4294967295}}") +                  \
+	 2 * FMT_CENTI_MAX)
+
+/* Share of period in which core1 was awake, in hundredths of a percent. */
+static int32_t
+duty_centi(uint64_t awake, uint64_t period)
+{
+	return period == 0 ? 0 : (int32_t)(awake * 10000 / period);
+}
+
+/*
+ * Custom handler for GET/HEAD /sampler
+ *
+ * Reports the timing of core1's sampling loop (see sampler.h), all times in
+ * us:
+ *
+ * {"samples":<n>,"slot_us":<us>,"due_us":<us>,"start_us":<us>,
+ *  "late_us":<us>,"late_max_us":<us>,"late_avg_us":<us>,"missed":<n>,
+ *  "period_us":<us>,"awake_us":<us>,"duty":1.23,"duty_avg":1.20,
+ *  "display":{"frames":<n>,"skipped":<n>,"aborted":<n>,"errors":<n>,
+ *             "bus_waits":<n>,"bus_wait_max_us":<us>}}
+ *
+ * due_us and start_us are the intended and the actual start of the last
+ * sample, in us since boot; the late_* fields are the difference, for the
+ * last sample, the largest and the mean. missed counts slots skipped after
+ * an overrun. period_us is the time between the starts of the last two
+ * samples and awake_us the time core1 was awake in it; duty is their ratio
+ * in percent, and duty_avg the ratio since boot.
+ *
+ * display reports the display task (see display.h): frames started,
+ * samples skipped, frames aborted for a sensor read and frames not
+ * acknowledged. bus_waits counts sensor reads on i2c_default that waited
+ * for a frame, bus_wait_max_us is the longest wait.
+ */
+err_t sampler_handler(struct http *http, void *p)
+{
+	struct resp *resp = http_resp(http);
+	sampler_stats_t st;
+	display_stats_t ds;
+	i2c_arbiter_stats_t as;
+	/* Room for the NUL of the last snprintf() */
+	char body[SAMPLER_JSON_MAX + 1];
+	char *b;
+	err_t err;
+	(void)p;
+
+	sampler_stats(&st);
+	b = body + snprintf(body, sizeof body,
+						"{\"samples\":%" PRIu32 ",\"slot_us\":%" PRIu32
+						",\"due_us\":%" PRIu64 ",\"start_us\":%" PRIu64
+						",\"late_us\":%" PRIu32 ",\"late_max_us\":%" PRIu32
+						",\"late_avg_us\":%" PRIu32 ",\"missed\":%" PRIu32
+						",\"period_us\":%" PRIu32 ",\"awake_us\":%" PRIu32
+						",\"duty\":",
+						st.samples, st.slot_us, st.due_us, st.start_us,
+						st.late_us, st.late_max_us,
+						st.samples == 0 ? 0
+										: (uint32_t)(st.late_total_us /
+													 st.samples),
+						st.missed, st.period_us, st.awake_us);
+	b = fmt_centi(b, duty_centi(st.awake_us, st.period_us));
+	memcpy(b, ",\"duty_avg\":", STRLEN_LTRL(",\"duty_avg\":"));
+	b += STRLEN_LTRL(",\"duty_avg\":");
+	b = fmt_centi(b, duty_centi(st.awake_total_us, st.period_total_us));
 
-		return http_resp_err(http, HTTP_STATUS_INTERNAL_SERVER_ERROR);
+	display_stats(&ds);
+	i2c_arbiter_stats(i2c_default, &as);
+	b += snprintf(b, body + sizeof body - b,
+				  ",\"display\":{\"frames\":%" PRIu32 ",\"skipped\":%" PRIu32
+				  ",\"aborted\":%" PRIu32 ",\"errors\":%" PRIu32
+				  ",\"bus_waits\":%" PRIu32 ",\"bus_wait_max_us\":%" PRIu32
+				  "}}",
+				  ds.frames, ds.skipped, ds.aborted, ds.errors, as.waits,
+				  as.wait_max_us);
+
+	if ((err = http_resp_set_len(resp, b - body)) != ERR_OK)
+	{
+		HTTP_LOG_ERROR("http_resp_set_len() failed: %d", err);
+		return metrics_resp_err(http, HTTP_STATUS_INTERNAL_SERVER_ERROR);
+	}
+	if ((err = http_resp_set_type_ltrl(resp, "application/json")) != ERR_OK)
+	{
+		HTTP_LOG_ERROR("http_resp_set_type_ltrl() failed: %d", err);
+		return metrics_resp_err(http, HTTP_STATUS_INTERNAL_SERVER_ERROR);
 	}
-	// Set the Cache-Control header to "no-store", to indicate that the response
-	// is not cacheable.
 	if ((err = http_resp_set_hdr_ltrl(resp, "Cache-Control", "no-store")) != ERR_OK)
 	{
-		free(body);
 		HTTP_LOG_ERROR("Set header Cache-Control failed: %d", err);
+		return metrics_resp_err(http, HTTP_STATUS_INTERNAL_SERVER_ERROR);
+	}
+
+	return http_resp_send_buf(http, (const uint8_t *)body, b - body, false);
+}
+
+/* Longest /eventloop response body. */
+#define EVENTLOOP_JSON_MAX                                              \
+	(STRLEN_LTRL("{\"mode\":\"background\",\"count\":4294967295,"       \
+				 "\"dropped\":4294967295,\"avg_us\":4294967295,"        \
+				 "\"max_us\":4294967295,\"buckets\":[]}") +               \
+	 LATENCY_BUCKETS * STRLEN_LTRL("4294967295,"))
+
+/*
+ * Custom handler for GET/HEAD /eventloop
+ *
+ * Reports the latency of the work loop on core0 (see main.c), from the
+ * time that the rssi timer or core1 posts an item to its completion:
+ *
+ * {"mode":"poll","count":<n>,"dropped":<n>,"avg_us":<us>,"max_us":<us>,
+ *  "buckets":[<n>,...]}
+ *
+ * mode is the cyw43_arch that the image was built with, so that images
+ * built with and without PICO_METEO_BACKGROUND can be compared. Bucket i
+ * counts the items that took at most 2^i us, and more than 2^(i-1); the
+ * last bucket counts all longer ones.
+ */
+err_t eventloop_handler(struct http *http, void *p)
+{
+	struct resp *resp = http_resp(http);
+	loop_stats_t st;
+	char body[EVENTLOOP_JSON_MAX + 1];
+	size_t len;
+	err_t err;
+	(void)p;
 
-		return http_resp_err(http, HTTP_STATUS_INTERNAL_SERVER_ERROR);
+	get_loop_stats(&st);
+	len = snprintf(body, sizeof body,
+				   "{\"mode\":\"%s\",\"count\":%" PRIu32
+				   ",\"dropped\":%" PRIu32 ",\"avg_us\":%" PRIu32
+				   ",\"max_us\":%" PRIu32 ",\"buckets\":[",
+				   st.mode, st.latency.count, st.dropped,
+				   st.latency.count == 0
+					   ? 0
+					   : (uint32_t)(st.latency.sum_us / st.latency.count),
+				   st.latency.max_us);
+	for (unsigned i = 0; i < LATENCY_BUCKETS; i++)
+	{
+		len += snprintf(body + len, sizeof body - len, "%s%" PRIu32,
+						i == 0 ? "" : ",", st.latency.buckets[i]);
 	}
+	body[len++] = ']';
+	body[len++] = '}';
 
-	err = http_resp_send_buf(http, body, body_len, false);
-	free(body);
+	if ((err = http_resp_set_len(resp, len)) != ERR_OK)
+	{
+		HTTP_LOG_ERROR("http_resp_set_len() failed: %d", err);
+		return metrics_resp_err(http, HTTP_STATUS_INTERNAL_SERVER_ERROR);
+	}
+	if ((err = http_resp_set_type_ltrl(resp, "application/json")) != ERR_OK)
+	{
+		HTTP_LOG_ERROR("http_resp_set_type_ltrl() failed: %d", err);
+		return metrics_resp_err(http, HTTP_STATUS_INTERNAL_SERVER_ERROR);
+	}
+	if ((err = http_resp_set_hdr_ltrl(resp, "Cache-Control", "no-store")) != ERR_OK)
+	{
+		HTTP_LOG_ERROR("Set header Cache-Control failed: %d", err);
+		return metrics_resp_err(http, HTTP_STATUS_INTERNAL_SERVER_ERROR);
+	}
 
-	return err;
+	return http_resp_send_buf(http, (const uint8_t *)body, len, false);
+}
+
+/* Size of the buffer in which the /metrics response is assembled. */
+#define METRICS_CHUNK_LEN (512)
+
+/* Longest line of the /metrics response, with a path of up to 32 bytes. */
+#define METRICS_LINE_MAX (160)
+
+#define METRICS_PREFIX "pico_meteo_http_"
+
+/*
+ * Response body that is sent in chunks as it is formatted. Once a write
+ * has failed, further output is discarded, and err is returned at the end.
+ */
+typedef struct
+{
+	struct http *http;
+	err_t err;
+	size_t len;
+	char buf[METRICS_CHUNK_LEN];
+} chunked_t;
+
+static void
+chunked_flush(chunked_t *c)
+{
+	if (c->err == ERR_OK && c->len > 0 &&
+		(c->err = http_resp_send_chunk(c->http, (uint8_t *)c->buf, c->len,
+									   false)) != ERR_OK)
+		HTTP_LOG_ERROR("http_resp_send_chunk() failed: %d", c->err);
+	c->len = 0;
+}
+
+/* Append a line of at most METRICS_LINE_MAX characters. */
+static void
+chunked_printf(chunked_t *c, const char *fmt, ...)
+{
+	va_list ap;
+
+	if (c->len + METRICS_LINE_MAX >= sizeof c->buf)
+		chunked_flush(c);
+	va_start(ap, fmt);
+	c->len += vsnprintf(c->buf + c->len, sizeof c->buf - c->len, fmt, ap);
+	va_end(ap);
+}
+
+/* Append len bytes of buf, which is sent as it is if it is large. */
+static void
+chunked_write(chunked_t *c, const char *buf, size_t len)
+{
+	if (c->len + len <= sizeof c->buf)
+	{
+		memcpy(c->buf + c->len, buf, len);
+		c->len += len;
+		return;
+	}
+	chunked_flush(c);
+	if (c->err == ERR_OK &&
+		(c->err = http_resp_send_chunk(c->http, (const uint8_t *)buf, len,
+									   false)) != ERR_OK)
+		HTTP_LOG_ERROR("http_resp_send_chunk() failed: %d", c->err);
+}
+
+#define OPENMETRICS_TYPE "application/openmetrics-text"
+
+/* Bytes of the heap not allocated by malloc(), see the linker script. */
+static uint32_t
+heap_free(void)
+{
+	extern char __StackLimit, __bss_end__;
+	struct mallinfo mi = mallinfo();
+
+	return &__StackLimit - &__bss_end__ - mi.uordblks;
+}
+
+/*
+ * Custom handler for GET/HEAD /metrics
+ *
+ * Reports the readings of the primary sensor, the rssi, uptime, sample
+ * and i2c error counts and free heap (see gauges.h), followed by the
+ * request metrics of all routes (see metrics.h):
+ *
+ * pico_meteo_temperature_celsius +00021.34
+ * ...
+ * pico_meteo_http_requests_total{path="/sensor"} 42
+ * pico_meteo_http_errors_total{path="/sensor"} 1
+ * pico_meteo_http_request_duration_seconds_bucket{path="/sensor",le="0.000001"} 0
+ * ...
+ * pico_meteo_http_request_duration_seconds_bucket{path="/sensor",le="+Inf"} 42
+ * pico_meteo_http_request_duration_seconds_sum{path="/sensor"} 0.012345
+ * pico_meteo_http_request_duration_seconds_count{path="/sensor"} 42
+ *
+ * If the Accept header names application/openmetrics-text, as Prometheus
+ * sends, the response is OpenMetrics 1.0.0 and ends with "# EOF".
+ * Otherwise it is the Prometheus text format, version 0.0.4.
+ *
+ * The histogram buckets are the log2 buckets of latency.h, from 1 us to
+ * 2^(LATENCY_BUCKETS-2) us. Request rates and tail latencies are left to
+ * the scraper, e.g. rate() and histogram_quantile().
+ *
+ * The body is several KB, so it is sent with chunked transfer encoding as
+ * it is formatted.
+ */
+err_t metrics_handler(struct http *http, void *p)
+{
+	struct req *req = http_req(http);
+	struct resp *resp = http_resp(http);
+	unsigned n = metrics_routes();
+	int64_t values[GAUGE_FIELDS];
+	const char *gauges, *counter_sfx;
+	size_t gauges_len;
+	sensor_stats_t st;
+	sample_t sample;
+	int32_t rssi;
+	bool om;
+	chunked_t c;
+	err_t err;
+	(void)p;
+
+	om = hdr_has_token(req, "Accept", STRLEN_LTRL("Accept"),
+					   OPENMETRICS_TYPE, STRLEN_LTRL(OPENMETRICS_TYPE));
+	if (om)
+		err = http_resp_set_type_ltrl(resp, OPENMETRICS_TYPE
+									  "; version=1.0.0; charset=utf-8");
+	else
+		err = http_resp_set_type_ltrl(resp, "text/plain; version=0.0.4");
+	if (err != ERR_OK)
+	{
+		HTTP_LOG_ERROR("http_resp_set_type_ltrl() failed: %d", err);
+		return metrics_resp_err(http, HTTP_STATUS_INTERNAL_SERVER_ERROR);
+	}
+	if ((err = http_resp_set_hdr_ltrl(resp, "Cache-Control", "no-store")) != ERR_OK)
+	{
+		HTTP_LOG_ERROR("Set header Cache-Control failed: %d", err);
+		return metrics_resp_err(http, HTTP_STATUS_INTERNAL_SERVER_ERROR);
+	}
+	if ((err = http_resp_set_xfer_chunked(resp)) != ERR_OK)
+	{
+		HTTP_LOG_ERROR("http_resp_set_xfer_chunked() failed: %d", err);
+		return metrics_resp_err(http, HTTP_STATUS_INTERNAL_SERVER_ERROR);
+	}
+	if ((err = http_resp_send_hdr(http)) != ERR_OK)
+	{
+		HTTP_LOG_ERROR("http_resp_send_hdr() failed: %d", err);
+		return err;
+	}
+	if (http_req_method(req) == HTTP_METHOD_HEAD)
+		return ERR_OK;
+
+	c.http = http;
+	c.err = ERR_OK;
+	c.len = 0;
+
+	memset(values, 0, sizeof values);
+	if (sensors_get(0, &sample))
+	{
+		values[GAUGE_TEMPERATURE] = sample.temperature;
+		values[GAUGE_HUMIDITY] = sample_humidity_centi(&sample);
+		values[GAUGE_PRESSURE] = sample_pressure_pa(&sample);
+		values[GAUGE_SENSOR_VALID] = 1;
+	}
+	if ((rssi = get_rssi()) != INT32_MAX)
+	{
+		values[GAUGE_RSSI] = rssi;
+		values[GAUGE_RSSI_VALID] = 1;
+	}
+	values[GAUGE_UPTIME] = time_us_64() / 1000000;
+	for (unsigned id = 0; sensors_stats(id, &st); id++)
+	{
+		if (id == 0)
+			values[GAUGE_SAMPLES] = st.reads;
+		values[GAUGE_I2C_ERRORS] += st.failures;
+	}
+	values[GAUGE_HEAP_FREE] = heap_free();
+
+	gauges = gauges_render(om, values, &gauges_len);
+	chunked_write(&c, gauges, gauges_len);
+
+	/* OpenMetrics names the family of a counter without the suffix. */
+	counter_sfx = om ? "" : "_total";
+
+	chunked_printf(&c, "# HELP " METRICS_PREFIX "requests%s "
+				   "Requests handled.\n", counter_sfx);
+	chunked_printf(&c, "# TYPE " METRICS_PREFIX "requests%s counter\n",
+				   counter_sfx);
+	for (unsigned i = 0; i < n; i++)
+	{
+		const route_metrics_t *r = metrics_route(i);
+		chunked_printf(&c, METRICS_PREFIX "requests_total{path=\"%s\"} %"
+					   PRIu32 "\n", r->path, r->requests);
+	}
+
+	chunked_printf(&c, "# HELP " METRICS_PREFIX "errors%s "
+				   "Requests answered with an error status, or failed.\n",
+				   counter_sfx);
+	chunked_printf(&c, "# TYPE " METRICS_PREFIX "errors%s counter\n",
+				   counter_sfx);
+	for (unsigned i = 0; i < n; i++)
+	{
+		const route_metrics_t *r = metrics_route(i);
+		chunked_printf(&c, METRICS_PREFIX "errors_total{path=\"%s\"} %"
+					   PRIu32 "\n", r->path, r->errors);
+	}
+
+	chunked_printf(&c, "# HELP " METRICS_PREFIX "request_duration_seconds "
+				   "Time in the request handler.\n");
+	chunked_printf(&c, "# TYPE " METRICS_PREFIX "request_duration_seconds "
+				   "histogram\n");
+	for (unsigned i = 0; i < n; i++)
+	{
+		const route_metrics_t *r = metrics_route(i);
+		uint32_t cum = 0;
+
+		for (unsigned b = 0; b < LATENCY_BUCKETS - 1; b++)
+		{
+			uint32_t le = latency_bucket_le(b);
+
+			cum += r->latency.buckets[b];
+			chunked_printf(&c, METRICS_PREFIX "request_duration_seconds_bucket"
+						   "{path=\"%s\",le=\"%" PRIu32 ".%06" PRIu32 "\"} %"
+						   PRIu32 "\n", r->path, le / 1000000, le % 1000000,
+						   cum);
+		}
+		chunked_printf(&c, METRICS_PREFIX "request_duration_seconds_bucket"
+					   "{path=\"%s\",le=\"+Inf\"} %" PRIu32 "\n", r->path,
+					   r->latency.count);
+		chunked_printf(&c, METRICS_PREFIX "request_duration_seconds_sum"
+					   "{path=\"%s\"} %" PRIu32 ".%06" PRIu32 "\n", r->path,
+					   (uint32_t)(r->latency.sum_us / 1000000),
+					   (uint32_t)(r->latency.sum_us % 1000000));
+		chunked_printf(&c, METRICS_PREFIX "request_duration_seconds_count"
+					   "{path=\"%s\"} %" PRIu32 "\n", r->path,
+					   r->latency.count);
+	}
+	if (om)
+		chunked_printf(&c, "# EOF\n");
+
+	chunked_flush(&c);
+	if (c.err != ERR_OK)
+		return c.err;
+
+	/* A zero-length chunk ends the response. */
+	return http_resp_send_chunk(http, NULL, 0, false);
 }
 
 /* These will be used for JSON boolean values. */
@@ -108,7 +893,7 @@ err_t rssi_handler(struct http *http, void *p)
 	if ((err = http_resp_set_len(resp, body_len)) != ERR_OK)
 	{
 		HTTP_LOG_ERROR("http_resp_set_len() failed: %d", err);
-		return http_resp_err(http, HTTP_STATUS_INTERNAL_SERVER_ERROR);
+		return metrics_resp_err(http, HTTP_STATUS_INTERNAL_SERVER_ERROR);
 	}
 
 	/*
@@ -119,7 +904,7 @@ err_t rssi_handler(struct http *http, void *p)
 	if ((err = http_resp_set_type_ltrl(resp, "application/json")) != ERR_OK)
 	{
 		HTTP_LOG_ERROR("http_resp_set_type_ltrl() failed: %d", err);
-		return http_resp_err(http, HTTP_STATUS_INTERNAL_SERVER_ERROR);
+		return metrics_resp_err(http, HTTP_STATUS_INTERNAL_SERVER_ERROR);
 	}
 
 	/*
@@ -130,7 +915,7 @@ err_t rssi_handler(struct http *http, void *p)
 	if ((err = http_resp_set_hdr_ltrl(resp, "Cache-Control", "no-store")) != ERR_OK)
 	{
 		HTTP_LOG_ERROR("Set header Cache-Control failed: %d", err);
-		return http_resp_err(http, HTTP_STATUS_INTERNAL_SERVER_ERROR);
+		return metrics_resp_err(http, HTTP_STATUS_INTERNAL_SERVER_ERROR);
 	}
 
 	/*
@@ -252,7 +1037,7 @@ err_t netinfo_handler(struct http *http, void *p)
 								 ETAG_LEN - 1)) != ERR_OK)
 	{
 		HTTP_LOG_ERROR("Set header ETag failed: %d", err);
-		return http_resp_err(http, HTTP_STATUS_INTERNAL_SERVER_ERROR);
+		return metrics_resp_err(http, HTTP_STATUS_INTERNAL_SERVER_ERROR);
 	}
 
 	/*
@@ -263,7 +1048,7 @@ err_t netinfo_handler(struct http *http, void *p)
 									  "public, max-age=3600")) != ERR_OK)
 	{
 		HTTP_LOG_ERROR("Set header Cache-Control failed: %d", err);
-		return http_resp_err(http, HTTP_STATUS_INTERNAL_SERVER_ERROR);
+		return metrics_resp_err(http, HTTP_STATUS_INTERNAL_SERVER_ERROR);
 	}
 
 	/*
@@ -290,8 +1075,8 @@ err_t netinfo_handler(struct http *http, void *p)
 		if (err != ERR_OK)
 		{
 			HTTP_LOG_ERROR("Set status 304 failed: %d", err);
-			return http_resp_err(http,
-								 HTTP_STATUS_INTERNAL_SERVER_ERROR);
+			return metrics_resp_err(http,
+									HTTP_STATUS_INTERNAL_SERVER_ERROR);
 		}
 		/*
 		 * http_resp_send_hdr() sends the response
@@ -320,7 +1105,7 @@ err_t netinfo_handler(struct http *http, void *p)
 	if ((err = http_resp_set_len(resp, body_len)) != ERR_OK)
 	{
 		HTTP_LOG_ERROR("http_resp_set_len() failed: %d", err);
-		return http_resp_err(http, HTTP_STATUS_INTERNAL_SERVER_ERROR);
+		return metrics_resp_err(http, HTTP_STATUS_INTERNAL_SERVER_ERROR);
 	}
 
 	/*
@@ -330,7 +1115,7 @@ err_t netinfo_handler(struct http *http, void *p)
 	if ((err = http_resp_set_type_ltrl(resp, "application/json")) != ERR_OK)
 	{
 		HTTP_LOG_ERROR("http_resp_set_type_ltrl() failed: %d", err);
-		return http_resp_err(http, HTTP_STATUS_INTERNAL_SERVER_ERROR);
+		return metrics_resp_err(http, HTTP_STATUS_INTERNAL_SERVER_ERROR);
 	}
 
 	/*
@@ -342,3 +1127,395 @@ err_t netinfo_handler(struct http *http, void *p)
 	 */
 	return http_resp_send_buf(http, body, body_len, false);
 }
+
+/* Members of the /snapshot document, selected by the query parameter "fields". */
+#define SNAPSHOT_SENSOR (1U << 0)
+#define SNAPSHOT_RSSI (1U << 1)
+#define SNAPSHOT_NETINFO (1U << 2)
+#define SNAPSHOT_ALL (SNAPSHOT_SENSOR | SNAPSHOT_RSSI | SNAPSHOT_NETINFO)
+
+static const struct
+{
+	const char *name;
+	size_t len;
+	unsigned bit;
+} snapshot_fields[] = {
+	{"sensor", STRLEN_LTRL("sensor"), SNAPSHOT_SENSOR},
+	{"rssi", STRLEN_LTRL("rssi"), SNAPSHOT_RSSI},
+	{"netinfo", STRLEN_LTRL("netinfo"), SNAPSHOT_NETINFO},
+};
+
+/* Reads of the sample and rssi that are repeated if a new sample arrives. */
+#define SNAPSHOT_RETRIES (3)
+
+#define SNAPSHOT_MAX_LEN                                                   \
+	(STRLEN_LTRL("{\"ts\":4294967295,\"sensor\":{\"ts\":4294967295,},"  \
+				 "\"rssi\":,\"netinfo\":}") +                             \
+	 JSON_SENSOR_FIELDS_MAX + RSSI_MAX_LEN + INFO_MAX_LEN)
+
+/*
+ * Parse the comma-separated list of names in fields=, which may have the
+ * commas percent-encoded as browsers do. Returns false if a name is empty
+ * or unknown.
+ */
+static bool
+parse_fields(const uint8_t *s, size_t len, unsigned *fields)
+{
+	size_t start = 0, i = 0;
+
+	*fields = 0;
+	while (i <= len)
+	{
+		size_t sep, n;
+		bool found = false;
+
+		if (i == len || s[i] == ',')
+			sep = 1;
+		else if (len - i >= 3 && s[i] == '%' && s[i + 1] == '2' &&
+				 (s[i + 2] == 'C' || s[i + 2] == 'c'))
+			sep = 3;
+		else
+		{
+			i++;
+			continue;
+		}
+
+		n = i - start;
+		for (size_t f = 0; f < count_of(snapshot_fields); f++)
+			if (n == snapshot_fields[f].len &&
+				memcmp(s + start, snapshot_fields[f].name, n) == 0)
+			{
+				*fields |= snapshot_fields[f].bit;
+				found = true;
+				break;
+			}
+		if (!found)
+			return false;
+		i += sep;
+		start = i;
+	}
+	return true;
+}
+
+/*
+ * Custom handler for GET/HEAD /snapshot
+ *
+ * Combines the bodies of /sensor, /rssi and /netinfo in one document, so
+ * that a client that needs all of them makes one request instead of three:
+ *
+ * {"ts":<ts>,"sensor":{"ts":<ts>,"temperature":..,"humidity":..,
+ *   "pressure":..},"rssi":{"valid":..,"rssi":..},"netinfo":{"ssid":..,
+ *   "host":..,"ip":..,"mac":..}}
+ *
+ * The outer ts is the time of the snapshot in seconds since boot, the one
+ * in "sensor" that of the sample, which is null if the primary sensor has
+ * not been read yet. The query parameter "fields" selects a
+ * comma-separated subset of sensor, rssi and netinfo, default all of
+ * them; an unknown name gets status 400.
+ *
+ * The values are read together before the body is formatted. If core1
+ * stored a new sample in the meantime, as seen by its read count, the
+ * reads are repeated, so that the sample is the latest one at the time the
+ * rssi was read. As for /rssi, the response is not cached.
+ *
+ * Like /netinfo, the private data pointer is the netinfo structure.
+ */
+err_t snapshot_handler(struct http *http, void *p)
+{
+	struct req *req = http_req(http);
+	struct resp *resp = http_resp(http);
+	netinfo_t *info;
+	const uint8_t *query, *val;
+	size_t query_len, val_len, len;
+	unsigned fields = SNAPSHOT_ALL;
+	char body[SNAPSHOT_MAX_LEN + 1];
+	sample_t s;
+	bool valid = false;
+	int32_t rssi;
+	uint32_t ts;
+	err_t err;
+
+	CAST_OBJ_NOTNULL(info, p, NETINFO_MAGIC);
+
+	if ((query = http_req_query(req, &query_len)) != NULL &&
+		(val = http_req_query_val(query, query_len,
+								  (const uint8_t *)"fields",
+								  STRLEN_LTRL("fields"), &val_len)) != NULL &&
+		!parse_fields(val, val_len, &fields))
+		return metrics_resp_err(http, HTTP_STATUS_BAD_REQUEST);
+
+	for (int i = 0;; i++)
+	{
+		sensor_stats_t before, after;
+		bool stats = sensors_stats(0, &before);
+
+		ts = to_ms_since_boot(get_absolute_time()) / 1000;
+		valid = sensors_get(0, &s);
+		rssi = get_rssi();
+		if (!stats || !sensors_stats(0, &after) ||
+			before.reads == after.reads || i == SNAPSHOT_RETRIES)
+			break;
+	}
+
+	len = snprintf(body, sizeof body, "{\"ts\":%" PRIu32, ts);
+	if (fields & SNAPSHOT_SENSOR)
+	{
+		if (valid)
+		{
+			len += snprintf(body + len, sizeof body - len,
+							",\"sensor\":{\"ts\":%" PRIu32 ",", s.ts);
+			len += json_sensor_fields(body + len, &s);
+			body[len++] = '}';
+		}
+		else
+			len += snprintf(body + len, sizeof body - len,
+							",\"sensor\":null");
+	}
+	if (fields & SNAPSHOT_RSSI)
+	{
+		len += snprintf(body + len, sizeof body - len, ",\"rssi\":");
+		len += snprintf(body + len, sizeof body - len, RSSI_FMT,
+						bool_str[bool_to_bit(rssi != INT32_MAX)], rssi);
+	}
+	if (fields & SNAPSHOT_NETINFO)
+	{
+		len += snprintf(body + len, sizeof body - len, ",\"netinfo\":");
+		len += snprintf(body + len, sizeof body - len, INFO_FMT, info->ip,
+						info->mac);
+	}
+	body[len++] = '}';
+
+	if ((err = http_resp_set_len(resp, len)) != ERR_OK)
+	{
+		HTTP_LOG_ERROR("http_resp_set_len() failed: %d", err);
+		return metrics_resp_err(http, HTTP_STATUS_INTERNAL_SERVER_ERROR);
+	}
+	if ((err = http_resp_set_type_ltrl(resp, "application/json")) != ERR_OK)
+	{
+		HTTP_LOG_ERROR("http_resp_set_type_ltrl() failed: %d", err);
+		return metrics_resp_err(http, HTTP_STATUS_INTERNAL_SERVER_ERROR);
+	}
+	if ((err = http_resp_set_hdr_ltrl(resp, "Cache-Control", "no-store")) != ERR_OK)
+	{
+		HTTP_LOG_ERROR("Set header Cache-Control failed: %d", err);
+		return metrics_resp_err(http, HTTP_STATUS_INTERNAL_SERVER_ERROR);
+	}
+
+	// The body is in a local array, so it is not durable.
+	return http_resp_send_buf(http, (const uint8_t *)body, len, false);
+}
+
+/*
+ * Longest JSON record for a single history sample, including the leading
+ * comma.
+ */
+#define HISTORY_JSON_REC_MAX \
+	(STRLEN_LTRL(",[4294967295,-2147483648,4294967295,4294967295]"))
+/* Size of the buffer in which the /history response is assembled. */
+#define HISTORY_CHUNK_LEN (512)
+
+/*
+ * Response for /history and /history.bin
+ *
+ * Streams the recorded samples with sequence numbers greater than the
+ * value of the query parameter "after", or the complete history if the
+ * parameter is absent. The query parameter "since" (seconds since boot)
+ * further limits them to samples with later timestamps. The response body
+ * has the form:
+ *
+ * {"now":<ts>,"samples":[[<ts>,<t>,<h>,<p>],...],"next":<seq>}
+ *
+ * where t is the temperature in centi-degrees C, h is the humidity in
+ * centi-%RH and p is the pressure in Pa. The value of "next" is the cursor
+ * to be passed as "after" in the following request, so that collectors
+ * receive each sample exactly once: the sequence number of the last sample
+ * examined, or the value of "after" if there is none. Timestamps have a
+ * resolution of a second, so unlike the sequence number they cannot tell
+ * apart samples taken in the same second.
+ *
+ * The history may hold several thousand samples, so the body is sent with
+ * chunked transfer encoding as it is formatted, one history block at a
+ * time. Blocks are copied out with get_history_block(), so core1 is never
+ * held up while a chunk is sent.
+ *
+ * With bin, the body is the header and the records of the binary
+ * representation instead (see sample_bin.h); it has no "now", and the
+ * cursor is the seq of the last record.
+ */
+static err_t
+history_respond(struct http *http, bool bin, bool negotiated)
+{
+	struct req *req = http_req(http);
+	struct resp *resp = http_resp(http);
+	const uint8_t *query, *val;
+	size_t query_len, val_len, len;
+	uint32_t after = 0, since = 0, next, first, last;
+	bool have, by_time = false, sep = false;
+	history_block_t blk;
+	char chunk[HISTORY_CHUNK_LEN];
+	size_t rec_max = bin ? SAMPLE_BIN_REC_LEN : HISTORY_JSON_REC_MAX;
+	err_t err;
+
+	if ((query = http_req_query(req, &query_len)) != NULL)
+	{
+		if ((val = http_req_query_val(query, query_len,
+									  (const uint8_t *)"after",
+									  STRLEN_LTRL("after"), &val_len))
+			!= NULL && !parse_u32(val, val_len, &after))
+			return metrics_resp_err(http, HTTP_STATUS_BAD_REQUEST);
+		if ((val = http_req_query_val(query, query_len,
+									  (const uint8_t *)"since",
+									  STRLEN_LTRL("since"), &val_len))
+			!= NULL)
+		{
+			if (!parse_u32(val, val_len, &since))
+				return metrics_resp_err(http, HTTP_STATUS_BAD_REQUEST);
+			by_time = true;
+		}
+	}
+
+	if (bin)
+		err = http_resp_set_type_ltrl(resp, SAMPLE_BIN_TYPE);
+	else
+		err = http_resp_set_type_ltrl(resp, "application/json");
+	if (err != ERR_OK)
+	{
+		HTTP_LOG_ERROR("http_resp_set_type_ltrl() failed: %d", err);
+		return metrics_resp_err(http, HTTP_STATUS_INTERNAL_SERVER_ERROR);
+	}
+	if ((err = http_resp_set_hdr_ltrl(resp, "Cache-Control", "no-store")) != ERR_OK)
+	{
+		HTTP_LOG_ERROR("Set header Cache-Control failed: %d", err);
+		return metrics_resp_err(http, HTTP_STATUS_INTERNAL_SERVER_ERROR);
+	}
+	if (negotiated &&
+		(err = http_resp_set_hdr_ltrl(resp, "Vary", "Accept")) != ERR_OK)
+	{
+		HTTP_LOG_ERROR("Set header Vary failed: %d", err);
+		return metrics_resp_err(http, HTTP_STATUS_INTERNAL_SERVER_ERROR);
+	}
+	if ((err = http_resp_set_xfer_chunked(resp)) != ERR_OK)
+	{
+		HTTP_LOG_ERROR("http_resp_set_xfer_chunked() failed: %d", err);
+		return metrics_resp_err(http, HTTP_STATUS_INTERNAL_SERVER_ERROR);
+	}
+	if ((err = http_resp_send_hdr(http)) != ERR_OK)
+	{
+		HTTP_LOG_ERROR("http_resp_send_hdr() failed: %d", err);
+		return err;
+	}
+	if (http_req_method(req) == HTTP_METHOD_HEAD)
+		return ERR_OK;
+
+	if (bin)
+		len = sample_bin_header((uint8_t *)chunk);
+	else
+		len = snprintf(chunk, sizeof chunk,
+					   "{\"now\":%" PRIu32 ",\"samples\":[",
+					   to_ms_since_boot(get_absolute_time()) / 1000);
+	next = after;
+
+	have = get_history_span(&first, &last);
+	for (uint32_t seq = first; have && seq <= last; seq++)
+	{
+		history_iter_t it;
+		history_sample_t s;
+		uint32_t blk_last;
+
+		if (!get_history_block(seq, &blk))
+		{
+			/*
+			 * The block was overwritten while the response was
+			 * sent, continue with the oldest block still held.
+			 */
+			if ((have = get_history_span(&first, &last)) && seq < first)
+				seq = first - 1;
+			continue;
+		}
+		blk_last = blk.key.seq + blk.count - 1;
+		if (blk_last <= after)
+			continue;
+		if (by_time && blk.ts_last <= since)
+		{
+			next = blk_last;
+			continue;
+		}
+
+		history_iter_init(&it, &blk);
+		while (history_iter_next(&it, &s))
+		{
+			if (s.seq <= after)
+				continue;
+			next = s.seq;
+			if (by_time && s.ts <= since)
+				continue;
+			if (len + rec_max >= sizeof chunk)
+			{
+				if ((err = http_resp_send_chunk(http, (uint8_t *)chunk, len,
+												false)) != ERR_OK)
+				{
+					HTTP_LOG_ERROR("http_resp_send_chunk() failed: %d",
+								   err);
+					return err;
+				}
+				len = 0;
+			}
+			if (bin)
+				len += sample_bin_record((uint8_t *)chunk + len, &s);
+			else
+				len += snprintf(chunk + len, sizeof chunk - len,
+								"%s[%" PRIu32 ",%" PRId32 ",%" PRIu32
+								",%" PRIu32 "]",
+								sep ? "," : "", s.ts, s.temperature,
+								s.humidity, s.pressure);
+			sep = true;
+		}
+	}
+
+	if (!bin && len + STRLEN_LTRL("],\"next\":4294967295}") >= sizeof chunk)
+	{
+		if ((err = http_resp_send_chunk(http, (uint8_t *)chunk, len,
+										false)) != ERR_OK)
+		{
+			HTTP_LOG_ERROR("http_resp_send_chunk() failed: %d", err);
+			return err;
+		}
+		len = 0;
+	}
+	if (!bin)
+		len += snprintf(chunk + len, sizeof chunk - len,
+						"],\"next\":%" PRIu32 "}", next);
+	if ((err = http_resp_send_chunk(http, (uint8_t *)chunk, len, false)) !=
+		ERR_OK)
+	{
+		HTTP_LOG_ERROR("http_resp_send_chunk() failed: %d", err);
+		return err;
+	}
+
+	/* A zero-length chunk ends the response. */
+	return http_resp_send_chunk(http, NULL, 0, false);
+}
+
+/*
+ * Custom handler for GET/HEAD /history
+ *
+ * The body is JSON, or binary if the Accept header names SAMPLE_BIN_TYPE.
+ */
+err_t history_handler(struct http *http, void *p)
+{
+	(void)p;
+
+	return history_respond(http, accepts_bin(http_req(http)), true);
+}
+
+/*
+ * Custom handler for GET/HEAD /history.bin
+ *
+ * As /history, always binary.
+ */
+err_t history_bin_handler(struct http *http, void *p)
+{
+	(void)p;
+
+	return history_respond(http, true, false);
+}
@@ -3,6 +3,9 @@
 #include "lwip/ip_addr.h"
 #include "picow_http/http.h"
 
+#include "latency.h"
+#include "sample.h"
+
 #define MAC_ADDR_LEN (sizeof("01:02:03:04:05:06"))
 
 /*
@@ -23,29 +26,45 @@ typedef struct
 	char mac[MAC_ADDR_LEN];
 } netinfo_t;
 
-typedef struct sensor_data
-{
-	float temperature;
-	float humidity;
-	float pressure;
-} sensor_data_t;
+/*
+ * Return the most recent rssi value for "our" access point, or INT32_MAX
+ * if no rssi value has been read.
+ */
+int32_t get_rssi(void);
 
 /*
- * Return sensor_data_t data structure with the most recent sensor readings
+ * Statistics of the work loop on core0, for the /eventloop handler.
  */
-sensor_data_t get_sensor_data(void);
+typedef struct
+{
+	/* "poll" or "background", the cyw43_arch the image is built with */
+	const char *mode;
+	/* Work items dropped because the queue was full */
+	uint32_t dropped;
+	/* Time from posting to completion of the work items */
+	latency_hist_t latency;
+} loop_stats_t;
 
 /*
- * Return the most recent rssi value for "our" access point, or INT32_MAX
- * if no rssi value has been read.
+ * Copy the statistics of the work loop. Must be called in lwIP context,
+ * as handlers are.
  */
-int32_t get_rssi(void);
+void get_loop_stats(loop_stats_t *stats);
 
 /*
  * Custom response handlers for the URL paths:
  * /sensor
+ * /sensor.bin
+ * /sensors
  * /rssi
  * /netinfo
+ * /history
+ * /history.bin
+ * /config/profile
+ * /sampler
+ * /eventloop
+ * /metrics
+ * /snapshot
  *
  * Custom handler functions must satisfy typedef hndlr_f from
  * picow_http/http.h
@@ -53,5 +72,14 @@ int32_t get_rssi(void);
  * See: https://slimhazard.gitlab.io/picow_http/group__resp.html#ga23afab92dd579b34f1190006b6fa1132
  */
 err_t sensor_handler(struct http *http, void *p);
+err_t sensor_bin_handler(struct http *http, void *p);
+err_t sensors_handler(struct http *http, void *p);
 err_t rssi_handler(struct http *http, void *p);
 err_t netinfo_handler(struct http *http, void *p);
+err_t history_handler(struct http *http, void *p);
+err_t history_bin_handler(struct http *http, void *p);
+err_t profile_handler(struct http *http, void *p);
+err_t sampler_handler(struct http *http, void *p);
+err_t eventloop_handler(struct http *http, void *p);
+err_t metrics_handler(struct http *http, void *p);
+err_t snapshot_handler(struct http *http, void *p);
@@ -0,0 +1,203 @@
+#include <stddef.h>
+#include <string.h>
+
+#include "history.h"
+
+/*
+ * Record encoding, following the key sample of a block:
+ *
+ * Short form, one byte, used when the sample is exactly one second after its
+ * predecessor and all deltas are within range:
+ *
+ *   1 TT HH PPP   T: temperature delta + 2 (-2..1)
+ *                 H: humidity delta + 2 (-2..1)
+ *                 P: pressure delta + 4 (-4..3)
+ *
+ * Long form, used otherwise:
+ *
+ *   0x00, varint(time delta), zigzag varint of the T, H and P deltas
+ */
+#define SHORT_FLAG (0x80)
+
+static inline uint32_t zigzag(int32_t v)
+{
+    return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+}
+
+static inline int32_t unzigzag(uint32_t v)
+{
+    return (int32_t)(v >> 1) ^ -(int32_t)(v & 1);
+}
+
+static uint8_t *put_varint(uint8_t *p, uint32_t v)
+{
+    while (v >= 0x80)
+    {
+        *p++ = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    *p++ = (uint8_t)v;
+
+    return p;
+}
+
+static const uint8_t *get_varint(const uint8_t *p, uint32_t *v)
+{
+    uint32_t val = 0;
+    unsigned shift = 0;
+
+    do
+    {
+        val |= (uint32_t)(*p & 0x7f) << shift;
+        shift += 7;
+    } while (*p++ & 0x80);
+    *v = val;
+
+    return p;
+}
+
+static void quantize(const sample_t *s, history_sample_t *q)
+{
+    q->seq = 0;
+    q->ts = s->ts;
+    q->temperature = s->temperature;
+    q->humidity = sample_humidity_centi(s);
+    q->pressure = sample_pressure_pa(s);
+}
+
+void history_init(history_t *h)
+{
+    memset(h, 0, sizeof *h);
+}
+
+void history_append(history_t *h, const sample_t *s)
+{
+    history_block_t *blk = &h->blocks[h->head % HISTORY_BLOCKS];
+    history_sample_t q;
+    uint8_t *p;
+
+    quantize(s, &q);
+    q.seq = h->last.seq + 1;
+
+    if (h->head == 0 || q.ts < h->last.ts ||
+        blk->len + HISTORY_REC_MAX > (int)sizeof blk->data)
+    {
+        // Start a new block, overwriting the oldest one if the ring is full
+        h->head++;
+        blk = &h->blocks[h->head % HISTORY_BLOCKS];
+        blk->seq = h->head;
+        blk->ts_last = q.ts;
+        blk->key = q;
+        blk->count = 1;
+        blk->len = 0;
+        h->last = q;
+
+        return;
+    }
+
+    uint32_t dt = q.ts - h->last.ts;
+    int32_t d_t = q.temperature - h->last.temperature;
+    int32_t d_h = (int32_t)(q.humidity - h->last.humidity);
+    int32_t d_p = (int32_t)(q.pressure - h->last.pressure);
+
+    p = &blk->data[blk->len];
+    if (dt == 1 && d_t >= -2 && d_t <= 1 && d_h >= -2 && d_h <= 1 &&
+        d_p >= -4 && d_p <= 3)
+    {
+        *p++ = SHORT_FLAG | ((d_t + 2) << 5) | ((d_h + 2) << 3) | (d_p + 4);
+    }
+    else
+    {
+        *p++ = 0;
+        p = put_varint(p, dt);
+        p = put_varint(p, zigzag(d_t));
+        p = put_varint(p, zigzag(d_h));
+        p = put_varint(p, zigzag(d_p));
+    }
+
+    blk->len = p - blk->data;
+    blk->count++;
+    blk->ts_last = q.ts;
+    h->last = q;
+}
+
+bool history_span(const history_t *h, uint32_t *first, uint32_t *last)
+{
+    if (h->head == 0)
+    {
+        return false;
+    }
+
+    *last = h->head;
+    *first = h->head >= HISTORY_BLOCKS ? h->head - HISTORY_BLOCKS + 1 : 1;
+
+    return true;
+}
+
+bool history_copy_block(const history_t *h, uint32_t seq, history_block_t *dst)
+{
+    const history_block_t *blk = &h->blocks[seq % HISTORY_BLOCKS];
+
+    if (seq == 0 || blk->seq != seq)
+    {
+        return false;
+    }
+
+    // Only the used part of the data area needs to be copied
+    memcpy(dst, blk, offsetof(history_block_t, data) + blk->len);
+
+    return true;
+}
+
+void history_iter_init(history_iter_t *it, const history_block_t *blk)
+{
+    it->blk = blk;
+    it->pos = 0;
+    it->idx = 0;
+    it->cur = blk->key;
+}
+
+bool history_iter_next(history_iter_t *it, history_sample_t *s)
+{
+    const history_block_t *blk = it->blk;
+
+    if (it->idx >= blk->count)
+    {
+        return false;
+    }
+
+    if (it->idx > 0)
+    {
+        const uint8_t *p = &blk->data[it->pos];
+
+        it->cur.seq++;
+
+        if (*p & SHORT_FLAG)
+        {
+            it->cur.ts += 1;
+            it->cur.temperature += ((*p >> 5) & 0x3) - 2;
+            it->cur.humidity += ((*p >> 3) & 0x3) - 2;
+            it->cur.pressure += (*p & 0x7) - 4;
+            p++;
+        }
+        else
+        {
+            uint32_t v;
+
+            p = get_varint(p + 1, &v);
+            it->cur.ts += v;
+            p = get_varint(p, &v);
+            it->cur.temperature += unzigzag(v);
+            p = get_varint(p, &v);
+            it->cur.humidity += unzigzag(v);
+            p = get_varint(p, &v);
+            it->cur.pressure += unzigzag(v);
+        }
+        it->pos = p - blk->data;
+    }
+
+    it->idx++;
+    *s = it->cur;
+
+    return true;
+}
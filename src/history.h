@@ -0,0 +1,129 @@
+#ifndef _HISTORY_H
+#define _HISTORY_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "sample.h"
+
+/*
+ * Time series of past samples, held in a statically allocated ring of
+ * fixed-size blocks.
+ *
+ * Each block starts with an absolute key sample, followed by delta-encoded
+ * samples. A sample one second after its predecessor with small changes in
+ * all three values packs into a single byte, otherwise it takes 5 bytes or
+ * more. With the noise of the weather profile (osrs x1, filter off), about
+ * 2 centi-%RH and 3 Pa RMS, most samples take the long form, and the
+ * default of 384 blocks (96 KiB) holds about 6 hours of 1 Hz data; readings
+ * without noise would fill it in about a day. When the ring is full, the
+ * oldest block is overwritten.
+ *
+ * Values are stored quantized to the resolution shown on the dashboard:
+ * temperature in centi-degrees C, humidity in centi-%RH, pressure in Pa.
+ *
+ * Each sample is numbered in the order of appending, from 1. The number is
+ * not stored per record but counted from that of the block's key sample,
+ * so it costs no space. Unlike the timestamp, which has a resolution of a
+ * second, it tells apart samples taken in the same second, and serves as
+ * the cursor of readers that collect the history incrementally.
+ *
+ * The module does no locking. There must be a single writer; readers that
+ * run concurrently with the writer must copy blocks out with
+ * history_copy_block() under a lock shared with history_append().
+ */
+
+/* Number of blocks in the ring. May be overridden at build time. */
+#ifndef HISTORY_BLOCKS
+#define HISTORY_BLOCKS (384)
+#endif
+
+/* Size in bytes of one block, including its header. */
+#define HISTORY_BLOCK_SIZE (256)
+
+/* Longest encoding of a single delta record. */
+#define HISTORY_REC_MAX (21)
+
+/* A decoded history sample. */
+typedef struct history_sample
+{
+    /* Sequence number, from 1 */
+    uint32_t seq;
+    /* Seconds since boot */
+    uint32_t ts;
+    /* centi-degrees C */
+    int32_t temperature;
+    /* centi-%RH */
+    uint32_t humidity;
+    /* Pa */
+    uint32_t pressure;
+} history_sample_t;
+
+typedef struct history_block
+{
+    /* Sequence number of the block, 0 if the block is unused. */
+    uint32_t seq;
+    /* Timestamp of the last sample in the block. */
+    uint32_t ts_last;
+    /* Key sample that starts the block. */
+    history_sample_t key;
+    /* Number of samples in the block, including the key sample. */
+    uint16_t count;
+    /* Number of bytes used in data. */
+    uint16_t len;
+    uint8_t data[HISTORY_BLOCK_SIZE - 2 * sizeof(uint32_t) -
+                 sizeof(history_sample_t) - 2 * sizeof(uint16_t)];
+} history_block_t;
+
+typedef struct history
+{
+    history_block_t blocks[HISTORY_BLOCKS];
+    /* Sequence number of the block that is currently appended to. */
+    uint32_t head;
+    /*
+     * Most recently appended sample, the base for the next delta; its seq
+     * is the number of samples appended.
+     */
+    history_sample_t last;
+} history_t;
+
+/* Record iterator over a single block. */
+typedef struct history_iter
+{
+    const history_block_t *blk;
+    uint16_t pos;
+    uint16_t idx;
+    history_sample_t cur;
+} history_iter_t;
+
+/*
+ * Reset h to the empty state.
+ */
+void history_init(history_t *h);
+
+/*
+ * Append a sample, with the next sequence number. Samples must be appended
+ * in timestamp order.
+ */
+void history_append(history_t *h, const sample_t *s);
+
+/*
+ * Get the range of sequence numbers of blocks currently held in the ring.
+ * Returns false if the history is empty.
+ */
+bool history_span(const history_t *h, uint32_t *first, uint32_t *last);
+
+/*
+ * Copy the block with sequence number seq into dst. Returns false if the
+ * block has been overwritten or has not been written yet.
+ */
+bool history_copy_block(const history_t *h, uint32_t seq,
+                        history_block_t *dst);
+
+/*
+ * Iterate over the samples in a block, oldest first.
+ */
+void history_iter_init(history_iter_t *it, const history_block_t *blk);
+bool history_iter_next(history_iter_t *it, history_sample_t *s);
+
+#endif
@@ -0,0 +1,94 @@
+#include "i2c_arbiter.h"
+#include "seqlock.h"
+
+typedef struct arbiter
+{
+    /* The holder of the last background transfer, NULL if none */
+    const i2c_holder_t *holder;
+    i2c_arbiter_stats_t stats;
+    seqlock_t lock;
+} arbiter_t;
+
+/* One per bus */
+static arbiter_t arbiters[2];
+
+static bool holder_busy(arbiter_t *a)
+{
+    if (a->holder == NULL)
+    {
+        return false;
+    }
+    if (!a->holder->busy(a->holder->priv))
+    {
+        a->holder = NULL;
+        return false;
+    }
+
+    return true;
+}
+
+bool i2c_arbiter_try(i2c_inst_t *i2c, const i2c_holder_t *holder)
+{
+    arbiter_t *a = &arbiters[i2c_hw_index(i2c)];
+
+    if (holder_busy(a))
+    {
+        return false;
+    }
+    a->holder = holder;
+
+    return true;
+}
+
+void i2c_arbiter_acquire(i2c_inst_t *i2c)
+{
+    arbiter_t *a = &arbiters[i2c_hw_index(i2c)];
+
+    if (!holder_busy(a))
+    {
+        return;
+    }
+
+    absolute_time_t from = get_absolute_time();
+    absolute_time_t deadline = delayed_by_us(from, I2C_ARBITER_WAIT_US);
+    bool aborted = false;
+
+    while (holder_busy(a))
+    {
+        if (absolute_time_diff_us(deadline, get_absolute_time()) >= 0)
+        {
+            a->holder->abort(a->holder->priv);
+            a->holder = NULL;
+            aborted = true;
+            break;
+        }
+        tight_loop_contents();
+    }
+
+    uint32_t waited = (uint32_t)absolute_time_diff_us(from,
+                                                      get_absolute_time());
+
+    seqlock_write_begin(&a->lock);
+    a->stats.waits++;
+    if (aborted)
+    {
+        a->stats.aborts++;
+    }
+    if (waited > a->stats.wait_max_us)
+    {
+        a->stats.wait_max_us = waited;
+    }
+    seqlock_write_end(&a->lock);
+}
+
+void i2c_arbiter_stats(i2c_inst_t *i2c, i2c_arbiter_stats_t *s)
+{
+    arbiter_t *a = &arbiters[i2c_hw_index(i2c)];
+    uint32_t seq;
+
+    do
+    {
+        seq = seqlock_read_begin(&a->lock);
+        *s = a->stats;
+    } while (seqlock_read_retry(&a->lock, seq));
+}
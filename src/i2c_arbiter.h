@@ -0,0 +1,65 @@
+#ifndef _I2C_ARBITER_H
+#define _I2C_ARBITER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "pico/stdlib.h"
+#include "hardware/i2c.h"
+
+/*
+ * Arbitration of an i2c bus between the blocking transfers of the sensors
+ * and background transfers, such as a display frame sent by dma.
+ *
+ * A background transfer holds the bus until it has completed; its holder
+ * provides functions to poll for completion and to abort the transfer. A
+ * new background transfer may only start with i2c_arbiter_try(), which
+ * fails while the previous one is in progress. Blocking transfers take
+ * priority: i2c_arbiter_acquire() waits for the holder for a bounded time,
+ * then aborts its transfer, so that a slow background device cannot delay
+ * a sample by more than that.
+ *
+ * All transfers are started on core1, so no lock is needed. The statistics
+ * may be read on either core.
+ */
+
+/* Longest wait in us for a background transfer before it is aborted. */
+#define I2C_ARBITER_WAIT_US (2000)
+
+typedef struct i2c_holder
+{
+    /* true while the transfer is in progress */
+    bool (*busy)(void *priv);
+    /* Stop the transfer, and leave the bus idle */
+    void (*abort)(void *priv);
+    void *priv;
+} i2c_holder_t;
+
+typedef struct i2c_arbiter_stats
+{
+    /* Blocking transfers that had to wait for a background transfer */
+    uint32_t waits;
+    /* Background transfers aborted after I2C_ARBITER_WAIT_US */
+    uint32_t aborts;
+    /* Longest wait in us */
+    uint32_t wait_max_us;
+} i2c_arbiter_stats_t;
+
+/*
+ * Claim the bus for a background transfer by holder, which must remain
+ * valid. Returns false if the previous background transfer is still in
+ * progress; no transfer may be started then.
+ */
+bool i2c_arbiter_try(i2c_inst_t *i2c, const i2c_holder_t *holder);
+
+/*
+ * Claim the bus for a blocking transfer: wait for a background transfer in
+ * progress to complete, and abort it if it does not within
+ * I2C_ARBITER_WAIT_US. The bus is free on return.
+ */
+void i2c_arbiter_acquire(i2c_inst_t *i2c);
+
+/* Copy the statistics of a bus. */
+void i2c_arbiter_stats(i2c_inst_t *i2c, i2c_arbiter_stats_t *stats);
+
+#endif
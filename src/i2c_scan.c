@@ -0,0 +1,188 @@
+#include <string.h>
+
+#include "pico/stdlib.h"
+
+#include "i2c_scan.h"
+
+/* BME280 chip id register, and the ids it holds on the BME280 and BMP280 */
+#define REG_CHIP_ID (0xD0)
+#define BME280_CHIP_ID (0x60)
+#define BMP280_CHIP_ID_MIN (0x56)
+#define BMP280_CHIP_ID_MAX (0x58)
+
+#define CACHE_MAGIC (0x5ca4b0e7)
+
+typedef struct scan_cache
+{
+    uint32_t magic;
+    i2c_scan_t scan;
+    uint32_t sum;
+} scan_cache_t;
+
+/* One entry per bus, not zeroed at boot (see i2c_scan.h) */
+static scan_cache_t __uninitialized_ram(cache)[2];
+
+/* FNV-1a */
+static uint32_t checksum(const void *p, size_t len)
+{
+    const uint8_t *b = p;
+    uint32_t h = 2166136261u;
+
+    while (len--)
+    {
+        h ^= *b++;
+        h *= 16777619u;
+    }
+
+    return h;
+}
+
+static bool reserved_addr(uint8_t addr)
+{
+    return (addr & 0x78) == 0 || (addr & 0x78) == 0x78;
+}
+
+static void set_present(i2c_scan_t *scan, uint8_t addr)
+{
+    scan->present[addr / 32] |= 1u << (addr % 32);
+    scan->count++;
+}
+
+/* Returns 1 if addr acknowledged, or a PICO_ERROR code. */
+static int probe(i2c_inst_t *i2c, uint8_t addr)
+{
+    uint8_t rx;
+
+    return i2c_read_timeout_us(i2c, addr, &rx, 1, false, I2C_SCAN_TIMEOUT_US);
+}
+
+static uint8_t read_chip_id(i2c_inst_t *i2c, uint8_t addr)
+{
+    const uint8_t reg = REG_CHIP_ID;
+    uint8_t id;
+
+    if (i2c_write_timeout_us(i2c, addr, &reg, 1, true,
+                             I2C_SCAN_TIMEOUT_US) != 1 ||
+        i2c_read_timeout_us(i2c, addr, &id, 1, false,
+                            I2C_SCAN_TIMEOUT_US) != 1)
+    {
+        return 0;
+    }
+
+    return id;
+}
+
+/*
+ * All addresses that responded before the reset must still respond. An
+ * empty result is not reused, the scan costs little if nothing answers.
+ */
+static bool cache_valid(i2c_inst_t *i2c, const scan_cache_t *c)
+{
+    if (c->magic != CACHE_MAGIC ||
+        c->sum != checksum(&c->scan, sizeof c->scan) || c->scan.count == 0)
+    {
+        return false;
+    }
+
+    for (uint8_t addr = 0; addr < 128; addr++)
+    {
+        if (i2c_scan_present(&c->scan, addr) && probe(i2c, addr) != 1)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+int i2c_scan(i2c_inst_t *i2c, i2c_scan_t *scan)
+{
+    scan_cache_t *c = &cache[i2c_hw_index(i2c)];
+    unsigned timeouts = 0;
+
+    if (cache_valid(i2c, c))
+    {
+        *scan = c->scan;
+        scan->cached = true;
+        return PICO_OK;
+    }
+    c->magic = 0;
+
+    // Zero the padding too, since it is part of the checksum
+    memset(scan, 0, sizeof *scan);
+    for (uint8_t addr = 0; addr < 128; addr++)
+    {
+        int ret;
+
+        if (reserved_addr(addr))
+        {
+            continue;
+        }
+
+        if ((ret = probe(i2c, addr)) == 1)
+        {
+            set_present(scan, addr);
+        }
+        else if (ret == PICO_ERROR_TIMEOUT &&
+                 ++timeouts >= I2C_SCAN_MAX_TIMEOUTS)
+        {
+            return PICO_ERROR_TIMEOUT;
+        }
+    }
+
+    for (unsigned i = 0; i < count_of(scan->chip_id); i++)
+    {
+        uint8_t addr = I2C_SCAN_BME280_ADDR + i;
+
+        if (i2c_scan_present(scan, addr))
+        {
+            scan->chip_id[i] = read_chip_id(i2c, addr);
+        }
+    }
+
+    c->scan = *scan;
+    c->sum = checksum(&c->scan, sizeof c->scan);
+    c->magic = CACHE_MAGIC;
+
+    return PICO_OK;
+}
+
+bool i2c_scan_present(const i2c_scan_t *scan, uint8_t addr)
+{
+    return addr < 128 && (scan->present[addr / 32] & (1u << (addr % 32)));
+}
+
+i2c_dev_type_t i2c_scan_type(const i2c_scan_t *scan, uint8_t addr)
+{
+    uint8_t id;
+
+    if (!i2c_scan_present(scan, addr))
+    {
+        return I2C_DEV_NONE;
+    }
+    if (addr < I2C_SCAN_BME280_ADDR ||
+        addr >= I2C_SCAN_BME280_ADDR + count_of(scan->chip_id))
+    {
+        return I2C_DEV_UNKNOWN;
+    }
+
+    id = scan->chip_id[addr - I2C_SCAN_BME280_ADDR];
+    if (id == BME280_CHIP_ID)
+    {
+        return I2C_DEV_BME280;
+    }
+    if (id >= BMP280_CHIP_ID_MIN && id <= BMP280_CHIP_ID_MAX)
+    {
+        return I2C_DEV_BMP280;
+    }
+
+    return I2C_DEV_UNKNOWN;
+}
+
+void i2c_scan_invalidate(void)
+{
+    for (unsigned i = 0; i < count_of(cache); i++)
+    {
+        cache[i].magic = 0;
+    }
+}
@@ -0,0 +1,73 @@
+#ifndef _I2C_SCAN_H
+#define _I2C_SCAN_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "hardware/i2c.h"
+
+/*
+ * Scan of an i2c bus for responding devices.
+ *
+ * Each address that is not reserved is probed with a one-byte read. The
+ * probe is bounded by I2C_SCAN_TIMEOUT_US, so that a stuck bus (SDA held
+ * low, or missing pull-ups) fails the scan instead of hanging boot. The
+ * devices at the two BME280 addresses are classified by their chip id
+ * (register 0xD0). Other devices are not written to, since the meaning of
+ * register addresses differs between devices.
+ *
+ * Results are kept in RAM that is not initialized at boot. They survive
+ * resets that do not lose power, such as a watchdog reboot or a brownout
+ * that the SRAM rides out, and a checksum rejects a corrupted copy. After
+ * such a warm reset only the addresses that responded before are probed
+ * again. If all of them still respond, the cached result is used. A device
+ * added while the board stays powered is found after the next power-on
+ * reset, or after i2c_scan_invalidate().
+ */
+
+/* Longest wait in us for a probe, far more than a byte takes at 100 kHz. */
+#define I2C_SCAN_TIMEOUT_US (1000)
+
+/* A scan is abandoned after this many probes have timed out. */
+#define I2C_SCAN_MAX_TIMEOUTS (2)
+
+/* First of the two addresses that a BME280 or BMP280 can have. */
+#define I2C_SCAN_BME280_ADDR (0x76)
+
+typedef enum i2c_dev_type
+{
+    I2C_DEV_NONE = 0,
+    I2C_DEV_UNKNOWN,
+    I2C_DEV_BMP280,
+    I2C_DEV_BME280,
+} i2c_dev_type_t;
+
+typedef struct i2c_scan
+{
+    /* Bit (addr % 32) of present[addr / 32] is set if addr responded. */
+    uint32_t present[4];
+    /* Chip ids at 0x76 and 0x77, 0 if absent or not readable. */
+    uint8_t chip_id[2];
+    /* Number of responding addresses. */
+    uint8_t count;
+    /* true if the result was taken from before the last reset. */
+    bool cached;
+} i2c_scan_t;
+
+/*
+ * Scan the bus, which must have been initialized. Returns PICO_OK, or
+ * PICO_ERROR_TIMEOUT if the bus appears to be stuck, in which case nothing
+ * is cached and scan holds the devices found until then.
+ */
+int i2c_scan(i2c_inst_t *i2c, i2c_scan_t *scan);
+
+/* Whether addr responded in the scan. */
+bool i2c_scan_present(const i2c_scan_t *scan, uint8_t addr);
+
+/* Classify the device at addr, which is I2C_DEV_UNKNOWN for most addresses. */
+i2c_dev_type_t i2c_scan_type(const i2c_scan_t *scan, uint8_t addr);
+
+/* Discard the cached results, so that the next scans probe all addresses. */
+void i2c_scan_invalidate(void);
+
+#endif
@@ -0,0 +1,32 @@
+#include <string.h>
+
+#include "json.h"
+#include "utils.h"
+
+// Append a string literal
+#define PUT_LTRL(p, s) (memcpy((p), (s), sizeof(s) - 1), (p) + sizeof(s) - 1)
+
+size_t json_sensor(char *dst, const sample_t *s)
+{
+    size_t len;
+
+    dst[0] = '{';
+    len = 1 + json_sensor_fields(dst + 1, s);
+    dst[len++] = '}';
+
+    return len;
+}
+
+size_t json_sensor_fields(char *dst, const sample_t *s)
+{
+    char *p = dst;
+
+    p = PUT_LTRL(p, "\"temperature\":");
+    p = fmt_centi(p, s->temperature);
+    p = PUT_LTRL(p, ",\"humidity\":");
+    p = fmt_centi(p, (int32_t)sample_humidity_centi(s));
+    p = PUT_LTRL(p, ",\"pressure\":");
+    p = fmt_centi(p, (int32_t)sample_pressure_pa(s));
+
+    return p - dst;
+}
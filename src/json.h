@@ -0,0 +1,29 @@
+#ifndef _JSON_H
+#define _JSON_H
+
+#include <stddef.h>
+
+#include "sample.h"
+
+// Longest body produced by json_sensor().
+#define JSON_SENSOR_MAX                                         \
+    (sizeof("{\"temperature\":-21474836.48,\"humidity\":42949672.95," \
+            "\"pressure\":42949672.95}") - 1)
+
+// Format the /sensor response body for a sample into dst, which must hold at
+// least JSON_SENSOR_MAX bytes. Returns the length of the body, which is not
+// NUL-terminated.
+//
+// The values are formatted from the driver's fixed-point representation
+// with two decimals, so neither malloc() nor floating point printf() is
+// needed.
+size_t json_sensor(char *dst, const sample_t *s);
+
+// Longest output of json_sensor_fields().
+#define JSON_SENSOR_FIELDS_MAX (JSON_SENSOR_MAX - 2)
+
+// Format the members of the json_sensor() object, without the braces, so
+// that they can be combined with other members.
+size_t json_sensor_fields(char *dst, const sample_t *s);
+
+#endif
@@ -0,0 +1,51 @@
+#ifndef _LATENCY_H
+#define _LATENCY_H
+
+#include <stdint.h>
+
+/*
+ * Histogram of latencies in us, with buckets on a log2 scale.
+ *
+ * Bucket i counts latencies of at most 2^i us, and greater than the bound
+ * of bucket i - 1; the last bucket counts everything beyond 2^(N-2) us.
+ * Adding a latency is a count leading zeros and a few stores, cheap enough
+ * for every request.
+ *
+ * A histogram has a single writer; readers must not run concurrently with
+ * it, or they may see a count without its sum.
+ */
+
+#define LATENCY_BUCKETS (20)
+
+typedef struct latency_hist
+{
+    uint32_t buckets[LATENCY_BUCKETS];
+    uint32_t count;
+    uint32_t max_us;
+    uint64_t sum_us;
+} latency_hist_t;
+
+/* Upper bound in us of bucket i, except for the last one. */
+static inline uint32_t latency_bucket_le(unsigned i)
+{
+    return 1u << i;
+}
+
+static inline void latency_add(latency_hist_t *h, uint32_t us)
+{
+    unsigned i = us <= 1 ? 0 : 32 - __builtin_clz(us - 1);
+
+    if (i >= LATENCY_BUCKETS)
+    {
+        i = LATENCY_BUCKETS - 1;
+    }
+    h->buckets[i]++;
+    h->count++;
+    h->sum_us += us;
+    if (us > h->max_us)
+    {
+        h->max_us = us;
+    }
+}
+
+#endif
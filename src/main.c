@@ -5,40 +5,96 @@
 #include "pico/stdlib.h"
 #include "pico/multicore.h"
 #include "pico/cyw43_arch.h"
+#include "pico/util/queue.h"
 
 #include <bme280.h>
 #include <ssd1306.h>
 
 #include "picow_http/http.h"
+#include "acquire.h"
+#include "display.h"
 #include "handlers.h"
+#include "events.h"
+#include "latency.h"
+#include "metrics.h"
+#include "profiles.h"
+#include "sensors.h"
 
 #if PICO_CYW43_ARCH_POLL
 #define POLL_SLEEP_MS (1)
 #endif
 
+/*
+ * Pins and baud rate of i2c1, for sensors in addition to those on
+ * i2c_default. The bus is slower, since probes may be on long cables.
+ */
+#ifndef SENSORS_I2C1_SDA_PIN
+#define SENSORS_I2C1_SDA_PIN (6)
+#endif
+#ifndef SENSORS_I2C1_SCL_PIN
+#define SENSORS_I2C1_SCL_PIN (7)
+#endif
+#define SENSORS_I2C1_BAUD (400 * 1000)
+
+/*
+ * Least interval between display frames in ms. Samples that arrive faster
+ * are not all shown.
+ */
+#define DISPLAY_INTVL_MS (250)
+
 /*
  * Interval between rssi updates in ms (for a repeating_timer).
  */
 #define RSSI_INTVL_MS (5 * 1000)
 /*
- * In threadsafe background mode, rssi updates are run from core1, and
- * require a wifi link.
- * linkup is true when the TCP/IP link is up, so that core1 knows that the
- * periodic rssi updates may begin.
+ * The most recent rssi value for our access point, updated by the loop on
+ * core0 in both network stack modes. Aligned 32-bit loads and stores are
+ * atomic, so no lock is needed.
  */
-static volatile bool linkup = false;
-/* The most recent rssi value for our access point */
 static volatile int32_t rssi = INT32_MAX;
 /* Struct for network information, passed to the /netinfo handler */
 static netinfo_t netinfo;
 
-/* Critical sections to protect access to shared data */
-static critical_section_t temp_critsec, rssi_critsec, linkup_critsec;
-
 /* repeating_timer object for rssi updates */
 static repeating_timer_t rssi_timer;
 
-static volatile bool rssi_ready = false;
+/*
+ * Work for the loop on core0. The rssi timer and core1 post items to the
+ * queue, and the loop runs them in order. In background mode the loop
+ * sleeps in the queue until an item is posted; in poll mode items wait for
+ * the next poll of the driver, at most POLL_SLEEP_MS.
+ * If the queue is full, the item is dropped: the rssi is read again at the
+ * next tick, and the next sample notification publishes the latest sample.
+ */
+typedef enum
+{
+    WORK_RSSI,
+    WORK_SAMPLE,
+    WORK_KINDS,
+} work_kind_t;
+
+typedef struct
+{
+    uint32_t kind;
+    /* time_us_32() when the item was posted */
+    uint32_t posted_us;
+} work_t;
+
+#define WORK_QUEUE_LEN (8)
+
+static queue_t work_queue;
+
+/*
+ * Items dropped because the queue was full, by kind. Each kind has a single
+ * poster, so the counters need no lock.
+ */
+static volatile uint32_t work_dropped[WORK_KINDS];
+
+/*
+ * Time from posting to completion of the work items. Updated in lwIP
+ * context, so that handlers never see it half-written in background mode.
+ */
+static latency_hist_t work_latency;
 
 /*
  * See the comment in handler.h
@@ -46,47 +102,64 @@ static volatile bool rssi_ready = false;
 int32_t
 get_rssi(void)
 {
-    int32_t val;
-    critical_section_enter_blocking(&rssi_critsec);
-    val = rssi;
-    critical_section_exit(&rssi_critsec);
-    return val;
+    return rssi;
 }
 
 /*
- * Callback for the repeating_timer used in background mode, to update the
- * AP rssi.
+ * See the comment in handler.h; must be called in lwIP context.
  */
-static bool
-__time_critical_func(rssi_update)(repeating_timer_t *rt)
+void get_loop_stats(loop_stats_t *stats)
+{
+#if PICO_CYW43_ARCH_POLL
+    stats->mode = "poll";
+#else
+    stats->mode = "background";
+#endif
+    stats->dropped = work_dropped[WORK_RSSI] + work_dropped[WORK_SAMPLE];
+    stats->latency = work_latency;
+}
+
+static void
+__time_critical_func(post_work)(work_kind_t kind)
+{
+    work_t w = {.kind = kind, .posted_us = time_us_32()};
+
+    if (!queue_try_add(&work_queue, &w))
+        work_dropped[kind]++;
+}
+
+/*
+ * Update the AP rssi.
+ */
+static void rssi_update(void)
 {
     int32_t val;
-    (void)rt;
 
     if (cyw43_wifi_get_rssi(&cyw43_state, &val) != 0)
         val = INT32_MAX;
 
-    critical_section_enter_blocking(&rssi_critsec);
     rssi = val;
-    critical_section_exit(&rssi_critsec);
-    return true;
 }
 
+/*
+ * Callback for the repeating_timer for rssi updates, which are run by the
+ * loop on core0.
+ */
 static bool __time_critical_func(rssi_poll)(repeating_timer_t *rt)
 {
     (void)rt;
-    rssi_ready = true;
+    post_work(WORK_RSSI);
     return true;
 }
 
 static void start_rssi_poll(repeating_timer_callback_t cb)
 {
     /* Get the initial rssi value. */
-    (void)rssi_update(NULL);
+    rssi_update();
 
     /*
-     * Since this may be core1, we cannot use the default alarm pool.
-     * Panics on failure.
+     * The callback only posts to the work queue, which the loop on core0
+     * runs. Panics on failure.
      */
     alarm_pool_t *pool = alarm_pool_create_with_unused_hardware_alarm(1);
     AN(pool);
@@ -95,6 +168,31 @@ static void start_rssi_poll(repeating_timer_callback_t cb)
         HTTP_LOG_ERROR("Failed to start timer to poll rssi");
 }
 
+/*
+ * Run a work item on core0, and record its latency.
+ */
+static void run_work(const work_t *w)
+{
+    sample_t sample;
+
+    switch (w->kind)
+    {
+    case WORK_RSSI:
+        rssi_update();
+        cyw43_arch_lwip_begin();
+        break;
+    case WORK_SAMPLE:
+        cyw43_arch_lwip_begin();
+        if (sensors_get(0, &sample))
+            events_publish(&sample);
+        break;
+    default:
+        return;
+    }
+    latency_add(&work_latency, time_us_32() - w->posted_us);
+    cyw43_arch_lwip_end();
+}
+
 void core1_main();
 
 // Init all
@@ -103,16 +201,6 @@ void init();
 // Display instance
 ssd1306_t display;
 
-// BME280 sensor instance
-bme280_t sensor;
-
-// Sensor values
-volatile float _temperature;
-volatile float _humidity;
-volatile float _pressure;
-
-static critical_section_t sensor_lock;
-
 int main()
 {
     struct server *srv;
@@ -125,9 +213,8 @@ int main()
     printf("Core 0: initialising...\n");
 
     stdio_init_all();
-    critical_section_init(&sensor_lock);
-    critical_section_init(&linkup_critsec);
-    critical_section_init(&rssi_critsec);
+    queue_init(&work_queue, sizeof(work_t), WORK_QUEUE_LEN);
+    acquire_init();
 
     /*
      * Launch core1. The code preceding multicore_launch_core1()
@@ -180,7 +267,7 @@ int main()
         } while (link_status != CYW43_LINK_UP);
     } while (link_status != CYW43_LINK_UP);
 
-    /* In poll mode, start the timer on core0. */
+    /* Start the rssi timer on core0. */
     start_rssi_poll(rssi_poll);
 
     HTTP_LOG_INFO("Connected to " WIFI_SSID);
@@ -207,12 +294,16 @@ int main()
 
     /*
      * Before the http server starts, register the custom handlers for
-     * the URL paths /netinfo, /sensor, /rssi. Each of them is
-     * registered for the methods GET and HEAD.
+     * the URL paths /netinfo, /sensor, /sensor.bin, /sensors, /rssi,
+     * /history, /history.bin, /sampler, /eventloop, /metrics, /snapshot
+     * and /config/profile. Each of them is registered
+     * for the methods GET and HEAD, /config/profile also for POST. They
+     * are registered with metrics_register(), so that their requests are
+     * counted and timed for /metrics (see metrics.h).
      *
-     * For /netinfo, we pass in the address of the netinfo object that
-     * was just initialized. The other handlers do not use private
-     * data, so we pass in NULL.
+     * For /netinfo and /snapshot, we pass in the address of the netinfo
+     * object that was just initialized. The other handlers do not use
+     * private data, so we pass in NULL.
      *
      * Custom handlers can be registered after the server starts; for
      * any requests for a path with an unregistered handler, the
@@ -222,24 +313,82 @@ int main()
      *
      * See: https://slimhazard.gitlab.io/picow_http/group__resp.html#gac4ee42ee6a8559778bb486dcb6253cfe
      */
-    if ((err = register_hndlr_methods(&cfg, "/netinfo", netinfo_handler,
-                                      HTTP_METHODS_GET_HEAD, &netinfo)) != ERR_OK)
+    if ((err = metrics_register(&cfg, "/netinfo", netinfo_handler,
+                                HTTP_METHODS_GET_HEAD, &netinfo)) != ERR_OK)
     {
         HTTP_LOG_ERROR("Register /netinfo: %d", err);
         return -1;
     }
-    if ((err = register_hndlr_methods(&cfg, "/sensor", sensor_handler,
-                                      HTTP_METHODS_GET_HEAD, NULL)) != ERR_OK)
+    if ((err = metrics_register(&cfg, "/sensor", sensor_handler,
+                                HTTP_METHODS_GET_HEAD, NULL)) != ERR_OK)
     {
         HTTP_LOG_ERROR("Register /temp: %d", err);
         return -1;
     }
-    if ((err = register_hndlr_methods(&cfg, "/rssi", rssi_handler,
-                                      HTTP_METHODS_GET_HEAD, NULL)) != ERR_OK)
+    if ((err = metrics_register(&cfg, "/sensor.bin", sensor_bin_handler,
+                                HTTP_METHODS_GET_HEAD, NULL)) != ERR_OK)
+    {
+        HTTP_LOG_ERROR("Register /sensor.bin: %d", err);
+        return -1;
+    }
+    if ((err = metrics_register(&cfg, "/sensors", sensors_handler,
+                                HTTP_METHODS_GET_HEAD, NULL)) != ERR_OK)
+    {
+        HTTP_LOG_ERROR("Register /sensors: %d", err);
+        return -1;
+    }
+    if ((err = metrics_register(&cfg, "/sampler", sampler_handler,
+                                HTTP_METHODS_GET_HEAD, NULL)) != ERR_OK)
+    {
+        HTTP_LOG_ERROR("Register /sampler: %d", err);
+        return -1;
+    }
+    if ((err = metrics_register(&cfg, "/eventloop", eventloop_handler,
+                                HTTP_METHODS_GET_HEAD, NULL)) != ERR_OK)
+    {
+        HTTP_LOG_ERROR("Register /eventloop: %d", err);
+        return -1;
+    }
+    if ((err = metrics_register(&cfg, "/config/profile",
+                                profile_handler,
+                                HTTP_METHODS_GET_HEAD |
+                                (1U << HTTP_METHOD_POST),
+                                NULL)) != ERR_OK)
+    {
+        HTTP_LOG_ERROR("Register /config/profile: %d", err);
+        return -1;
+    }
+    if ((err = metrics_register(&cfg, "/metrics", metrics_handler,
+                                HTTP_METHODS_GET_HEAD, NULL)) != ERR_OK)
+    {
+        HTTP_LOG_ERROR("Register /metrics: %d", err);
+        return -1;
+    }
+    if ((err = metrics_register(&cfg, "/rssi", rssi_handler,
+                                HTTP_METHODS_GET_HEAD, NULL)) != ERR_OK)
     {
         HTTP_LOG_ERROR("Register /rssi: %d", err);
         return -1;
     }
+    if ((err = metrics_register(&cfg, "/history", history_handler,
+                                HTTP_METHODS_GET_HEAD, NULL)) != ERR_OK)
+    {
+        HTTP_LOG_ERROR("Register /history: %d", err);
+        return -1;
+    }
+    if ((err = metrics_register(&cfg, "/history.bin", history_bin_handler,
+                                HTTP_METHODS_GET_HEAD, NULL)) != ERR_OK)
+    {
+        HTTP_LOG_ERROR("Register /history.bin: %d", err);
+        return -1;
+    }
+
+    if ((err = metrics_register(&cfg, "/snapshot", snapshot_handler,
+                                HTTP_METHODS_GET_HEAD, &netinfo)) != ERR_OK)
+    {
+        HTTP_LOG_ERROR("Register /snapshot: %d", err);
+        return -1;
+    }
 
     /*
      * Start the server, and turn on the onboard LED when it's
@@ -252,20 +401,32 @@ int main()
     HTTP_LOG_INFO("http started");
     cyw43_arch_gpio_put(CYW43_WL_GPIO_LED_PIN, true);
 
+    /* The event stream is served on its own port, see events.h. */
+    cyw43_arch_lwip_begin();
+    err = events_init();
+    cyw43_arch_lwip_end();
+    if (err != ERR_OK)
+        HTTP_LOG_ERROR("events_init: %d", err);
+
     /*
-     * After the server starts, in poll mode we must periodically call
-     * cyw43_arch_poll(). Check if the timer has set the boolean to
-     * indicate that timeout for rssi updates has expired.
+     * After the server starts, run the work posted by the rssi timer and
+     * by core1. In poll mode we must also periodically call
+     * cyw43_arch_poll(); in background mode the driver and lwIP run in
+     * interrupts, and the loop sleeps until work is posted.
      */
     for (;;)
     {
+        work_t w;
+
+#if PICO_CYW43_ARCH_POLL
         cyw43_arch_poll();
-        if (rssi_ready)
-        {
-            rssi_ready = false;
-            (void)rssi_update(NULL);
-        }
+        while (queue_try_remove(&work_queue, &w))
+            run_work(&w);
         cyw43_arch_wait_for_work_until(make_timeout_time_ms(POLL_SLEEP_MS));
+#else
+        queue_remove_blocking(&work_queue, &w);
+        run_work(&w);
+#endif
     }
 
     return 0;
@@ -280,80 +441,39 @@ void init()
     gpio_pull_up(PICO_DEFAULT_I2C_SDA_PIN);
     gpio_pull_up(PICO_DEFAULT_I2C_SCL_PIN);
 
+    // Setup i2c1 for further sensors
+    i2c_init(i2c1, SENSORS_I2C1_BAUD);
+    gpio_set_function(SENSORS_I2C1_SDA_PIN, GPIO_FUNC_I2C);
+    gpio_set_function(SENSORS_I2C1_SCL_PIN, GPIO_FUNC_I2C);
+    gpio_pull_up(SENSORS_I2C1_SDA_PIN);
+    gpio_pull_up(SENSORS_I2C1_SCL_PIN);
+
     // Setup display (128x32)
     const uint8_t displayAddress = 0x3C;
     ssd1306_init(&display, 128, 32, displayAddress, i2c_default);
+    display_init(&display, DISPLAY_INTVL_MS);
 
-    // find i2c devices addresses
-    uint8_t *found_addrs = get_bme280_addrs(i2c_default);
-    uint8_t ssd1306_addr = found_addrs[1];
-    uint8_t bme280_addr = found_addrs[2];
+    unsigned found = sensors_init(profiles_active());
 
-    ASSERT(ssd1306_addr == 0x3C, "Error: failed to initialise ssd1306 display");
-    ASSERT(bme280_addr == 0x76, "Error: failed to initialise bme280 sensor");
-
-    int8_t res = bme280_init(i2c_default,
-                             bme280_addr,
-                             &sensor,
-                             BME280_NORMAL_MODE,
-                             BME280_FILTER_OFF,
-                             BME280_T_OVERSAMPLE_1,
-                             BME280_H_OVERSAMPLE_1,
-                             BME280_P_OVERSAMPLE_1);
+    ASSERT(found > 0, "Error: failed to initialise bme280 sensor");
+}
 
-    ASSERT(res == BME280_OK, "Error: failed to initialise sensor");
+/*
+ * core0 pushes each new sample to event subscribers.
+ */
+static void sample_published(const sample_t *s)
+{
+    (void)s;
+    post_work(WORK_SAMPLE);
 }
 
 void core1_main()
 {
+    const acquire_hooks_t hooks = {.published = sample_published};
+
     init();
 
+    acquire_start();
     for (;;)
-    {
-        sleep_ms(1000);
-        // Read sensor data
-        int8_t res = bme280_normal_read(&sensor);
-        if (res != BME280_OK)
-        {
-            printf("Core1: Temperature reading failed\n");
-        }
-
-        float t = sensor.temperature / 100.0f;
-        float h = sensor.humidity / 1024.f;
-        float p = sensor.pressure / 256.f / 100.f;
-
-        critical_section_enter_blocking(&sensor_lock);
-        _temperature = t;
-        _humidity = h;
-        _pressure = p;
-        critical_section_exit(&sensor_lock);
-
-        char *tStr = new_string("%.2f C", t);
-        char *hStr = new_string("%.2f %%RH", h);
-        char *pStr = new_string("%.2f hPa", p);
-
-        ssd1306_clear(&display);
-
-        ssd1306_draw_string(&display, 4, 0, 1, tStr);
-        ssd1306_draw_string(&display, 4, 8, 1, hStr);
-        ssd1306_draw_string(&display, 4, 16, 1, pStr);
-
-        ssd1306_show(&display);
-
-        free(tStr);
-        free(hStr);
-        free(pStr);
-    }
-}
-
-sensor_data_t get_sensor_data(void)
-{
-    sensor_data_t data;
-    critical_section_enter_blocking(&sensor_lock);
-    data.temperature = _temperature;
-    data.humidity = _humidity;
-    data.pressure = _pressure;
-    critical_section_exit(&sensor_lock);
-
-    return data;
+        acquire_step(&hooks);
 }
@@ -0,0 +1,71 @@
+#include "pico/stdlib.h"
+
+#include "metrics.h"
+
+static route_metrics_t routes[METRICS_MAX_ROUTES];
+static unsigned nroutes = 0;
+
+/* Set by metrics_resp_err() during a handler call */
+static bool failed;
+
+static err_t metrics_hndlr(struct http *http, void *p)
+{
+    route_metrics_t *route = p;
+    uint64_t start;
+    err_t err;
+
+    failed = false;
+    start = time_us_64();
+    err = route->hndlr(http, route->priv);
+    latency_add(&route->latency, (uint32_t)(time_us_64() - start));
+
+    route->requests++;
+    if (failed || err != ERR_OK)
+    {
+        route->errors++;
+    }
+
+    return err;
+}
+
+err_t metrics_register(struct server_cfg *cfg, const char *path,
+                       hndlr_f hndlr, unsigned methods, void *priv)
+{
+    route_metrics_t *route;
+    err_t err;
+
+    if (nroutes == METRICS_MAX_ROUTES)
+    {
+        return ERR_MEM;
+    }
+
+    route = &routes[nroutes];
+    route->path = path;
+    route->hndlr = hndlr;
+    route->priv = priv;
+    if ((err = register_hndlr_methods(cfg, path, metrics_hndlr, methods,
+                                      route)) != ERR_OK)
+    {
+        return err;
+    }
+    nroutes++;
+
+    return ERR_OK;
+}
+
+err_t metrics_resp_err(struct http *http, enum http_status_t status)
+{
+    failed = true;
+
+    return http_resp_err(http, status);
+}
+
+unsigned metrics_routes(void)
+{
+    return nroutes;
+}
+
+const route_metrics_t *metrics_route(unsigned i)
+{
+    return i < nroutes ? &routes[i] : NULL;
+}
@@ -0,0 +1,62 @@
+#ifndef _METRICS_H
+#define _METRICS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "picow_http/http.h"
+
+#include "latency.h"
+
+/*
+ * Per-route request metrics.
+ *
+ * Handlers are registered with metrics_register() instead of
+ * register_hndlr_methods(). The server then calls a wrapper, which times
+ * the handler with time_us_64() and counts the request, and whether it
+ * failed: the handler returned an error, or sent an error response with
+ * metrics_resp_err(). Handlers use metrics_resp_err() in place of
+ * http_resp_err() for that reason.
+ *
+ * The time is that of the handler call, which includes formatting the
+ * response and queueing it for lwIP, but not its transmission.
+ *
+ * All functions must be called in lwIP context, as handlers are, so that
+ * no lock is needed.
+ */
+
+/* Most routes that can be registered */
+#define METRICS_MAX_ROUTES (16)
+
+typedef struct route_metrics
+{
+    const char *path;
+    hndlr_f hndlr;
+    void *priv;
+    /* Requests handled, and those that failed */
+    uint32_t requests;
+    uint32_t errors;
+    /* Time in the handler */
+    latency_hist_t latency;
+} route_metrics_t;
+
+/*
+ * Register hndlr for path like register_hndlr_methods(), with metrics.
+ * Returns ERR_MEM if METRICS_MAX_ROUTES have been registered.
+ */
+err_t metrics_register(struct server_cfg *cfg, const char *path,
+                       hndlr_f hndlr, unsigned methods, void *priv);
+
+/*
+ * Send an error response with http_resp_err(), and count the request as
+ * failed.
+ */
+err_t metrics_resp_err(struct http *http, enum http_status_t status);
+
+/* Number of registered routes. */
+unsigned metrics_routes(void);
+
+/* Metrics of route i, in order of registration. */
+const route_metrics_t *metrics_route(unsigned i);
+
+#endif
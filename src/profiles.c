@@ -0,0 +1,112 @@
+#include <string.h>
+
+#include "pico/stdlib.h"
+
+#include <bme280.h>
+
+#include "profiles.h"
+
+/*
+ * The settings follow the recommended modes of operation in the datasheet,
+ * section 3.5.
+ */
+static const profile_t profiles[] = {
+    // Weather monitoring: one forced measurement per minute, the sensor
+    // sleeps in between
+    {
+        .name = "low-power",
+        .mode = BME280_FORCED_MODE,
+        .config = BME280_FILTER_OFF,
+        .osrs_t = BME280_T_OVERSAMPLE_1,
+        .osrs_h = BME280_H_OVERSAMPLE_1,
+        .osrs_p = BME280_P_OVERSAMPLE_1,
+        .interval_ms = 60 * 1000,
+    },
+    // Continuous measurements, read once per second
+    {
+        .name = "weather",
+        .mode = BME280_NORMAL_MODE,
+        .config = BME280_FILTER_OFF,
+        .osrs_t = BME280_T_OVERSAMPLE_1,
+        .osrs_h = BME280_H_OVERSAMPLE_1,
+        .osrs_p = BME280_P_OVERSAMPLE_1,
+        .interval_ms = 1000,
+    },
+    // Indoor navigation: low pressure noise at 25 Hz
+    {
+        .name = "indoor-nav",
+        .mode = BME280_NORMAL_MODE,
+        .config = BME280_INACTIVE_MS_0_5 | BME280_FILTER_16,
+        .osrs_t = BME280_T_OVERSAMPLE_2,
+        .osrs_h = BME280_H_OVERSAMPLE_1,
+        .osrs_p = BME280_P_OVERSAMPLE_16,
+        .interval_ms = 40,
+    },
+};
+
+/*
+ * core0 stores the index of the requested profile, then counts the request.
+ * Only loads and stores are used, which are atomic on the Cortex-M0+.
+ */
+static unsigned requested;
+static unsigned requests;
+static unsigned taken;
+static unsigned active = PROFILES_DEFAULT;
+
+unsigned profiles_count(void)
+{
+    return count_of(profiles);
+}
+
+const profile_t *profiles_get(unsigned i)
+{
+    return i < count_of(profiles) ? &profiles[i] : NULL;
+}
+
+const profile_t *profiles_find(const uint8_t *name, size_t len)
+{
+    for (unsigned i = 0; i < count_of(profiles); i++)
+    {
+        if (strlen(profiles[i].name) == len &&
+            memcmp(profiles[i].name, name, len) == 0)
+        {
+            return &profiles[i];
+        }
+    }
+
+    return NULL;
+}
+
+void profiles_request(const profile_t *p)
+{
+    __atomic_store_n(&requested, (unsigned)(p - profiles), __ATOMIC_RELAXED);
+    __atomic_store_n(&requests, requests + 1, __ATOMIC_RELEASE);
+}
+
+bool profiles_pending(void)
+{
+    return __atomic_load_n(&requests, __ATOMIC_ACQUIRE) != taken;
+}
+
+const profile_t *profiles_take(void)
+{
+    unsigned n = __atomic_load_n(&requests, __ATOMIC_ACQUIRE);
+    unsigned i;
+
+    if (n == taken)
+    {
+        return NULL;
+    }
+    taken = n;
+
+    // A request made meanwhile is taken again on the next call
+    i = __atomic_load_n(&requested, __ATOMIC_RELAXED);
+    __atomic_store_n(&active, i, __ATOMIC_RELEASE);
+
+    return &profiles[i];
+}
+
+const profile_t *profiles_active(void)
+{
+    return &profiles[__atomic_load_n(&active, __ATOMIC_ACQUIRE)];
+}
@@ -0,0 +1,57 @@
+#ifndef _PROFILES_H
+#define _PROFILES_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Named acquisition profiles: the BME280 mode, oversampling and IIR filter
+ * settings, and the interval at which core1 reads each sensor.
+ *
+ * A profile is requested from core0 (POST /config/profile) with
+ * profiles_request(), and applied by core1 to all sensors before its next
+ * read, with profiles_take(). Until then the request may be replaced.
+ */
+
+typedef struct profile
+{
+    const char *name;
+    /* bme280_init() arguments, see bme280_defs.h */
+    uint8_t mode;
+    uint8_t config;
+    uint8_t osrs_t;
+    uint8_t osrs_h;
+    uint8_t osrs_p;
+    /* Interval in ms in which every sensor is read once */
+    uint32_t interval_ms;
+} profile_t;
+
+/* Profile in use after boot. */
+#define PROFILES_DEFAULT (1)
+
+/* Number of profiles. */
+unsigned profiles_count(void);
+
+/* Profile number i, or NULL if there is no such profile. */
+const profile_t *profiles_get(unsigned i);
+
+/* Find a profile by name, which is not NUL-terminated. */
+const profile_t *profiles_find(const uint8_t *name, size_t len);
+
+/* Request profile p, to be applied by core1. Called on core0. */
+void profiles_request(const profile_t *p);
+
+/* Whether a profile has been requested and not yet taken. Called on core1. */
+bool profiles_pending(void);
+
+/*
+ * Take the profile requested since the last call, or NULL if there is
+ * none; the returned profile becomes the active one. Called on core1.
+ */
+const profile_t *profiles_take(void);
+
+/* The profile currently applied to the sensors. */
+const profile_t *profiles_active(void);
+
+#endif
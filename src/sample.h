@@ -0,0 +1,34 @@
+#ifndef _SAMPLE_H
+#define _SAMPLE_H
+
+#include <stdint.h>
+
+/*
+ * One timestamped BME280 reading, kept in the integer formats produced by
+ * the driver's compensation functions (see libs/bme280/bme280.h).
+ */
+typedef struct sample
+{
+    /* Seconds since boot at which the sample was taken. */
+    uint32_t ts;
+    /* Temperature in centi-degrees C, e.g. 1321 is 13.21 DegC. */
+    int32_t temperature;
+    /* Relative humidity in %RH, Q22.10 format. */
+    uint32_t humidity;
+    /* Pressure in Pa, Q24.8 format. */
+    uint32_t pressure;
+} sample_t;
+
+/* Humidity in centi-%RH, rounded from the Q22.10 value. */
+static inline uint32_t sample_humidity_centi(const sample_t *s)
+{
+    return (s->humidity * 100 + 512) >> 10;
+}
+
+/* Pressure in Pa (i.e. centi-hPa), rounded from the Q24.8 value. */
+static inline uint32_t sample_pressure_pa(const sample_t *s)
+{
+    return (s->pressure + 128) >> 8;
+}
+
+#endif
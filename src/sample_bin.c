@@ -0,0 +1,84 @@
+#include "sample_bin.h"
+
+static uint8_t *put_u32(uint8_t *p, uint32_t v)
+{
+    p[0] = v;
+    p[1] = v >> 8;
+    p[2] = v >> 16;
+    p[3] = v >> 24;
+
+    return p + 4;
+}
+
+static uint32_t get_u32(const uint8_t *p)
+{
+    return p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 |
+           (uint32_t)p[3] << 24;
+}
+
+size_t sample_bin_header(uint8_t *dst)
+{
+    dst[0] = 'P';
+    dst[1] = 'M';
+    dst[2] = SAMPLE_BIN_VERSION;
+    dst[3] = SAMPLE_BIN_REC_LEN;
+
+    return SAMPLE_BIN_HDR_LEN;
+}
+
+size_t sample_bin_record(uint8_t *dst, const history_sample_t *s)
+{
+    uint8_t *p = dst;
+
+    p = put_u32(p, s->ts);
+    p = put_u32(p, (uint32_t)s->temperature);
+    p = put_u32(p, s->humidity);
+    p = put_u32(p, s->pressure);
+    p = put_u32(p, s->seq);
+
+    return p - dst;
+}
+
+size_t sample_bin_sensor(uint8_t *dst, const sample_t *s)
+{
+    history_sample_t h = {
+        .seq = 0,
+        .ts = s->ts,
+        .temperature = s->temperature,
+        .humidity = sample_humidity_centi(s),
+        .pressure = sample_pressure_pa(s),
+    };
+    size_t len = sample_bin_header(dst);
+
+    return len + sample_bin_record(dst + len, &h);
+}
+
+int sample_bin_decode(const uint8_t *src, size_t len, history_sample_t *out,
+                      size_t max)
+{
+    size_t rec_len, n;
+
+    if (len < SAMPLE_BIN_HDR_LEN || src[0] != 'P' || src[1] != 'M' ||
+        src[2] < 1 || (rec_len = src[3]) < SAMPLE_BIN_REC_LEN)
+    {
+        return -1;
+    }
+    src += SAMPLE_BIN_HDR_LEN;
+    len -= SAMPLE_BIN_HDR_LEN;
+    if (len % rec_len != 0)
+    {
+        return -1;
+    }
+
+    n = len / rec_len;
+    for (size_t i = 0; i < n && i < max; i++, src += rec_len)
+    {
+        out[i].ts = get_u32(src);
+        out[i].temperature = (int32_t)get_u32(src + 4);
+        out[i].humidity = get_u32(src + 8);
+        out[i].pressure = get_u32(src + 12);
+        out[i].seq = get_u32(src + 16);
+    }
+
+    return (int)n;
+}
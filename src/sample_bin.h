@@ -0,0 +1,63 @@
+#ifndef _SAMPLE_BIN_H
+#define _SAMPLE_BIN_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "history.h"
+#include "sample.h"
+
+/*
+ * Binary representation of samples, for /sensor.bin and /history.bin, or
+ * for /sensor and /history with SAMPLE_BIN_TYPE as a media range of the
+ * Accept header, unless refused with q=0.
+ *
+ * A body is a 4-byte header followed by zero or more 20-byte records, all
+ * integers little-endian:
+ *
+ *     header:  0  u8   'P'
+ *              1  u8   'M'
+ *              2  u8   version, SAMPLE_BIN_VERSION
+ *              3  u8   record length, SAMPLE_BIN_REC_LEN
+ *     record:  0  u32  ts, seconds since boot
+ *              4  i32  temperature, centi-degrees C
+ *              8  u32  humidity, centi-%RH
+ *             12  u32  pressure, Pa
+ *             16  u32  seq, sequence number in the history
+ *
+ * The values have the resolution of the JSON bodies. A decoder must skip
+ * any bytes of a record beyond those it knows, so that fields can be
+ * appended in a later version with a longer record.
+ *
+ * /history.bin holds the records in order of seq; the cursor for the next
+ * request (query parameter "after") is the seq of the last record. seq is
+ * 0 in the record of /sensor.bin, which is not numbered.
+ */
+
+#define SAMPLE_BIN_TYPE "application/vnd.pico-meteo.samples"
+
+#define SAMPLE_BIN_VERSION (1)
+#define SAMPLE_BIN_HDR_LEN (4)
+#define SAMPLE_BIN_REC_LEN (20)
+
+/* Length of a body with a single record, as for /sensor.bin */
+#define SAMPLE_BIN_SENSOR_LEN (SAMPLE_BIN_HDR_LEN + SAMPLE_BIN_REC_LEN)
+
+/* Write the header to dst, and return its length. */
+size_t sample_bin_header(uint8_t *dst);
+
+/* Write the record for s to dst, and return its length. */
+size_t sample_bin_record(uint8_t *dst, const history_sample_t *s);
+
+/* Write the header and the record for s to dst, and return the length. */
+size_t sample_bin_sensor(uint8_t *dst, const sample_t *s);
+
+/*
+ * Decode a body of len bytes into at most max samples. Returns the number
+ * of records in the body, which may be more than max, or -1 if the header
+ * is invalid or the body ends within a record.
+ */
+int sample_bin_decode(const uint8_t *src, size_t len, history_sample_t *out,
+                      size_t max);
+
+#endif
@@ -0,0 +1,121 @@
+#include "sampler.h"
+#include "seqlock.h"
+
+static sampler_stats_t stats;
+static seqlock_t stats_lock;
+
+/* Due time of the next sample */
+static absolute_time_t due;
+static uint32_t slot_us;
+
+/* Start of the current period, unset until the first sample has started */
+static absolute_time_t period_start;
+static bool period_started;
+/* Time asleep in the current period */
+static uint64_t asleep_us;
+
+void sampler_start(uint32_t slot)
+{
+    slot_us = slot > 0 ? slot : 1;
+    due = make_timeout_time_us(slot_us);
+    // The period that was cut short is not counted
+    period_started = false;
+
+    seqlock_write_begin(&stats_lock);
+    stats.slot_us = slot_us;
+    seqlock_write_end(&stats_lock);
+}
+
+bool sampler_sleep_until(absolute_time_t t, bool (*wake)(void))
+{
+    absolute_time_t from = get_absolute_time();
+    bool reached;
+
+    // Other interrupts and events wake core1 too, then it goes back to sleep
+    while (!(reached = best_effort_wfe_or_timeout(t)))
+    {
+        if (wake != NULL && wake())
+        {
+            break;
+        }
+    }
+    asleep_us += absolute_time_diff_us(from, get_absolute_time());
+
+    return reached;
+}
+
+bool sampler_wait(absolute_time_t *sample_due, bool (*wake)(void))
+{
+    uint32_t missed = 0;
+
+    // Slots that passed while the last sample was taken are skipped
+    while (absolute_time_diff_us(due, get_absolute_time()) >= slot_us)
+    {
+        due = delayed_by_us(due, slot_us);
+        missed++;
+    }
+
+    if (!sampler_sleep_until(due, wake))
+    {
+        return false;
+    }
+
+    absolute_time_t now = get_absolute_time();
+    int64_t late = absolute_time_diff_us(due, now);
+    uint64_t period = 0, awake = 0;
+
+    if (late < 0)
+    {
+        late = 0;
+    }
+    if (period_started)
+    {
+        period = absolute_time_diff_us(period_start, now);
+        awake = period > asleep_us ? period - asleep_us : 0;
+    }
+
+    seqlock_write_begin(&stats_lock);
+    stats.samples++;
+    stats.due_us = to_us_since_boot(due);
+    stats.start_us = to_us_since_boot(now);
+    stats.late_us = (uint32_t)late;
+    if (stats.late_us > stats.late_max_us)
+    {
+        stats.late_max_us = stats.late_us;
+    }
+    stats.late_total_us += (uint64_t)late;
+    stats.missed += missed;
+    if (period_started)
+    {
+        stats.period_us = (uint32_t)period;
+        stats.awake_us = (uint32_t)awake;
+        stats.period_total_us += period;
+        stats.awake_total_us += awake;
+    }
+    seqlock_write_end(&stats_lock);
+
+    period_start = now;
+    period_started = true;
+    asleep_us = 0;
+
+    *sample_due = due;
+    due = delayed_by_us(due, slot_us);
+
+    return true;
+}
+
+absolute_time_t sampler_next_due(void)
+{
+    return due;
+}
+
+void sampler_stats(sampler_stats_t *s)
+{
+    uint32_t seq;
+
+    do
+    {
+        seq = seqlock_read_begin(&stats_lock);
+        *s = stats;
+    } while (seqlock_read_retry(&stats_lock, seq));
+}
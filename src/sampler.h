@@ -0,0 +1,84 @@
+#ifndef _SAMPLER_H
+#define _SAMPLER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "pico/stdlib.h"
+
+/*
+ * Schedule of core1's sampling loop, its timing and its duty cycle.
+ *
+ * Samples are due on a fixed grid of absolute times, one slot apart, from
+ * sampler_start(). Each deadline is the previous one plus the slot, not the
+ * time of the last wakeup plus the slot, so the time the loop takes does
+ * not accumulate as drift. If the loop overruns a whole slot, the slots
+ * that have passed are skipped, so that samples stay on the grid.
+ *
+ * core1 sleeps in WFE until a sample is due, and while a forced-mode
+ * measurement completes. It is woken by the timer alarm that ends the wait
+ * (see best_effort_wfe_or_timeout() in the SDK), or early by an event that
+ * core0 sends with __sev(). Time spent in sampler_sleep_until() counts as
+ * asleep, all other time as awake. The duty cycle of a sample is the share
+ * of its period in which core1 was awake.
+ *
+ * For each sample, the lateness of its start relative to its due time is
+ * recorded, which is the jitter of the sample timestamps.
+ *
+ * All functions except sampler_stats() are only called on core1.
+ */
+
+typedef struct sampler_stats
+{
+    /* Number of samples started by sampler_wait() */
+    uint32_t samples;
+    /* Slot length in us */
+    uint32_t slot_us;
+    /* Due time of the last sample, and the time it started, in us since
+     * boot */
+    uint64_t due_us;
+    uint64_t start_us;
+    /* Lateness of the last sample, the largest, and the sum over all */
+    uint32_t late_us;
+    uint32_t late_max_us;
+    uint64_t late_total_us;
+    /* Slots skipped after an overrun */
+    uint32_t missed;
+    /* Time between the starts of the last two samples, and the time awake
+     * in it, in us */
+    uint32_t period_us;
+    uint32_t awake_us;
+    /* Totals of all periods, in us */
+    uint64_t period_total_us;
+    uint64_t awake_total_us;
+} sampler_stats_t;
+
+/*
+ * (Re)start the schedule with slots of slot_us. The first sample is due one
+ * slot from now.
+ */
+void sampler_start(uint32_t slot_us);
+
+/*
+ * Sleep until the next sample is due, and store its due time in due.
+ * Returns false if woken before then because wake() returned true; the
+ * sample is then still due. wake may be NULL.
+ */
+bool sampler_wait(absolute_time_t *due, bool (*wake)(void));
+
+/*
+ * Due time of the sample after the one last returned by sampler_wait(), the
+ * deadline for any background work in between.
+ */
+absolute_time_t sampler_next_due(void);
+
+/*
+ * Sleep until time t. Returns false if woken before then because wake()
+ * returned true; wake may be NULL.
+ */
+bool sampler_sleep_until(absolute_time_t t, bool (*wake)(void));
+
+/* Copy the statistics. */
+void sampler_stats(sampler_stats_t *stats);
+
+#endif
@@ -0,0 +1,71 @@
+#include <stdio.h>
+
+#include "sensor_cache.h"
+
+/* Same string hash as used for the /netinfo ETag. */
+static uint32_t hash_body(const void *body, size_t len)
+{
+    const char *p = body;
+    uint32_t h = 0;
+
+    while (len-- > 0)
+    {
+        h = 31 * h + *p++;
+    }
+
+    return h;
+}
+
+void sensor_cache_update(sensor_cache_t *c, const sample_t *s)
+{
+    const sensor_body_t *held;
+    sensor_body_t *b;
+
+    // The publication of the last body must be visible to the reader
+    // before the hazard is read, so that a hold that started meanwhile
+    // either sees that body or is seen here
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    held = __atomic_load_n(&c->hazard, __ATOMIC_RELAXED);
+    do
+    {
+        b = &c->slots[c->next_slot];
+        c->next_slot = (c->next_slot + 1) % SENSOR_CACHE_SLOTS;
+    } while (b == c->current || b == held);
+
+    b->len = json_sensor(b->body, s);
+    snprintf(b->etag, sizeof b->etag, "\"%08lx\"",
+             (unsigned long)hash_body(b->body, b->len));
+    sample_bin_sensor(b->bin, s);
+    snprintf(b->bin_etag, sizeof b->bin_etag, "\"%08lx\"",
+             (unsigned long)hash_body(b->bin, sizeof b->bin));
+
+    // The slot contents must be visible before the pointer to it
+    __atomic_store_n(&c->current, b, __ATOMIC_RELEASE);
+}
+
+const sensor_body_t *sensor_cache_hold(sensor_cache_t *c)
+{
+    const sensor_body_t *b;
+
+    // The hazard is only valid if the body is still current after it has
+    // been published; otherwise the writer may already render into it
+    do
+    {
+        b = __atomic_load_n(&c->current, __ATOMIC_ACQUIRE);
+        __atomic_store_n(&c->hazard, b, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    } while (b != __atomic_load_n(&c->current, __ATOMIC_ACQUIRE));
+
+    if (b == NULL)
+    {
+        sensor_cache_release(c);
+    }
+
+    return b;
+}
+
+void sensor_cache_release(sensor_cache_t *c)
+{
+    // The reads of the body must complete before the slot is free
+    __atomic_store_n(&c->hazard, NULL, __ATOMIC_RELEASE);
+}
@@ -0,0 +1,75 @@
+#ifndef _SENSOR_CACHE_H
+#define _SENSOR_CACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "json.h"
+#include "sample.h"
+#include "sample_bin.h"
+
+/*
+ * Pre-rendered /sensor response bodies.
+ *
+ * The writer (core1) renders the JSON and the binary body (see
+ * sample_bin.h) and their ETags once per new sample into a free slot of a
+ * small ring, and then publishes a pointer to the slot. Every sample is
+ * published, however fast sampling is.
+ *
+ * A handler on core0 holds the current body with sensor_cache_hold() while
+ * it sends it, and releases it with sensor_cache_release(). The writer never
+ * renders into the held slot, nor into the current one, so a third slot is
+ * always free. The body is sent with durable=false: lwIP copies it, and the
+ * slot is free again as soon as the handler returns, however slow the
+ * client is.
+ *
+ * The hold is a hazard pointer, published and checked with fences only, as
+ * the M0+ has no atomic read-modify-write instructions. There is a single
+ * hazard per cache, so at most one handler may hold a body at a time; all
+ * handlers run in lwIP context on core0, one after the other.
+ */
+
+/* Number of slots in the ring: current, held and the one rendered into. */
+#define SENSOR_CACHE_SLOTS (3)
+
+/* Length of an ETag value with a 32-bit hash in hex, including quotes. */
+#define SENSOR_ETAG_LEN (sizeof("\"12345678\"") - 1)
+
+typedef struct sensor_body
+{
+    /* Length of body */
+    size_t len;
+    char etag[SENSOR_ETAG_LEN + 1];
+    char body[JSON_SENSOR_MAX];
+    /* The binary body, which always has SAMPLE_BIN_SENSOR_LEN bytes */
+    char bin_etag[SENSOR_ETAG_LEN + 1];
+    uint8_t bin[SAMPLE_BIN_SENSOR_LEN];
+} sensor_body_t;
+
+/* Ring of bodies for one sensor. Zero-initialized, e.g. as a static. */
+typedef struct sensor_cache
+{
+    sensor_body_t slots[SENSOR_CACHE_SLOTS];
+    unsigned next_slot;
+    sensor_body_t *current;
+    /* The body held by a handler, or NULL */
+    const sensor_body_t *hazard;
+} sensor_cache_t;
+
+/*
+ * Render the body for a new sample and publish it. Must only be called from
+ * a single writer.
+ */
+void sensor_cache_update(sensor_cache_t *c, const sample_t *s);
+
+/*
+ * Hold the most recently published body, or return NULL if there is none
+ * yet. The contents remain unchanged until sensor_cache_release(), even if
+ * newer bodies are published meanwhile.
+ */
+const sensor_body_t *sensor_cache_hold(sensor_cache_t *c);
+
+/* Release the body held with sensor_cache_hold(). */
+void sensor_cache_release(sensor_cache_t *c);
+
+#endif
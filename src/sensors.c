@@ -0,0 +1,294 @@
+#include <stdio.h>
+
+#include "pico/stdlib.h"
+
+#include <bme280.h>
+
+#include "i2c_arbiter.h"
+#include "i2c_scan.h"
+#include "profiles.h"
+#include "sampler.h"
+#include "seqlock.h"
+#include "sensors.h"
+
+typedef struct sensor
+{
+    bme280_t dev;
+    i2c_inst_t *bus;
+    sensor_info_t info;
+
+    /* Most recent sample, written by core1 */
+    sample_t latest;
+    seqlock_t lock;
+    bool valid;
+    sensor_cache_t cache;
+
+    /* Read statistics, published with latest */
+    sensor_stats_t stats;
+
+    /* Time at which the data registers hold a new measurement */
+    absolute_time_t ready;
+
+    /* Consecutive failed reads, and rounds left to skip */
+    uint8_t failures;
+    uint8_t skip;
+} sensor_t;
+
+static sensor_t sensors[SENSORS_MAX];
+static unsigned count;
+
+static const uint8_t addrs[] = {0x76, 0x77};
+
+unsigned sensors_init(const profile_t *p)
+{
+    i2c_inst_t *const buses[] = {i2c0, i2c1};
+    unsigned n = 0;
+
+    for (unsigned b = 0; b < count_of(buses); b++)
+    {
+        i2c_scan_t scan;
+
+        // Only initialize devices that identify as a BME280, so that boot
+        // cannot hang on a stuck bus or an empty address.
+        if (i2c_scan(buses[b], &scan) != PICO_OK)
+        {
+            printf("Core1: i2c%u is stuck, skipped\n", b);
+            continue;
+        }
+        printf("Core1: i2c%u: %u devices%s\n", b, scan.count,
+               scan.cached ? " (cached)" : "");
+
+        for (unsigned a = 0; a < count_of(addrs); a++)
+        {
+            sensor_t *s = &sensors[n];
+            i2c_dev_type_t type = i2c_scan_type(&scan, addrs[a]);
+            int8_t res;
+
+            if (type == I2C_DEV_BMP280)
+            {
+                printf("Core1: i2c%u 0x%02x is a BMP280, not supported\n", b,
+                       addrs[a]);
+            }
+            if (type != I2C_DEV_BME280)
+            {
+                continue;
+            }
+
+            res = bme280_init(buses[b], addrs[a], &s->dev, p->mode, p->config,
+                              p->osrs_t, p->osrs_h, p->osrs_p);
+            if (res != BME280_OK)
+            {
+                continue;
+            }
+
+            s->bus = buses[b];
+            s->info.bus = (uint8_t)b;
+            s->info.addr = addrs[a];
+            s->stats.meas_us = bme280_meas_time_us(&s->dev);
+            // bme280_init() waits for the first measurement
+            s->ready = get_absolute_time();
+            seqlock_init(&s->lock);
+            printf("Core1: bme280 %u at i2c%u 0x%02x\n", n, b, addrs[a]);
+            n++;
+        }
+    }
+
+    // The sensors must be set up before the other core can see them
+    __atomic_store_n(&count, n, __ATOMIC_RELEASE);
+
+    return n;
+}
+
+void sensors_apply(const profile_t *p)
+{
+    unsigned n = sensors_count();
+
+    for (unsigned id = 0; id < n; id++)
+    {
+        sensor_t *s = &sensors[id];
+        int8_t res;
+
+        // A display frame still in progress on the bus is cut short
+        i2c_arbiter_acquire(sensors_bus(id));
+
+        // The config register is only reliably written in sleep mode
+        res = bme280_update_settings(&s->dev, BME280_SLEEP_MODE, p->config,
+                                     p->osrs_t, p->osrs_h, p->osrs_p);
+        if (res == BME280_OK)
+        {
+            res = bme280_update_settings(&s->dev, p->mode, p->config,
+                                         p->osrs_t, p->osrs_h, p->osrs_p);
+        }
+        if (res != BME280_OK)
+        {
+            printf("Core1: bme280 %u settings failed: %s\n", id,
+                   bme280_strerr(res));
+        }
+
+        seqlock_write_begin(&s->lock);
+        s->stats.meas_us = bme280_meas_time_us(&s->dev);
+        seqlock_write_end(&s->lock);
+        // bme280_update_settings() waits for a measurement
+        s->ready = get_absolute_time();
+    }
+}
+
+unsigned sensors_count(void)
+{
+    return __atomic_load_n(&count, __ATOMIC_ACQUIRE);
+}
+
+bool sensors_info(unsigned id, sensor_info_t *info)
+{
+    if (id >= sensors_count())
+    {
+        return false;
+    }
+    *info = sensors[id].info;
+
+    return true;
+}
+
+i2c_inst_t *sensors_bus(unsigned id)
+{
+    return sensors[id].bus;
+}
+
+/* Run fn on the sensor, and add the time it took to *bus_us. */
+static int8_t timed(int8_t (*fn)(bme280_t *const), sensor_t *s,
+                    uint32_t *bus_us)
+{
+    uint32_t t0 = time_us_32();
+    int8_t res = fn(&s->dev);
+
+    *bus_us += time_us_32() - t0;
+
+    return res;
+}
+
+bool sensors_read(unsigned id, uint32_t now_ms, sample_t *sample)
+{
+    sensor_t *s = &sensors[id];
+    uint32_t bus_us = 0;
+    int8_t res = BME280_OK;
+
+    if (s->skip > 0)
+    {
+        s->skip--;
+        return false;
+    }
+
+    // In forced mode a measurement is started, and read when it must have
+    // completed. In normal mode the data registers always hold the latest
+    // measurement, so the status register is never polled.
+    if ((s->dev.ctrl_meas & BME280_NORMAL_MODE) == BME280_FORCED_MODE)
+    {
+        res = timed(bme280_trigger, s, &bus_us);
+        s->ready = make_timeout_time_us(s->stats.meas_us);
+    }
+    if (res == BME280_OK)
+    {
+        // Waits for the timer alarm, not on the bus
+        sampler_sleep_until(s->ready, NULL);
+        res = timed(bme280_burst_read, s, &bus_us);
+    }
+
+    if (res == BME280_OK)
+    {
+        sample->ts = now_ms / 1000;
+        sample->temperature = s->dev.temperature;
+        sample->humidity = s->dev.humidity;
+        sample->pressure = s->dev.pressure;
+    }
+
+    seqlock_write_begin(&s->lock);
+    s->stats.bus_us = bus_us;
+    s->stats.bus_us_total += bus_us;
+    if (res == BME280_OK)
+    {
+        s->stats.reads++;
+        s->latest = *sample;
+        s->valid = true;
+    }
+    else
+    {
+        s->stats.failures++;
+    }
+    seqlock_write_end(&s->lock);
+
+    if (res != BME280_OK)
+    {
+        printf("Core1: bme280 %u read failed: %s\n", id, bme280_strerr(res));
+        if ((1 << s->failures) < SENSORS_MAX_BACKOFF)
+        {
+            s->failures++;
+        }
+        s->skip = 1 << s->failures;
+        return false;
+    }
+    s->failures = 0;
+
+    sensor_cache_update(&s->cache, sample);
+
+    return true;
+}
+
+bool sensors_get(unsigned id, sample_t *sample)
+{
+    sensor_t *s;
+    uint32_t seq;
+    bool valid;
+
+    if (id >= sensors_count())
+    {
+        return false;
+    }
+    s = &sensors[id];
+
+    do
+    {
+        seq = seqlock_read_begin(&s->lock);
+        *sample = s->latest;
+        valid = s->valid;
+    } while (seqlock_read_retry(&s->lock, seq));
+
+    return valid;
+}
+
+bool sensors_stats(unsigned id, sensor_stats_t *stats)
+{
+    sensor_t *s;
+    uint32_t seq;
+
+    if (id >= sensors_count())
+    {
+        return false;
+    }
+    s = &sensors[id];
+
+    do
+    {
+        seq = seqlock_read_begin(&s->lock);
+        *stats = s->stats;
+    } while (seqlock_read_retry(&s->lock, seq));
+
+    return true;
+}
+
+const sensor_body_t *sensors_body_hold(unsigned id)
+{
+    if (id >= sensors_count())
+    {
+        return NULL;
+    }
+
+    return sensor_cache_hold(&sensors[id].cache);
+}
+
+void sensors_body_release(unsigned id)
+{
+    if (id < sensors_count())
+    {
+        sensor_cache_release(&sensors[id].cache);
+    }
+}
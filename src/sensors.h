@@ -0,0 +1,106 @@
+#ifndef _SENSORS_H
+#define _SENSORS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "hardware/i2c.h"
+
+#include "profiles.h"
+#include "sample.h"
+#include "sensor_cache.h"
+
+/*
+ * Registry of the BME280 sensors attached to the board.
+ *
+ * sensors_init() scans i2c0 and i2c1 (see i2c_scan.h) and initializes the
+ * devices at the two BME280 addresses (0x76 and 0x77) that identify as a
+ * BME280, in that order, so sensor ids are stable for a given wiring. Id 0
+ * is the primary sensor, which is shown on the display and recorded in the
+ * history.
+ *
+ * sensors_init() and sensors_read() are only called from core1; the other
+ * functions may be called from either core. Each sensor's latest sample is
+ * published with a seqlock, and its /sensor body is rendered into its own
+ * sensor_cache_t.
+ */
+
+/* Maximum number of sensors: two addresses on each of two buses. */
+#define SENSORS_MAX (4)
+
+/*
+ * After a failed read, a sensor is skipped for 2^failures rounds, up to
+ * this many, so that a missing probe does not cost bus time every round.
+ */
+#define SENSORS_MAX_BACKOFF (32)
+
+typedef struct sensor_info
+{
+    /* i2c bus number, 0 or 1 */
+    uint8_t bus;
+    /* 7-bit i2c address */
+    uint8_t addr;
+} sensor_info_t;
+
+typedef struct sensor_stats
+{
+    /* Successful and failed reads */
+    uint32_t reads;
+    uint32_t failures;
+    /* Time in us spent in i2c transactions by the last read */
+    uint32_t bus_us;
+    /* Maximum measurement time in us with the current settings */
+    uint32_t meas_us;
+    /* Time in us spent in i2c transactions by all reads */
+    uint64_t bus_us_total;
+} sensor_stats_t;
+
+/*
+ * Find and initialize all sensors with the settings of profile p. The i2c
+ * buses must have been initialized. Returns the number of sensors found.
+ */
+unsigned sensors_init(const profile_t *p);
+
+/*
+ * Apply the settings of profile p to all sensors. Each bus is taken from
+ * the i2c arbiter first, as for a read.
+ */
+void sensors_apply(const profile_t *p);
+
+/* Number of sensors found by sensors_init(). */
+unsigned sensors_count(void);
+
+/* Get the bus and address of sensor id. Returns false for an invalid id. */
+bool sensors_info(unsigned id, sensor_info_t *info);
+
+/* The i2c bus of sensor id, which must be valid. */
+i2c_inst_t *sensors_bus(unsigned id);
+
+/*
+ * Read sensor id and publish the sample. now_ms is the current time in ms.
+ * Returns false if the read failed, or was skipped after earlier failures.
+ *
+ * The data registers are read in one burst, at a time computed from the
+ * measurement time (datasheet section 9): in forced mode, a measurement is
+ * triggered and the read waits on a timer alarm until it has completed. The
+ * bus is never polled for the status of a measurement.
+ */
+bool sensors_read(unsigned id, uint32_t now_ms, sample_t *s);
+
+/*
+ * Get the latest sample of sensor id. Returns false for an invalid id, or
+ * if the sensor has not been read successfully yet.
+ */
+bool sensors_get(unsigned id, sample_t *s);
+
+/* Get the read statistics of sensor id. Returns false for an invalid id. */
+bool sensors_stats(unsigned id, sensor_stats_t *stats);
+
+/*
+ * Hold the /sensor body of sensor id, or return NULL for an invalid id or
+ * as sensor_cache_hold() does. Release it with sensors_body_release().
+ */
+const sensor_body_t *sensors_body_hold(unsigned id);
+void sensors_body_release(unsigned id);
+
+#endif
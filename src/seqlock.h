@@ -0,0 +1,71 @@
+#ifndef _SEQLOCK_H
+#define _SEQLOCK_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Sequence lock for data with a single writer and any number of readers,
+ * possibly on the other core.
+ *
+ * The writer never waits and readers never block the writer or disable
+ * interrupts. The sequence number is odd while an update is in progress; a
+ * reader copies the data and retries if the sequence number changed in the
+ * meantime, so it never returns a torn copy.
+ *
+ * Writer:
+ *
+ *     seqlock_write_begin(&lock);
+ *     data = new_data;
+ *     seqlock_write_end(&lock);
+ *
+ * Reader:
+ *
+ *     do
+ *     {
+ *         seq = seqlock_read_begin(&lock);
+ *         copy = data;
+ *     } while (seqlock_read_retry(&lock, seq));
+ */
+typedef struct
+{
+    uint32_t seq;
+} seqlock_t;
+
+static inline void seqlock_init(seqlock_t *sl)
+{
+    __atomic_store_n(&sl->seq, 0, __ATOMIC_RELAXED);
+}
+
+static inline void seqlock_write_begin(seqlock_t *sl)
+{
+    __atomic_store_n(&sl->seq, sl->seq + 1, __ATOMIC_RELAXED);
+    // The odd sequence number must be visible before any of the data stores
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+static inline void seqlock_write_end(seqlock_t *sl)
+{
+    __atomic_store_n(&sl->seq, sl->seq + 1, __ATOMIC_RELEASE);
+}
+
+static inline uint32_t seqlock_read_begin(const seqlock_t *sl)
+{
+    uint32_t seq;
+
+    // An update takes a few dozen cycles, so spinning is cheaper than waiting
+    while ((seq = __atomic_load_n(&sl->seq, __ATOMIC_ACQUIRE)) & 1)
+        ;
+
+    return seq;
+}
+
+static inline bool seqlock_read_retry(const seqlock_t *sl, uint32_t seq)
+{
+    // The data loads must complete before the sequence number is re-read
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+
+    return __atomic_load_n(&sl->seq, __ATOMIC_RELAXED) != seq;
+}
+
+#endif
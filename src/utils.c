@@ -1,24 +1,36 @@
 #include "utils.h"
 
-char *new_string(const char *format, ...)
+char *fmt_centi(char *dst, int32_t val)
 {
-    va_list args;
+    char digits[8];
+    int n = 0;
+    uint32_t u = val;
 
-    va_start(args, format);
-    int len = vsnprintf(NULL, 0, format, args);
-    va_end(args);
+    if (val < 0)
+    {
+        *dst++ = '-';
+        u = -u;
+    }
+
+    uint32_t ip = u / 100;
+    uint32_t fp = u % 100;
+
+    do
+    {
+        digits[n++] = '0' + ip % 10;
+        ip /= 10;
+    } while (ip != 0);
 
-    char *str = (char *)malloc(len + 1);
-    if (!str)
+    while (n > 0)
     {
-        return NULL;
+        *dst++ = digits[--n];
     }
 
-    va_start(args, format);
-    vsnprintf(str, len + 1, format, args);
-    va_end(args);
+    *dst++ = '.';
+    *dst++ = '0' + fp / 10;
+    *dst++ = '0' + fp % 10;
 
-    return str;
+    return dst;
 }
 
 void custom_assert(int condition, const char *message, const char *file, int line)
@@ -1,12 +1,17 @@
 #ifndef _UTILS_H
 #define _UTILS_H
 
-#include <stdarg.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 
-// Allocate and format string. Allocates memory, caller must free.
-char *new_string(const char *format, ...);
+// Longest output of fmt_centi(), e.g. "-21474836.48".
+#define FMT_CENTI_MAX (12)
+
+// Format a value in hundredths as a decimal with two fractional digits,
+// e.g. -1234 as "-12.34". No allocation, no floating point and no NUL
+// terminator; returns a pointer past the last character written.
+char *fmt_centi(char *dst, int32_t val);
 
 void custom_assert(int condition, const char *message, const char *file,
                    int line);
@@ -1,5 +1,7 @@
 
 const SENSOR_UPDATE_MS = 2000;
+/* The event stream is served on its own port, see src/events.h. */
+const EVENTS_PORT = 8092;
 
 const temperatureElem = document.getElementById("temperatureValue");
 const pressureElem = document.getElementById("pressureValue");
@@ -16,6 +18,12 @@ async function getResponse(url) {
     return response;
 }
 
+function showSensorData(data) {
+    temperatureElem.textContent = data.temperature;
+    pressureElem.textContent = data.pressure;
+    humidityElem.textContent = data.humidity;
+}
+
 async function updateSensorData() {
     let data = null;
 
@@ -28,9 +36,44 @@ async function updateSensorData() {
         return;
     }
 
-    temperatureElem.textContent = data.temperature;
-    pressureElem.textContent = data.pressure;
-    humidityElem.textContent = data.humidity;
+    showSensorData(data);
+}
+
+let pollTimer = null;
+
+function startPolling() {
+    if (pollTimer !== null) {
+        return;
+    }
+
+    document.addEventListener("visibilitychange", updateOnVisible);
+    pollTimer = setInterval(updateSensorData, SENSOR_UPDATE_MS);
+}
+
+/*
+ * Subscribe to the event stream, which pushes each new sample. The browser
+ * reconnects by itself after transient errors; if the stream is refused
+ * (e.g. all subscriber slots are taken), fall back to polling /sensor.
+ */
+function startEvents() {
+    if (!window.EventSource) {
+        return false;
+    }
+
+    let url = location.protocol + "//" + location.hostname + ":" +
+        EVENTS_PORT + "/events";
+    let source = new EventSource(url);
+
+    source.onmessage = (event) => {
+        showSensorData(JSON.parse(event.data));
+    };
+    source.onerror = () => {
+        if (source.readyState === EventSource.CLOSED) {
+            startPolling();
+        }
+    };
+
+    return true;
 }
 
 async function updateOnVisible() {
@@ -44,8 +87,9 @@ async function updateOnVisible() {
 async function init() {
     await updateSensorData();
 
-    document.addEventListener("visibilitychange", updateOnVisible);
-    setInterval(updateSensorData, SENSOR_UPDATE_MS)
+    if (!startEvents()) {
+        startPolling();
+    }
 }
 
 /* Run initialization when the document has been loaded. */